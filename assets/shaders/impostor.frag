@@ -0,0 +1,18 @@
+#version 330 core
+
+out vec4 FragColor;
+
+flat in vec2 CellOrigin;
+
+uniform sampler2D atlas;
+uniform vec2 atlasGrid;
+
+void main() {
+    vec4 texel = texture(atlas, CellOrigin + vec2(gl_PointCoord.x, 1.0 - gl_PointCoord.y) / atlasGrid);
+
+    if (texel.a < 0.5) {
+        discard;
+    }
+
+    FragColor = vec4(0.01);
+}
\ No newline at end of file
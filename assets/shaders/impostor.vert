@@ -0,0 +1,50 @@
+#version 330 core
+
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in uint aInstanceID;
+
+flat out vec2 CellOrigin;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+uniform float viewportHeight;
+
+// Local-space bounding sphere (xyz centre, w radius) and the atlas layout in cells.
+uniform vec4 bounds;
+uniform vec2 atlasGrid;
+
+uniform bool indirectInstances;
+uniform samplerBuffer transforms;
+
+const float PI = 3.14159265;
+
+mat4 instanceTransform() {
+    if (!indirectInstances) {
+        return aModel;
+    }
+
+    int base = int(aInstanceID) * 4;
+    return mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+}
+
+void main() {
+    mat4 model = instanceTransform();
+
+    vec3 center = vec3(model * vec4(bounds.xyz, 1.0));
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+
+    vec4 viewSpace = view * vec4(center, 1.0);
+    gl_Position = projection * viewSpace;
+    gl_PointSize = max(bounds.w * scale * projection[1][1] * viewportHeight / max(-viewSpace.z, 0.0001), 1.0);
+
+    // Pick the baked view closest to the direction the camera sees this instance from.
+    vec3 direction = normalize(inverse(mat3(model)) * (viewPos - center));
+    float azimuth = atan(direction.z, direction.x);
+    float elevation = asin(clamp(direction.y, -1.0, 1.0));
+
+    float column = mod(floor(azimuth / (2.0 * PI) * atlasGrid.x + 0.5), atlasGrid.x);
+    float row = clamp(floor((elevation / PI + 0.5) * atlasGrid.y), 0.0, atlasGrid.y - 1.0);
+
+    CellOrigin = vec2(column, row) / atlasGrid;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// gl_InstanceID restarts at zero for every draw, so each range passes its first instance here.
+uniform int instanceBase;
+
+layout (std140) uniform Lattice {
+    vec4 origin;   // xyz origin, w instance scale
+    vec4 spacing;  // xyz spacing, w jitter fraction
+    uvec4 dims;    // xyz cell counts, w jitter seed
+    uvec4 bricks;  // xyz brick counts, w brick edge length
+};
+
+uint hash(uint x) {
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+void main() {
+    TexCoords = aTexCoords;
+    Normal = aNormal;
+    FragPos = vec3(0.0);
+
+    uint id = uint(gl_InstanceID + instanceBase);
+    uint size = bricks.w;
+    uint brick = id / (size * size * size);
+    uint local = id % (size * size * size);
+
+    uvec3 brickCell = uvec3(brick / (bricks.y * bricks.z), (brick / bricks.z) % bricks.y, brick % bricks.z);
+    uvec3 localCell = uvec3(local / (size * size), (local / size) % size, local % size);
+    uvec3 cell = brickCell * size + localCell;
+
+    // Slots padding the last brick along each axis collapse to a degenerate point and get clipped.
+    if (any(greaterThanEqual(cell, dims.xyz))) {
+        gl_Position = vec4(0.0);
+        return;
+    }
+
+    vec3 position = origin.xyz + vec3(cell) * spacing.xyz;
+
+    if (dims.w != 0u) {
+        uint h = hash(cell.x ^ hash(cell.y ^ hash(cell.z ^ dims.w)));
+        vec3 random = vec3(float(h & 0x3FFu), float((h >> 10u) & 0x3FFu), float((h >> 20u) & 0x3FFu));
+        position += (random / 1023.0 * 2.0 - 1.0) * spacing.w * spacing.xyz;
+    }
+
+    FragPos = position + aPos * origin.w;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -2,6 +2,125 @@
 
 out vec4 FragColor;
 
+in vec2 TexCoords;
+in vec3 FragPos;
+in vec3 Normal;
+
+uniform mat4 view;
+
+// Material textures packed into arrays by size. materialDiffuse holds the array plus one and the layer of the
+// diffuse map, with an array of 0 for untextured materials.
+uniform sampler2DArray materialArrays[4];
+uniform vec2 materialDiffuse;
+
+// 0 leaves the scene unlit, 1 shades with the lights assigned to the fragment's cluster and 2 loops over every
+// light, as a reference for the clustered path.
+uniform int lightingMode;
+uniform int lightCount;
+
+// Two texels per light: position and radius, then colour scaled by intensity.
+uniform samplerBuffer lightData;
+// Offset and count into lightIndices for every cluster, ordered x fastest, then y, then depth slice.
+uniform usamplerBuffer lightGrid;
+uniform usamplerBuffer lightIndices;
+
+// Tiles across, tiles down and depth slices; tiles per pixel; near plane and slices per log unit of depth.
+uniform vec3 clusterGrid;
+uniform vec2 clusterScale;
+uniform vec2 clusterDepth;
+
+// Directional light with cascaded shadow maps. Each cascade covers view depths up to its entry in
+// cascadeSplits and projects into its layer of shadowMap with cascadeMatrices.
+uniform bool shadowsEnabled;
+uniform vec3 sunDirection;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[4];
+uniform vec4 cascadeSplits;
+uniform int cascadeCount;
+
+const vec3 ALBEDO = vec3(0.8);
+const vec3 SUN_COLOR = vec3(0.6, 0.55, 0.5);
+
+vec3 shade(int index, vec3 normal) {
+    vec4 positionRadius = texelFetch(lightData, index * 2);
+    vec3 color = texelFetch(lightData, index * 2 + 1).rgb;
+
+    vec3 toLight = positionRadius.xyz - FragPos;
+    float distance = length(toLight);
+
+    if (distance >= positionRadius.w) {
+        return vec3(0.0);
+    }
+
+    float falloff = 1.0 - distance / positionRadius.w;
+    return color * falloff * falloff * max(dot(normal, toLight / max(distance, 0.0001)), 0.0);
+}
+
+// GLSL 3.30 only indexes sampler arrays with constants, hence the branches.
+vec3 albedo() {
+    int array = int(materialDiffuse.x) - 1;
+    vec3 coords = vec3(TexCoords, materialDiffuse.y);
+
+    if (array == 0) {
+        return texture(materialArrays[0], coords).rgb;
+    } else if (array == 1) {
+        return texture(materialArrays[1], coords).rgb;
+    } else if (array == 2) {
+        return texture(materialArrays[2], coords).rgb;
+    } else if (array == 3) {
+        return texture(materialArrays[3], coords).rgb;
+    }
+
+    return ALBEDO;
+}
+
+float sunShadow(vec3 normal, float depth) {
+    int cascade = 0;
+    while (cascade < cascadeCount && depth > cascadeSplits[cascade]) {
+        cascade++;
+    }
+
+    if (cascade == cascadeCount) {
+        return 1.0;
+    }
+
+    // A small push along the normal keeps surfaces facing away from the light from shadowing themselves.
+    vec4 position = cascadeMatrices[cascade] * vec4(FragPos + normal * 0.05, 1.0);
+    vec3 coords = position.xyz / position.w * 0.5 + 0.5;
+
+    return texture(shadowMap, vec4(coords.xy, float(cascade), coords.z));
+}
+
 void main() {
-    FragColor = vec4(0.01);
+    if (lightingMode == 0 && !shadowsEnabled) {
+        FragColor = vec4(0.01);
+        return;
+    }
+
+    vec3 normal = normalize(Normal);
+    vec3 light = vec3(0.0);
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+
+    if (shadowsEnabled) {
+        light += SUN_COLOR * max(dot(normal, -sunDirection), 0.0) * sunShadow(normal, depth);
+    }
+
+    if (lightingMode == 1) {
+        ivec3 grid = ivec3(clusterGrid);
+
+        int slice = clamp(int(log(max(depth, clusterDepth.x) / clusterDepth.x) * clusterDepth.y), 0, grid.z - 1);
+        ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterScale), ivec2(0), grid.xy - 1);
+
+        uvec2 range = texelFetch(lightGrid, (slice * grid.y + tile.y) * grid.x + tile.x).rg;
+
+        for (uint i = 0u; i < range.y; i++) {
+            light += shade(int(texelFetch(lightIndices, int(range.x + i)).r), normal);
+        }
+    } else if (lightingMode == 2) {
+        for (int i = 0; i < lightCount; i++) {
+            light += shade(i, normal);
+        }
+    }
+
+    FragColor = vec4(vec3(0.01) + albedo() * light, 1.0);
 }
\ No newline at end of file
@@ -4,13 +4,35 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in mat4 aModel;
+layout (location = 7) in uint aInstanceID;
 
 out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
 
 uniform mat4 view;
 uniform mat4 projection;
 
+// When set, every transform stays resident in a buffer texture and only the instance ID is streamed.
+uniform bool indirectInstances;
+uniform samplerBuffer transforms;
+
+mat4 instanceTransform() {
+    if (!indirectInstances) {
+        return aModel;
+    }
+
+    int base = int(aInstanceID) * 4;
+    return mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+}
+
 void main() {
+    mat4 model = instanceTransform();
+    vec4 world = model * vec4(aPos, 1.0);
+
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+    FragPos = world.xyz;
+    // Instances are only scaled uniformly, so the model matrix carries normals as they are.
+    Normal = mat3(model) * aNormal;
+    gl_Position = projection * view * world;
 }
\ No newline at end of file
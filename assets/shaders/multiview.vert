@@ -0,0 +1,31 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in uint aInstanceID;
+
+out vec2 vTexCoords;
+out vec3 vNormal;
+
+uniform bool indirectInstances;
+uniform samplerBuffer transforms;
+
+mat4 instanceTransform() {
+    if (!indirectInstances) {
+        return aModel;
+    }
+
+    int base = int(aInstanceID) * 4;
+    return mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+}
+
+// World space only; multiview.geom applies each view's camera.
+void main() {
+    mat4 model = instanceTransform();
+
+    vTexCoords = aTexCoords;
+    vNormal = mat3(model) * aNormal;
+    gl_Position = model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightViewProjection;
+
+// Instance indices of this cascade's casters, and the resident transform of every instance.
+uniform usamplerBuffer casters;
+uniform samplerBuffer transforms;
+
+void main() {
+    int base = int(texelFetch(casters, gl_InstanceID).r) * 4;
+    mat4 model = mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+
+    gl_Position = lightViewProjection * model * vec4(aPos, 1.0);
+}
\ No newline at end of file
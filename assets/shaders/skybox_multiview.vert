@@ -0,0 +1,10 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+out vec3 vTexCoords;
+
+void main() {
+    vTexCoords = aPos;
+    gl_Position = vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,639 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "harness.hpp"
+#include "synthetic.hpp"
+
+#include "arena.hpp"
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "frustum.hpp"
+#include "lattice.hpp"
+#include "lights.hpp"
+#include "lod.hpp"
+#include "meshlet.hpp"
+#include "model.hpp"
+#include "parallel.hpp"
+#include "registry.hpp"
+#include "shader.hpp"
+
+// Micro-benchmarks of the CPU-side hot paths. Everything except the shader and light cases runs without a
+// GL context; those get a hidden window when one can be created and are reported as skipped otherwise.
+//
+//   HelloInstanceRenderingBench [--json results.json] [--label <commit>] [--filter <substring>]
+//                               [--samples N] [--warmup-ms N] [--min-sample-ms N] [--no-gl]
+
+GLFWwindow* create_hidden_context();
+std::string write_gltf_scene(const std::filesystem::path& directory, unsigned int groups, unsigned int meshesPerGroup, unsigned int rings, unsigned int segments);
+void bench_lattice(BenchRunner& runner);
+void bench_geometry(BenchRunner& runner);
+void bench_import(BenchRunner& runner);
+void bench_camera(BenchRunner& runner);
+void bench_culling(BenchRunner& runner);
+void bench_bvh(BenchRunner& runner);
+void bench_meshlets(BenchRunner& runner);
+void bench_registry(BenchRunner& runner);
+void bench_shader(BenchRunner& runner);
+void bench_lights(BenchRunner& runner);
+
+// The lattice main.cpp renders: 100 x 100 x 100 cubes 5 units apart at a tenth of their size.
+const LatticeDesc LATTICE = [] {
+    LatticeDesc desc;
+    desc.spacing = glm::vec3(5.0f, 5.0f, -5.0f);
+    desc.dims = glm::uvec3(100, 100, 100);
+    desc.scale = 0.1f;
+    return desc;
+}();
+
+// Roughly the bounds of the cube model the lattice instances.
+const BoundingSphere CUBE_BOUNDS = { glm::vec3(0.0f), 1.75f };
+
+int main(int argc, char** argv) {
+    BenchSettings settings;
+    std::string jsonPath = "bench_results.json";
+    std::string label;
+    bool useGl = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::string(argv[i]) == "--label" && i + 1 < argc) {
+            label = argv[++i];
+        } else if (std::string(argv[i]) == "--filter" && i + 1 < argc) {
+            settings.filter = argv[++i];
+        } else if (std::string(argv[i]) == "--samples" && i + 1 < argc) {
+            settings.samples = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::string(argv[i]) == "--warmup-ms" && i + 1 < argc) {
+            settings.warmupMs = std::max(std::atof(argv[++i]), 0.0);
+        } else if (std::string(argv[i]) == "--min-sample-ms" && i + 1 < argc) {
+            settings.minSampleMs = std::max(std::atof(argv[++i]), 0.0);
+        } else if (std::string(argv[i]) == "--no-gl") {
+            useGl = false;
+        } else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    BenchRunner runner(settings);
+
+    bench_lattice(runner);
+    bench_geometry(runner);
+    bench_import(runner);
+    bench_camera(runner);
+    bench_culling(runner);
+    bench_bvh(runner);
+    bench_meshlets(runner);
+    bench_registry(runner);
+
+    GLFWwindow* window = useGl ? create_hidden_context() : nullptr;
+
+    if (window) {
+        bench_shader(runner);
+        bench_lights(runner);
+
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    } else {
+        const std::string reason = useGl ? "no GL context" : "--no-gl";
+
+        runner.Skip("shader/set_mat4", reason);
+        runner.Skip("shader/set_vec2", reason);
+        runner.Skip("shader/set_missing", reason);
+        runner.Skip("lights/cluster_build_1k", reason);
+    }
+
+    return runner.WriteJson(jsonPath, label) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+GLFWwindow* create_hidden_context() {
+    if (!glfwInit()) {
+        return nullptr;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmarks", nullptr, nullptr);
+
+    if (!window) {
+        glfwTerminate();
+        return nullptr;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+
+    return window;
+}
+
+void bench_lattice(BenchRunner& runner) {
+    const size_t count = static_cast<size_t>(LATTICE.dims.x) * LATTICE.dims.y * LATTICE.dims.z;
+
+    runner.Run("lattice/build_1m", count, [] {
+        std::vector<glm::mat4> matrices = BuildLatticeMatrices(LATTICE);
+        KeepAlive(matrices.data());
+    });
+}
+
+void bench_geometry(BenchRunner& runner) {
+    const LodSettings lodSettings;
+
+    // A light mesh below the clustering threshold and a heavy one that gets meshlets as well as its LOD chain.
+    const unsigned int sizes[][2] = { { 16, 32 }, { 64, 128 } };
+
+    for (const unsigned int (&size)[2] : sizes) {
+        const std::string name = "mesh/build_geometry_" + std::to_string(2 * size[0] * size[1] / 1000) + "k";
+
+        if (!runner.Selected(name)) {
+            continue;
+        }
+
+        aiMesh* mesh = create_sphere_mesh(size[0], size[1]);
+        ScratchArena arena;
+
+        runner.Run(name, mesh->mNumFaces, [&] {
+            MeshGeometry geometry = Model::BuildGeometry(*mesh, lodSettings, arena);
+            KeepAlive(geometry.indices.data());
+        });
+
+        delete mesh;
+    }
+}
+
+// Writes a glTF scene of groups x meshesPerGroup UV spheres, each its own mesh placed by its own node under a
+// group node, with translations, rotations and scales to flatten. Returns the path of the .gltf file.
+std::string write_gltf_scene(const std::filesystem::path& directory, unsigned int groups, unsigned int meshesPerGroup, unsigned int rings, unsigned int segments) {
+    aiMesh* sphere = create_sphere_mesh(rings, segments);
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    std::vector<unsigned int> indices;
+
+    for (unsigned int i = 0; i < sphere->mNumVertices; i++) {
+        positions.insert(positions.end(), { sphere->mVertices[i].x, sphere->mVertices[i].y, sphere->mVertices[i].z });
+        normals.insert(normals.end(), { sphere->mNormals[i].x, sphere->mNormals[i].y, sphere->mNormals[i].z });
+        texCoords.insert(texCoords.end(), { sphere->mTextureCoords[0][i].x, sphere->mTextureCoords[0][i].y });
+    }
+
+    for (unsigned int i = 0; i < sphere->mNumFaces; i++) {
+        indices.insert(indices.end(), sphere->mFaces[i].mIndices, sphere->mFaces[i].mIndices + 3);
+    }
+
+    const size_t vertexCount = sphere->mNumVertices;
+    delete sphere;
+
+    std::filesystem::create_directories(directory);
+
+    const size_t views[4] = { positions.size() * sizeof(float), normals.size() * sizeof(float), texCoords.size() * sizeof(float), indices.size() * sizeof(unsigned int) };
+
+    {
+        std::ofstream bin(directory / "scene.bin", std::ios::binary);
+        bin.write(reinterpret_cast<const char*>(positions.data()), static_cast<std::streamsize>(views[0]));
+        bin.write(reinterpret_cast<const char*>(normals.data()), static_cast<std::streamsize>(views[1]));
+        bin.write(reinterpret_cast<const char*>(texCoords.data()), static_cast<std::streamsize>(views[2]));
+        bin.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(views[3]));
+    }
+
+    const unsigned int meshCount = groups * meshesPerGroup;
+    std::ostringstream json;
+
+    json << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+
+    for (unsigned int g = 0; g < groups; g++) {
+        json << (g ? "," : "") << g;
+    }
+
+    json << "]}],\"nodes\":[";
+
+    // Group nodes first, then every mesh node, so node groups + m places mesh m.
+    for (unsigned int g = 0; g < groups; g++) {
+        json << (g ? "," : "") << "{\"translation\":[" << g * 10.0f << ",0,0],\"children\":[";
+
+        for (unsigned int m = 0; m < meshesPerGroup; m++) {
+            json << (m ? "," : "") << groups + g * meshesPerGroup + m;
+        }
+
+        json << "]}";
+    }
+
+    for (unsigned int m = 0; m < meshCount; m++) {
+        const float angle = 0.3f * static_cast<float>(m % meshesPerGroup);
+
+        json << ",{\"mesh\":" << m << ",\"translation\":[0," << (m % meshesPerGroup) * 3.0f << ",0],"
+             << "\"rotation\":[0," << std::sin(angle / 2.0f) << ",0," << std::cos(angle / 2.0f) << "],\"scale\":[0.5,0.5,0.5]}";
+    }
+
+    json << "],\"meshes\":[";
+
+    for (unsigned int m = 0; m < meshCount; m++) {
+        json << (m ? "," : "") << "{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}";
+    }
+
+    json << "],\"buffers\":[{\"uri\":\"scene.bin\",\"byteLength\":" << views[0] + views[1] + views[2] + views[3] << "}],\"bufferViews\":[";
+
+    size_t offset = 0;
+
+    for (unsigned int v = 0; v < 4; v++) {
+        json << (v ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << views[v] << "}";
+        offset += views[v];
+    }
+
+    json << "],\"accessors\":["
+         << "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},"
+         << "{\"bufferView\":1,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+         << "{\"bufferView\":2,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC2\"},"
+         << "{\"bufferView\":3,\"componentType\":5125,\"count\":" << indices.size() << ",\"type\":\"SCALAR\"}]}";
+
+    const std::filesystem::path path = directory / "scene.gltf";
+    std::ofstream(path) << json.str();
+
+    return path.string();
+}
+
+// Model::ImportScene on a few hundred meshes at several pool sizes. Reading the file stays on one thread, so
+// the speedup is capped by how much of the import that is.
+void bench_import(BenchRunner& runner) {
+    if (!runner.Selected("import/")) {
+        return;
+    }
+
+    constexpr unsigned int GROUPS = 20;
+    constexpr unsigned int MESHES_PER_GROUP = 15;
+
+    const std::string path = write_gltf_scene(std::filesystem::temp_directory_path() / "instance_rendering_import_bench", GROUPS, MESHES_PER_GROUP, 24, 48);
+    const LodSettings lodSettings;
+
+    const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned int> threadCounts;
+
+    for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+
+    threadCounts.push_back(hardwareThreads);
+
+    for (unsigned int threads : threadCounts) {
+        // The caller is one of the pool's threads.
+        ThreadPool pool(threads - 1);
+
+        runner.Run("import/gltf_" + std::to_string(GROUPS * MESHES_PER_GROUP) + "_meshes_" + std::to_string(threads) + "t", GROUPS * MESHES_PER_GROUP, [&] {
+            ImportedScene scene;
+            Model::ImportScene(path, lodSettings, &pool, scene);
+            KeepAlive(scene.geometry.data());
+        });
+    }
+}
+
+void bench_camera(BenchRunner& runner) {
+    Camera camera(glm::vec3(250.0f, 250.0f, 300.0f));
+
+    runner.Run("camera/view_matrix", 1, [&] {
+        glm::mat4 view = camera.GetViewMatrix();
+        KeepAlive(view);
+    });
+
+    // ProcessMouseMovement is the public way into updateCameraVectors. The offsets alternate so the pitch
+    // never reaches its clamp.
+    float offset = 1.0f;
+
+    runner.Run("camera/mouse_look", 1, [&] {
+        camera.ProcessMouseMovement(offset, offset);
+        offset = -offset;
+        KeepAlive(camera);
+    });
+}
+
+void bench_culling(BenchRunner& runner) {
+    if (!runner.Selected("cull/")) {
+        return;
+    }
+
+    const std::vector<glm::mat4> matrices = BuildLatticeMatrices(LATTICE);
+    const LodSettings lodSettings;
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+
+    // From the lattice face and from its middle, alternating so every update has a new visible set to sort.
+    const glm::mat4 views[2] = {
+        glm::lookAt(glm::vec3(250.0f, 250.0f, 300.0f), glm::vec3(250.0f, 250.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        glm::lookAt(glm::vec3(250.0f, 250.0f, -250.0f), glm::vec3(250.0f, 250.0f, -500.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+    };
+
+    LodSelector selector;
+    selector.SetInstances(matrices, CUBE_BOUNDS);
+
+    unsigned int frame = 0;
+
+    runner.Run("cull/lod_select_1m", matrices.size(), [&] {
+        selector.Update(views[frame++ % 2], projection, 600.0f, lodSettings.levels + 1, lodSettings, true, true);
+        KeepAlive(selector.GetResult());
+    });
+
+    const Frustum frustum(projection * views[0]);
+    const std::vector<glm::vec4>& spheres = selector.GetSpheres();
+
+    runner.Run("cull/frustum_spheres_1m", spheres.size(), [&] {
+        unsigned int inside = 0;
+
+        for (const glm::vec4& sphere : spheres) {
+            inside += frustum.Intersects(glm::vec3(sphere), sphere.w);
+        }
+
+        KeepAlive(inside);
+    });
+}
+
+void bench_bvh(BenchRunner& runner) {
+    if (!runner.Selected("bvh/")) {
+        return;
+    }
+
+    LodSelector selector;
+    selector.SetInstances(BuildLatticeMatrices(LATTICE), CUBE_BOUNDS);
+    const std::vector<glm::vec4>& spheres = selector.GetSpheres();
+
+    InstanceBvh bvh;
+
+    runner.Run("bvh/build_1m", spheres.size(), [&] {
+        bvh.Build(spheres);
+    });
+
+    bvh.Build(spheres);
+
+    runner.Run("bvh/refit_1m", spheres.size(), [&] {
+        bvh.Refit(spheres);
+    });
+
+    // Rays from outside the lattice towards random points inside it, tested against the spheres alone.
+    constexpr unsigned int RAYS = 1000;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coordinate(0.0f, 495.0f);
+    std::vector<glm::vec3> directions(RAYS);
+    const glm::vec3 origin(250.0f, 250.0f, 300.0f);
+
+    for (glm::vec3& direction : directions) {
+        direction = glm::normalize(glm::vec3(coordinate(rng), coordinate(rng), -coordinate(rng)) - origin);
+    }
+
+    runner.Run("bvh/raycast_1k", RAYS, [&] {
+        long long hits = 0;
+
+        for (const glm::vec3& direction : directions) {
+            float distance = 0.0f;
+            hits += bvh.Raycast(origin, direction, 1000.0f, [](unsigned int, float entry) { return entry; }, distance) >= 0;
+        }
+
+        KeepAlive(hits);
+    });
+
+    std::vector<glm::vec3> origins(RAYS, origin);
+    std::vector<long long> results(RAYS);
+    std::vector<float> distances(RAYS);
+
+    runner.Run("bvh/raycast_batch_1k", RAYS, [&] {
+        bvh.RaycastBatch(origins.data(), directions.data(), RAYS, 1000.0f, [](size_t, unsigned int, float entry) { return entry; }, results.data(), distances.data());
+        KeepAlive(results.data());
+    });
+
+    // A pick through every pixel of a 128 x 128 view from the default camera, in scanline order, so
+    // neighbouring rays share most of their path through the tree.
+    constexpr unsigned int SCREEN = 128;
+    const float tanHalfFov = std::tan(glm::radians(22.5f));
+
+    std::vector<glm::vec3> screenDirections;
+    for (unsigned int y = 0; y < SCREEN; y++) {
+        for (unsigned int x = 0; x < SCREEN; x++) {
+            const float u = (2.0f * (x + 0.5f) / SCREEN - 1.0f) * tanHalfFov * 800.0f / 600.0f;
+            const float v = (2.0f * (y + 0.5f) / SCREEN - 1.0f) * tanHalfFov;
+            screenDirections.push_back(glm::normalize(glm::vec3(u, v, -1.0f)));
+        }
+    }
+
+    const std::vector<glm::vec3> screenOrigins(screenDirections.size(), origin);
+    results.resize(screenDirections.size());
+    distances.resize(screenDirections.size());
+
+    runner.Run("bvh/raycast_screen_16k", screenDirections.size(), [&] {
+        long long hits = 0;
+
+        for (const glm::vec3& direction : screenDirections) {
+            float distance = 0.0f;
+            hits += bvh.Raycast(origin, direction, 1000.0f, [](unsigned int, float entry) { return entry; }, distance) >= 0;
+        }
+
+        KeepAlive(hits);
+    });
+
+    runner.Run("bvh/raycast_screen_batch_16k", screenDirections.size(), [&] {
+        bvh.RaycastBatch(screenOrigins.data(), screenDirections.data(), screenDirections.size(), 1000.0f, [](size_t, unsigned int, float entry) { return entry; }, results.data(), distances.data());
+        KeepAlive(results.data());
+    });
+}
+
+void bench_meshlets(BenchRunner& runner) {
+    if (!runner.Selected("meshlet/")) {
+        return;
+    }
+
+    aiMesh* mesh = create_sphere_mesh(64, 128);
+    ScratchArena arena;
+
+    LodSettings noLods;
+    noLods.levels = 0;
+
+    MeshGeometry geometry = Model::BuildGeometry(*mesh, noLods, arena);
+    delete mesh;
+
+    // BuildMeshlets reorders the indices it is given, so each iteration starts from a fresh copy of them.
+    std::vector<unsigned int> indices;
+
+    runner.Run("meshlet/build_16k", geometry.indices.size() / 3, [&] {
+        indices = geometry.indices;
+        std::vector<Meshlet> meshlets = BuildMeshlets(geometry.vertices, indices, &arena);
+        arena.Reset();
+        KeepAlive(meshlets.data());
+    });
+
+    // The full-detail tier at its default limit: 256 instances along a row in front of the camera.
+    constexpr unsigned int INSTANCES = 256;
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+    const Frustum frustum(projection * view);
+    const glm::vec3 eye(0.0f, 0.0f, 10.0f);
+
+    std::vector<glm::mat4> matrices(INSTANCES);
+
+    for (unsigned int i = 0; i < INSTANCES; i++) {
+        matrices[i] = glm::translate(glm::mat4(1.0f), glm::vec3((static_cast<float>(i) - INSTANCES / 2.0f) * 0.5f, 0.0f, -static_cast<float>(i % 16)));
+    }
+
+    std::vector<DrawElementsCommand> commands;
+
+    runner.Run("meshlet/cull_256", INSTANCES * geometry.meshlets.size(), [&] {
+        MeshletCullStats stats;
+        commands.clear();
+
+        for (unsigned int i = 0; i < INSTANCES; i++) {
+            CullMeshlets(geometry.meshlets, matrices[i], frustum, eye, i, commands, stats);
+        }
+
+        KeepAlive(commands.data());
+    });
+
+    // A single mesh of about a million triangles, heavier than anything in assets. Its clusters are culled
+    // from an orbit of viewpoints that alternate between seeing the sphere whole and from close up.
+    if (!runner.Selected("meshlet/build_1m") && !runner.Selected("meshlet/cull_1m")) {
+        return;
+    }
+
+    constexpr unsigned int VIEWPOINTS = 16;
+
+    mesh = create_sphere_mesh(500, 1000);
+    MeshGeometry large = Model::BuildGeometry(*mesh, noLods, arena);
+    arena.Reset();
+    delete mesh;
+
+    runner.Run("meshlet/build_1m", large.indices.size() / 3, [&] {
+        indices = large.indices;
+        std::vector<Meshlet> meshlets = BuildMeshlets(large.vertices, indices, &arena);
+        arena.Reset();
+        KeepAlive(meshlets.data());
+    });
+
+    const glm::mat4 orbitProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f, 100.0f);
+    std::vector<Frustum> frustums;
+    std::vector<glm::vec3> eyes;
+
+    for (unsigned int v = 0; v < VIEWPOINTS; v++) {
+        const float angle = glm::two_pi<float>() * v / VIEWPOINTS;
+        const float distance = v % 2 == 0 ? 4.0f : 1.3f;
+
+        eyes.push_back(glm::vec3(std::cos(angle), 0.3f, std::sin(angle)) * distance);
+        frustums.emplace_back(orbitProjection * glm::lookAt(eyes.back(), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    unsigned int viewpoint = 0;
+
+    runner.Run("meshlet/cull_1m", large.meshlets.size(), [&] {
+        MeshletCullStats stats;
+        commands.clear();
+
+        const unsigned int v = viewpoint++ % VIEWPOINTS;
+        CullMeshlets(large.meshlets, glm::mat4(1.0f), frustums[v], eyes[v], 0, commands, stats);
+
+        KeepAlive(commands.data());
+    });
+}
+
+void bench_registry(BenchRunner& runner) {
+    if (!runner.Selected("registry/")) {
+        return;
+    }
+
+    // The churn main.cpp's --registry-bench applies: scattered writes coalesced into upload spans.
+    constexpr unsigned int WRITES = 10000;
+
+    InstanceRegistry registry;
+    registry.Assign(BuildLatticeMatrices(LATTICE));
+    registry.ClearDirty();
+
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<size_t> pick(0, registry.GetCount() - 1);
+    std::vector<InstanceHandle> handles(WRITES);
+
+    for (InstanceHandle& handle : handles) {
+        handle = registry.HandleAt(pick(rng));
+    }
+
+    const glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f));
+
+    runner.Run("registry/dirty_ranges_10k", WRITES, [&] {
+        for (const InstanceHandle& handle : handles) {
+            registry.Set(handle, matrix);
+        }
+
+        KeepAlive(registry.GetDirtyRanges().size());
+        registry.ClearDirty();
+    });
+}
+
+void bench_shader(BenchRunner& runner) {
+    if (!runner.Selected("shader/")) {
+        return;
+    }
+
+    // Run from the output directory, where the build copies the assets.
+    Shader shader("./assets/shaders/model.vert", nullptr, "./assets/shaders/model.frag");
+    shader.Use();
+
+    const glm::mat4 matrix(1.0f);
+
+    runner.Run("shader/set_mat4", 1, [&] {
+        shader.Set("view", matrix);
+    });
+
+    runner.Run("shader/set_vec2", 1, [&] {
+        shader.Set("materialDiffuse", glm::vec2(1.0f, 0.0f));
+    });
+
+    // Names the linker optimized out still cost the lookup.
+    runner.Run("shader/set_missing", 1, [&] {
+        shader.Set("notAUniform", 1.0f);
+    });
+}
+
+void bench_lights(BenchRunner& runner) {
+    if (!runner.Selected("lights/")) {
+        return;
+    }
+
+    constexpr unsigned int LIGHTS = 1000;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 495.0f);
+    std::vector<PointLight> lights(LIGHTS);
+
+    for (PointLight& light : lights) {
+        light.position = glm::vec3(position(rng), position(rng), -position(rng));
+    }
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(250.0f, 250.0f, 300.0f), glm::vec3(250.0f, 250.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+
+    ThreadPool pool;
+    LightClusters clusters;
+
+    runner.Run("lights/cluster_build_1k", LIGHTS, [&] {
+        clusters.Build(lights, view, projection, 0.1f, 1000.0f, pool);
+    });
+}
\ No newline at end of file
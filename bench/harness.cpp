@@ -0,0 +1,208 @@
+#include "harness.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    double median(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+
+        const size_t middle = values.size() / 2;
+        return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+    }
+
+    std::string escape(const std::string& text) {
+        std::string escaped;
+
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    std::string compiler() {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+
+    // Whichever unit keeps the figure between 1 and 1000.
+    std::string formatTime(double ns) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+
+        if (ns >= 1e6) {
+            text << ns / 1e6 << " ms";
+        } else if (ns >= 1e3) {
+            text << ns / 1e3 << " us";
+        } else {
+            text << ns << " ns";
+        }
+
+        return text.str();
+    }
+
+    void printHeader(std::ostream& out) {
+        out << std::left << std::setw(32) << "case" << std::right
+            << std::setw(14) << "median" << std::setw(14) << "min" << std::setw(10) << "MAD %"
+            << std::setw(16) << "items/s" << "\n";
+    }
+
+    void printRow(std::ostream& out, const BenchResult& result) {
+        out << std::left << std::setw(32) << result.name << std::right;
+
+        if (result.skipped) {
+            out << "  skipped: " << result.note << "\n";
+            return;
+        }
+
+        out << std::setw(14) << formatTime(result.medianNs) << std::setw(14) << formatTime(result.minNs)
+            << std::setw(10) << std::fixed << std::setprecision(2) << result.relativeMad * 100.0
+            << std::setw(16) << std::scientific << std::setprecision(3) << result.items * 1e9 / result.medianNs
+            << std::defaultfloat << std::endl;
+    }
+}
+
+BenchRunner::BenchRunner(const BenchSettings& settings) : m_Settings(settings) {
+    m_Settings.samples = std::max(m_Settings.samples, 1u);
+}
+
+bool BenchRunner::Selected(const std::string& name) const {
+    return m_Settings.filter.empty() || name.find(m_Settings.filter) != std::string::npos;
+}
+
+void BenchRunner::Skip(const std::string& name, const std::string& reason) {
+    if (!Selected(name)) {
+        return;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.skipped = true;
+    result.note = reason;
+
+    m_Results.push_back(result);
+
+    if (m_Results.size() == 1) {
+        printHeader(std::cout);
+    }
+
+    printRow(std::cout, result);
+}
+
+const std::vector<BenchResult>& BenchRunner::GetResults() const {
+    return m_Results;
+}
+
+bool BenchRunner::WriteJson(const std::string& path, const std::string& label) const {
+    std::ofstream file(path);
+
+    if (!file) {
+        std::cerr << "Could not write benchmark results to " << path << std::endl;
+        return false;
+    }
+
+    const std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    file << std::setprecision(10);
+    file << "{\n";
+    file << "  \"label\": \"" << escape(label) << "\",\n";
+    file << "  \"timestamp\": \"" << timestamp << "\",\n";
+    file << "  \"compiler\": \"" << escape(compiler()) << "\",\n";
+#if defined(NDEBUG)
+    file << "  \"optimized\": true,\n";
+#else
+    file << "  \"optimized\": false,\n";
+#endif
+    file << "  \"settings\": { \"warmup_ms\": " << m_Settings.warmupMs << ", \"samples\": " << m_Settings.samples
+         << ", \"min_sample_ms\": " << m_Settings.minSampleMs << " },\n";
+    file << "  \"results\": [";
+
+    for (size_t i = 0; i < m_Results.size(); i++) {
+        const BenchResult& result = m_Results[i];
+
+        file << (i ? ",\n" : "\n") << "    { \"name\": \"" << escape(result.name) << "\", ";
+
+        if (result.skipped) {
+            file << "\"skipped\": true, \"note\": \"" << escape(result.note) << "\" }";
+            continue;
+        }
+
+        file << "\"items\": " << result.items
+             << ", \"samples\": " << result.samples
+             << ", \"iterations_per_sample\": " << result.iterationsPerSample
+             << ", \"median_ns\": " << result.medianNs
+             << ", \"min_ns\": " << result.minNs
+             << ", \"mean_ns\": " << result.meanNs
+             << ", \"max_ns\": " << result.maxNs
+             << ", \"stddev_ns\": " << result.stddevNs
+             << ", \"relative_mad\": " << result.relativeMad
+             << ", \"items_per_second\": " << result.items * 1e9 / result.medianNs << " }";
+    }
+
+    file << "\n  ]\n}\n";
+
+    return static_cast<bool>(file);
+}
+
+void BenchRunner::record(const std::string& name, size_t items, unsigned long long iterations, const std::vector<double>& sampleNs) {
+    BenchResult result;
+    result.name = name;
+    result.items = std::max<size_t>(items, 1);
+    result.samples = static_cast<unsigned int>(sampleNs.size());
+    result.iterationsPerSample = iterations;
+
+    double sum = 0.0;
+
+    for (double ns : sampleNs) {
+        sum += ns;
+    }
+
+    result.meanNs = sum / sampleNs.size();
+    result.minNs = *std::min_element(sampleNs.begin(), sampleNs.end());
+    result.maxNs = *std::max_element(sampleNs.begin(), sampleNs.end());
+    result.medianNs = median(sampleNs);
+
+    double squares = 0.0;
+    std::vector<double> deviations;
+    deviations.reserve(sampleNs.size());
+
+    for (double ns : sampleNs) {
+        squares += (ns - result.meanNs) * (ns - result.meanNs);
+        deviations.push_back(std::abs(ns - result.medianNs));
+    }
+
+    result.stddevNs = sampleNs.size() > 1 ? std::sqrt(squares / (sampleNs.size() - 1)) : 0.0;
+    result.relativeMad = result.medianNs > 0.0 ? median(deviations) / result.medianNs : 0.0;
+
+    m_Results.push_back(result);
+
+    // Long suites report as they go.
+    if (m_Results.size() == 1) {
+        printHeader(std::cout);
+    }
+
+    printRow(std::cout, result);
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BenchSettings {
+    // Time spent running a case before anything is recorded, so caches, the allocator and branch predictors
+    // have settled.
+    double warmupMs = 200.0;
+    // Samples recorded per case. Each sample repeats the body until it has run for at least minSampleMs,
+    // which keeps timer resolution out of the numbers for very short bodies.
+    unsigned int samples = 15;
+    double minSampleMs = 20.0;
+    // Only cases whose name contains this run; empty runs everything.
+    std::string filter;
+};
+
+// Per-iteration statistics of one case, in nanoseconds.
+struct BenchResult {
+    std::string name;
+    // Work items one iteration processes, such as instances or triangles, for the throughput figure.
+    size_t items = 1;
+    unsigned int samples = 0;
+    unsigned long long iterationsPerSample = 0;
+    double minNs = 0.0;
+    double medianNs = 0.0;
+    double meanNs = 0.0;
+    double maxNs = 0.0;
+    double stddevNs = 0.0;
+    // Median absolute deviation relative to the median, a noise figure that one slow sample can't skew.
+    double relativeMad = 0.0;
+    bool skipped = false;
+    std::string note;
+};
+
+// Keeps the compiler from proving a benchmarked result unused and deleting the work behind it.
+template <typename T>
+inline void KeepAlive(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Minimal micro-benchmark runner: warm-up, calibrated repetitions, several samples per case and robust
+// statistics. Each case is printed as it finishes, and the whole run can be written as JSON for comparing builds.
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchSettings& settings = BenchSettings());
+
+    bool Selected(const std::string& name) const;
+
+    // Times body, which performs one iteration. Cases the filter leaves out are not run.
+    template <typename Body>
+    void Run(const std::string& name, size_t items, Body&& body);
+
+    // Records a case that could not run here, such as one needing a GL context, so the JSON still lists it.
+    void Skip(const std::string& name, const std::string& reason);
+
+    const std::vector<BenchResult>& GetResults() const;
+    // label tags the run, typically with the commit it was built from. Returns false when the file can't be written.
+    bool WriteJson(const std::string& path, const std::string& label) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    BenchSettings m_Settings;
+    std::vector<BenchResult> m_Results;
+
+    void record(const std::string& name, size_t items, unsigned long long iterations, const std::vector<double>& sampleNs);
+};
+
+template <typename Body>
+void BenchRunner::Run(const std::string& name, size_t items, Body&& body) {
+    if (!Selected(name)) {
+        return;
+    }
+
+    // Warm up, doubling the batch while it is shorter than a sample so the last one calibrates the repetitions.
+    unsigned long long batch = 1;
+    unsigned long long lastBatch = 1;
+    double lastMs = 0.0;
+    double warmedMs = 0.0;
+
+    do {
+        const Clock::time_point start = Clock::now();
+
+        for (unsigned long long i = 0; i < batch; i++) {
+            body();
+        }
+
+        lastMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        lastBatch = batch;
+        warmedMs += lastMs;
+
+        if (lastMs < m_Settings.minSampleMs) {
+            batch *= 2;
+        }
+    } while (warmedMs < m_Settings.warmupMs);
+
+    const double perIterationMs = std::max(lastMs / static_cast<double>(lastBatch), 1e-9);
+    const unsigned long long iterations = std::max<unsigned long long>(1, static_cast<unsigned long long>(m_Settings.minSampleMs / perIterationMs));
+
+    std::vector<double> sampleNs;
+    sampleNs.reserve(m_Settings.samples);
+
+    for (unsigned int sample = 0; sample < m_Settings.samples; sample++) {
+        const Clock::time_point start = Clock::now();
+
+        for (unsigned long long i = 0; i < iterations; i++) {
+            body();
+        }
+
+        const double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        sampleNs.push_back(elapsedNs / static_cast<double>(iterations));
+    }
+
+    record(name, items, iterations, sampleNs);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "synthetic.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+aiMesh* create_sphere_mesh(unsigned int rings, unsigned int segments) {
+    aiMesh* mesh = new aiMesh();
+
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices = (rings + 1) * (segments + 1);
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+    mesh->mNumUVComponents[0] = 2;
+
+    for (unsigned int ring = 0; ring <= rings; ring++) {
+        for (unsigned int segment = 0; segment <= segments; segment++) {
+            const unsigned int index = ring * (segments + 1) + segment;
+            const float theta = glm::pi<float>() * ring / rings;
+            const float phi = 2.0f * glm::pi<float>() * segment / segments;
+
+            mesh->mVertices[index] = aiVector3D(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            mesh->mNormals[index] = mesh->mVertices[index];
+            mesh->mTextureCoords[0][index] = aiVector3D(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings, 0.0f);
+        }
+    }
+
+    mesh->mNumFaces = 2 * rings * segments;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+
+    unsigned int face = 0;
+
+    for (unsigned int ring = 0; ring < rings; ring++) {
+        for (unsigned int segment = 0; segment < segments; segment++) {
+            const unsigned int top = ring * (segments + 1) + segment;
+            const unsigned int bottom = top + segments + 1;
+            const unsigned int quad[2][3] = { { top, bottom, top + 1 }, { top + 1, bottom, bottom + 1 } };
+
+            for (const unsigned int (&triangle)[3] : quad) {
+                mesh->mFaces[face].mNumIndices = 3;
+                mesh->mFaces[face].mIndices = new unsigned int[3] { triangle[0], triangle[1], triangle[2] };
+                face++;
+            }
+        }
+    }
+
+    return mesh;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <assimp/scene.h>
+
+// Test geometry shared by the benchmarks and the tests, built in memory so neither needs an asset on disk.
+
+// UV sphere as assimp would hand it to Model::BuildGeometry, with 2 * rings * segments triangles.
+aiMesh* create_sphere_mesh(unsigned int rings, unsigned int segments);
\ No newline at end of file
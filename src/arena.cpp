@@ -0,0 +1,96 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+ScratchArena::ScratchArena(size_t initialBytes) {
+    if (initialBytes > 0) {
+        addBlock(initialBytes);
+    }
+}
+
+ScratchArena::~ScratchArena() {
+    for (Block& block : m_Blocks) {
+        ::operator delete(block.data);
+    }
+}
+
+void ScratchArena::Reset() {
+    // Several blocks mean the last round outgrew the first; one block of their combined size fits it next time.
+    if (m_Blocks.size() > 1) {
+        size_t total = 0;
+
+        for (Block& block : m_Blocks) {
+            total += block.size;
+            ::operator delete(block.data);
+        }
+
+        m_Blocks.clear();
+        addBlock(total);
+    }
+
+    m_Offset = 0;
+    m_Used = 0;
+}
+
+size_t ScratchArena::GetUsed() const {
+    return m_Used;
+}
+
+size_t ScratchArena::GetCapacity() const {
+    size_t total = 0;
+
+    for (const Block& block : m_Blocks) {
+        total += block.size;
+    }
+
+    return total;
+}
+
+size_t ScratchArena::GetPeak() const {
+    return m_Peak;
+}
+
+void ScratchArena::addBlock(size_t size) {
+    m_Blocks.push_back({ static_cast<std::byte*>(::operator new(size)), size });
+    m_Offset = 0;
+}
+
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment) {
+    bytes = std::max<size_t>(bytes, 1);
+
+    auto fits = [&](size_t& start) {
+        if (m_Blocks.empty()) {
+            return false;
+        }
+
+        const Block& block = m_Blocks.back();
+        const uintptr_t address = reinterpret_cast<uintptr_t>(block.data) + m_Offset;
+        start = m_Offset + ((alignment - address % alignment) % alignment);
+
+        return start + bytes <= block.size;
+    };
+
+    size_t start = 0;
+
+    if (!fits(start)) {
+        // Blocks double so a large import settles into a handful of them, and so into one after a Reset.
+        const size_t previous = m_Blocks.empty() ? 0 : m_Blocks.back().size;
+        addBlock(std::max({ bytes + alignment, previous * 2, MIN_BLOCK_SIZE }));
+        fits(start);
+    }
+
+    m_Offset = start + bytes;
+    m_Used += bytes;
+    m_Peak = std::max(m_Peak, m_Used);
+
+    return m_Blocks.back().data + start;
+}
+
+void ScratchArena::do_deallocate(void*, size_t, size_t) {
+}
+
+bool ScratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for short-lived scratch, such as the working buffers of one mesh import. Freeing is a no-op;
+// Reset rewinds everything at once and keeps the memory for the next round, merged into a single block so a
+// repeated workload stops touching the heap after its first pass. Not thread-safe.
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    explicit ScratchArena(size_t initialBytes = 0);
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // Everything allocated since the last Reset must be dead by now.
+    void Reset();
+
+    size_t GetUsed() const;
+    size_t GetCapacity() const;
+    // Most bytes handed out between two Resets.
+    size_t GetPeak() const;
+
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+    struct Block {
+        std::byte* data;
+        size_t size;
+    };
+
+    std::vector<Block> m_Blocks;
+    size_t m_Offset = 0;
+    size_t m_Used = 0;
+    size_t m_Peak = 0;
+
+    void addBlock(size_t size);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
\ No newline at end of file
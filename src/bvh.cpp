@@ -0,0 +1,425 @@
+#include "bvh.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace {
+    constexpr float INF = std::numeric_limits<float>::infinity();
+
+    float surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+        const glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+}
+
+void InstanceBvh::Build(const std::vector<glm::vec4>& spheres) {
+    auto start = std::chrono::steady_clock::now();
+
+    m_Nodes.clear();
+    m_Stats = BvhStats();
+
+    m_Indices.resize(spheres.size());
+    m_Centers.resize(spheres.size());
+    for (size_t i = 0; i < spheres.size(); i++) {
+        m_Indices[i] = static_cast<unsigned int>(i);
+        m_Centers[i] = glm::vec3(spheres[i]);
+    }
+
+    m_Spheres = spheres;
+
+    if (!spheres.empty()) {
+        buildNode(bound(0, static_cast<unsigned int>(spheres.size())), 1);
+    }
+
+    // Builds work on the original order; afterwards the spheres are stored in leaf order so leaves read
+    // them contiguously.
+    for (size_t i = 0; i < m_Indices.size(); i++) {
+        m_Spheres[i] = spheres[m_Indices[i]];
+    }
+
+    m_Centers.clear();
+    m_Centers.shrink_to_fit();
+
+    m_Stats.nodes = m_Nodes.size();
+    m_Stats.buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    Refit(spheres);
+    m_Stats.refitMs = 0.0f;
+}
+
+void InstanceBvh::Refit(const std::vector<glm::vec4>& spheres) {
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < m_Indices.size(); i++) {
+        m_Spheres[i] = spheres[m_Indices[i]];
+    }
+
+    glm::vec3 min;
+    glm::vec3 max;
+    float cost = 0.0f;
+    refitNode(0, min, max, cost);
+
+    const float rootArea = surfaceArea(min, max);
+    m_Stats.cost = rootArea > 0.0f ? cost / rootArea : 0.0f;
+    m_Stats.refitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void InstanceBvh::QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const {
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    unsigned int stack[MAX_DEPTH * WIDTH];
+    unsigned int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = m_Nodes[stack[--top]];
+
+        bool overlap[WIDTH];
+        for (unsigned int lane = 0; lane < WIDTH; lane++) {
+            overlap[lane] = node.minX[lane] <= max.x && node.maxX[lane] >= min.x
+                         && node.minY[lane] <= max.y && node.maxY[lane] >= min.y
+                         && node.minZ[lane] <= max.z && node.maxZ[lane] >= min.z;
+        }
+
+        for (unsigned int lane = 0; lane < WIDTH; lane++) {
+            if (!overlap[lane]) {
+                continue;
+            }
+
+            if (node.count[lane] == 0) {
+                stack[top++] = node.child[lane];
+                continue;
+            }
+
+            for (unsigned int i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++) {
+                const glm::vec3 center(m_Spheres[i]);
+                const glm::vec3 closest = glm::clamp(center, min, max);
+                const glm::vec3 offset = center - closest;
+
+                if (glm::dot(offset, offset) <= m_Spheres[i].w * m_Spheres[i].w) {
+                    result.push_back(m_Indices[i]);
+                }
+            }
+        }
+    }
+}
+
+void InstanceBvh::QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const {
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    unsigned int stack[MAX_DEPTH * WIDTH];
+    unsigned int top = 0;
+    stack[top++] = 0;
+
+    const float radiusSquared = radius * radius;
+
+    while (top > 0) {
+        const Node& node = m_Nodes[stack[--top]];
+
+        // Squared distance from the centre to each lane's box.
+        float distance[WIDTH];
+        for (unsigned int lane = 0; lane < WIDTH; lane++) {
+            const float dx = std::max(std::max(node.minX[lane] - center.x, center.x - node.maxX[lane]), 0.0f);
+            const float dy = std::max(std::max(node.minY[lane] - center.y, center.y - node.maxY[lane]), 0.0f);
+            const float dz = std::max(std::max(node.minZ[lane] - center.z, center.z - node.maxZ[lane]), 0.0f);
+            distance[lane] = dx * dx + dy * dy + dz * dz;
+        }
+
+        for (unsigned int lane = 0; lane < WIDTH; lane++) {
+            if (node.child[lane] == EMPTY || distance[lane] > radiusSquared) {
+                continue;
+            }
+
+            if (node.count[lane] == 0) {
+                stack[top++] = node.child[lane];
+                continue;
+            }
+
+            for (unsigned int i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++) {
+                const float reach = radius + m_Spheres[i].w;
+                const glm::vec3 offset = glm::vec3(m_Spheres[i]) - center;
+
+                if (glm::dot(offset, offset) <= reach * reach) {
+                    result.push_back(m_Indices[i]);
+                }
+            }
+        }
+    }
+}
+
+size_t InstanceBvh::GetCount() const {
+    return m_Indices.size();
+}
+
+const BvhStats& InstanceBvh::GetStats() const {
+    return m_Stats;
+}
+
+// Gives a node up to WIDTH children by repeatedly splitting whichever child has the largest surface area,
+// then recurses into the children that are still too big to be leaves.
+unsigned int InstanceBvh::buildNode(Range range, unsigned int depth) {
+    const unsigned int index = static_cast<unsigned int>(m_Nodes.size());
+    m_Nodes.emplace_back();
+
+    m_Stats.depth = std::max(m_Stats.depth, depth);
+
+    Range children[WIDTH];
+    unsigned int childCount = 1;
+    children[0] = range;
+
+    while (childCount < WIDTH) {
+        int largest = -1;
+        float largestArea = -1.0f;
+
+        for (unsigned int c = 0; c < childCount; c++) {
+            float area = surfaceArea(children[c].min, children[c].max);
+
+            if (children[c].count > MAX_LEAF_SIZE && area > largestArea) {
+                largest = static_cast<int>(c);
+                largestArea = area;
+            }
+        }
+
+        if (largest < 0) {
+            break;
+        }
+
+        Range left;
+        Range right;
+        split(children[largest], left, right);
+
+        children[largest] = left;
+        children[childCount++] = right;
+    }
+
+    for (unsigned int lane = 0; lane < WIDTH; lane++) {
+        unsigned int child = EMPTY;
+        unsigned int count = 0;
+
+        if (lane < childCount) {
+            const Range& range = children[lane];
+
+            if (range.count > MAX_LEAF_SIZE && depth < MAX_DEPTH - 1) {
+                child = buildNode(range, depth + 1);
+            } else {
+                child = range.first;
+                count = range.count;
+                m_Stats.leaves++;
+            }
+        }
+
+        // Boxes are filled in by the refit that follows every build.
+        Node& node = m_Nodes[index];
+        node.child[lane] = child;
+        node.count[lane] = count;
+    }
+
+    return index;
+}
+
+// Partitions a range at the cheapest of the bin boundaries on each axis, falling back to the median of the
+// longest axis when every centre falls in the same bin.
+bool InstanceBvh::split(const Range& range, Range& left, Range& right) {
+    glm::vec3 centerMin(INF);
+    glm::vec3 centerMax(-INF);
+
+    for (unsigned int i = range.first; i < range.first + range.count; i++) {
+        centerMin = glm::min(centerMin, m_Centers[m_Indices[i]]);
+        centerMax = glm::max(centerMax, m_Centers[m_Indices[i]]);
+    }
+
+    const glm::vec3 extent = centerMax - centerMin;
+
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+    float bestCost = INF;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+
+        const float scale = BINS / extent[axis];
+
+        glm::vec3 binMin[BINS];
+        glm::vec3 binMax[BINS];
+        unsigned int binCount[BINS] = {};
+
+        for (unsigned int b = 0; b < BINS; b++) {
+            binMin[b] = glm::vec3(INF);
+            binMax[b] = glm::vec3(-INF);
+        }
+
+        for (unsigned int i = range.first; i < range.first + range.count; i++) {
+            const unsigned int instance = m_Indices[i];
+            const glm::vec4& sphere = m_Spheres[instance];
+            const unsigned int b = std::min(static_cast<unsigned int>((m_Centers[instance][axis] - centerMin[axis]) * scale), BINS - 1);
+
+            binMin[b] = glm::min(binMin[b], glm::vec3(sphere) - sphere.w);
+            binMax[b] = glm::max(binMax[b], glm::vec3(sphere) + sphere.w);
+            binCount[b]++;
+        }
+
+        // Sweep from the right to get the area and count of every suffix, then from the left to score each
+        // boundary.
+        float rightArea[BINS];
+        unsigned int rightCount[BINS];
+        glm::vec3 sweepMin(INF);
+        glm::vec3 sweepMax(-INF);
+        unsigned int sweepCount = 0;
+
+        for (unsigned int b = BINS - 1; b > 0; b--) {
+            sweepMin = glm::min(sweepMin, binMin[b]);
+            sweepMax = glm::max(sweepMax, binMax[b]);
+            sweepCount += binCount[b];
+            rightArea[b] = surfaceArea(sweepMin, sweepMax);
+            rightCount[b] = sweepCount;
+        }
+
+        sweepMin = glm::vec3(INF);
+        sweepMax = glm::vec3(-INF);
+        sweepCount = 0;
+
+        for (unsigned int b = 0; b < BINS - 1; b++) {
+            sweepMin = glm::min(sweepMin, binMin[b]);
+            sweepMax = glm::max(sweepMax, binMax[b]);
+            sweepCount += binCount[b];
+
+            if (sweepCount == 0 || rightCount[b + 1] == 0) {
+                continue;
+            }
+
+            const float cost = surfaceArea(sweepMin, sweepMax) * sweepCount + rightArea[b + 1] * rightCount[b + 1];
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    unsigned int* first = m_Indices.data() + range.first;
+    unsigned int* last = first + range.count;
+    unsigned int* middle;
+
+    if (bestAxis >= 0) {
+        const float scale = BINS / extent[bestAxis];
+
+        middle = std::partition(first, last, [&](unsigned int instance) {
+            return std::min(static_cast<unsigned int>((m_Centers[instance][bestAxis] - centerMin[bestAxis]) * scale), BINS - 1) <= bestBin;
+        });
+    } else {
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        middle = first + range.count / 2;
+        std::nth_element(first, middle, last, [&](unsigned int a, unsigned int b) {
+            return m_Centers[a][axis] < m_Centers[b][axis];
+        });
+    }
+
+    const unsigned int leftCount = static_cast<unsigned int>(middle - first);
+
+    left = bound(range.first, leftCount);
+    right = bound(range.first + leftCount, range.count - leftCount);
+
+    return bestAxis >= 0;
+}
+
+void InstanceBvh::refitNode(unsigned int index, glm::vec3& min, glm::vec3& max, float& cost) {
+    min = glm::vec3(INF);
+    max = glm::vec3(-INF);
+
+    Node& node = m_Nodes[index];
+
+    for (unsigned int lane = 0; lane < WIDTH; lane++) {
+        glm::vec3 childMin(INF);
+        glm::vec3 childMax(-INF);
+
+        if (node.child[lane] == EMPTY) {
+            // Inverted, so every overlap test rejects the lane. The slab test checks for EMPTY itself.
+        } else if (node.count[lane] == 0) {
+            refitNode(node.child[lane], childMin, childMax, cost);
+        } else {
+            for (unsigned int i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++) {
+                childMin = glm::min(childMin, glm::vec3(m_Spheres[i]) - m_Spheres[i].w);
+                childMax = glm::max(childMax, glm::vec3(m_Spheres[i]) + m_Spheres[i].w);
+            }
+
+            cost += surfaceArea(childMin, childMax) * node.count[lane];
+        }
+
+        node.minX[lane] = childMin.x;
+        node.minY[lane] = childMin.y;
+        node.minZ[lane] = childMin.z;
+        node.maxX[lane] = childMax.x;
+        node.maxY[lane] = childMax.y;
+        node.maxZ[lane] = childMax.z;
+
+        if (node.child[lane] != EMPTY) {
+            min = glm::min(min, childMin);
+            max = glm::max(max, childMax);
+        }
+    }
+
+    cost += surfaceArea(min, max);
+}
+
+InstanceBvh::Range InstanceBvh::bound(unsigned int first, unsigned int count) const {
+    Range range;
+    range.first = first;
+    range.count = count;
+    range.min = glm::vec3(INF);
+    range.max = glm::vec3(-INF);
+
+    for (unsigned int i = first; i < first + count; i++) {
+        const glm::vec4& sphere = m_Spheres[m_Indices[i]];
+        range.min = glm::min(range.min, glm::vec3(sphere) - sphere.w);
+        range.max = glm::max(range.max, glm::vec3(sphere) + sphere.w);
+    }
+
+    return range;
+}
+
+void InstanceBvh::begin(Traversal& ray, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.inverse = 1.0f / direction;
+    ray.best = -1;
+    ray.bestDistance = maxDistance;
+    ray.top = 0;
+
+    if (!m_Nodes.empty()) {
+        ray.stack[ray.top++] = { 0, 0, 0.0f };
+        prefetch(ray.stack[0]);
+    }
+}
+
+void InstanceBvh::prefetch(const Visit& visit) const {
+    const char* first = visit.count == 0 ? reinterpret_cast<const char*>(&m_Nodes[visit.child]) : reinterpret_cast<const char*>(&m_Spheres[visit.child]);
+    const size_t size = visit.count == 0 ? sizeof(Node) : visit.count * sizeof(glm::vec4);
+
+    // Nodes aren't aligned to cache lines, so the range can start partway into one.
+    const uintptr_t end = reinterpret_cast<uintptr_t>(first) + size;
+
+    for (uintptr_t line = reinterpret_cast<uintptr_t>(first) & ~uintptr_t(CACHE_LINE - 1); line < end; line += CACHE_LINE) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(reinterpret_cast<const char*>(line), _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(reinterpret_cast<const void*>(line));
+#endif
+    }
+}
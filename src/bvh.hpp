@@ -0,0 +1,282 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+struct BvhStats {
+    size_t nodes = 0;
+    size_t leaves = 0;
+    unsigned int depth = 0;
+    float buildMs = 0.0f;
+    float refitMs = 0.0f;
+    // Surface area heuristic cost of the tree, relative to the root box. Refitting moved instances raises it.
+    float cost = 0.0f;
+};
+
+// Eight-wide bounding volume hierarchy over instance bounding spheres. Each node stores its children's boxes
+// as structure-of-arrays lanes, so a ray or box is tested against all eight at once in loops the compiler can
+// vectorize. Built top-down with a binned surface area heuristic; moved instances are handled by refitting
+// the boxes in place, which keeps the topology and slowly degrades the tree until the owner rebuilds it.
+class InstanceBvh {
+public:
+    // Rays traced together by RaycastBatch. Each one's node and sphere fetches are issued as prefetches when
+    // its stack is pushed and consumed only after the others have taken a step, which hides most of the
+    // memory latency of incoherent rays.
+    static constexpr unsigned int BATCH_SIZE = 16;
+
+    void Build(const std::vector<glm::vec4>& spheres);
+    // Spheres must be the same count, in the same order, as the last Build.
+    void Refit(const std::vector<glm::vec4>& spheres);
+
+    // Nearest instance whose sphere the ray enters within maxDistance and for which exact(index, distance)
+    // confirms a hit. exact is given the sphere entry distance and returns the real one, or a negative value to
+    // reject the instance. direction must be normalized. Returns the instance index, or -1 on a miss.
+    template <typename Exact>
+    long long Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Exact&& exact, float& distance) const;
+    // Raycast for count rays at once, with the same answers; exact(ray, index, distance) is also told which ray
+    // it is confirming. Interleaving the traversals makes this several times faster per ray than casting them
+    // one at a time whenever the tree doesn't fit in cache.
+    template <typename Exact>
+    void RaycastBatch(const glm::vec3* origins, const glm::vec3* directions, size_t count, float maxDistance, Exact&& exact, long long* results, float* distances) const;
+
+    // Instances whose spheres overlap a world-space box or sphere, appended to result.
+    void QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const;
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const;
+
+    size_t GetCount() const;
+    const BvhStats& GetStats() const;
+
+private:
+    static constexpr unsigned int WIDTH = 8;
+    static constexpr unsigned int MAX_LEAF_SIZE = 4;
+    static constexpr unsigned int BINS = 16;
+    static constexpr unsigned int EMPTY = 0xFFFFFFFF;
+    static constexpr unsigned int MAX_DEPTH = 64;
+    static constexpr unsigned int CACHE_LINE = 64;
+
+    struct Node {
+        float minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+        float maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+        // Inner node index when count is 0, otherwise the first of count spheres in m_Spheres. EMPTY for an
+        // unused lane, whose box is inverted so nothing ever enters it.
+        unsigned int child[WIDTH];
+        unsigned int count[WIDTH];
+    };
+
+    struct Range {
+        unsigned int first;
+        unsigned int count;
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // An inner node when count is 0, otherwise a leaf's run of spheres, and where the ray enters its box.
+    // Leaves go on the stack like nodes so their spheres are prefetched too, and are tested nearest first.
+    struct Visit {
+        unsigned int child;
+        unsigned int count;
+        float near;
+    };
+
+    // How far one ray has got. A stack never holds more than WIDTH - 1 entries per level below the root.
+    struct Traversal {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        glm::vec3 inverse;
+        long long best;
+        float bestDistance;
+        unsigned int top;
+        Visit stack[MAX_DEPTH * (WIDTH - 1) + 1];
+    };
+
+    std::vector<Node> m_Nodes;
+    // Spheres in leaf order, and the instance index each came from.
+    std::vector<glm::vec4> m_Spheres;
+    std::vector<unsigned int> m_Indices;
+    std::vector<glm::vec3> m_Centers;
+    BvhStats m_Stats;
+
+    unsigned int buildNode(Range range, unsigned int depth);
+    bool split(const Range& range, Range& left, Range& right);
+    void refitNode(unsigned int node, glm::vec3& min, glm::vec3& max, float& cost);
+    Range bound(unsigned int first, unsigned int count) const;
+
+    void begin(Traversal& ray, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+    // Handles the entry on top of the ray's stack. Returns false once the stack is empty.
+    template <typename Exact>
+    bool step(Traversal& ray, size_t index, Exact& exact) const;
+    void prefetch(const Visit& visit) const;
+};
+
+template <typename Exact>
+long long InstanceBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Exact&& exact, float& distance) const {
+    auto confirm = [&](size_t, unsigned int index, float entry) {
+        return exact(index, entry);
+    };
+
+    Traversal ray;
+    begin(ray, origin, direction, maxDistance);
+
+    while (step(ray, 0, confirm)) {
+    }
+
+    distance = ray.bestDistance;
+    return ray.best;
+}
+
+template <typename Exact>
+void InstanceBvh::RaycastBatch(const glm::vec3* origins, const glm::vec3* directions, size_t count, float maxDistance, Exact&& exact, long long* results, float* distances) const {
+    Traversal rays[BATCH_SIZE];
+    // Which ray each traversal is tracing. live[0, active) are the traversals still running.
+    size_t indices[BATCH_SIZE];
+    unsigned int live[BATCH_SIZE];
+    unsigned int active = 0;
+    size_t next = 0;
+
+    for (; active < BATCH_SIZE && next < count; active++, next++) {
+        begin(rays[active], origins[next], directions[next], maxDistance);
+        indices[active] = next;
+        live[active] = active;
+    }
+
+    // One step of each ray in turn. A finished ray hands its traversal to the next one waiting.
+    while (active > 0) {
+        for (unsigned int i = 0; i < active;) {
+            Traversal& ray = rays[live[i]];
+
+            if (step(ray, indices[live[i]], exact)) {
+                i++;
+                continue;
+            }
+
+            results[indices[live[i]]] = ray.best;
+            distances[indices[live[i]]] = ray.bestDistance;
+
+            if (next < count) {
+                begin(ray, origins[next], directions[next], maxDistance);
+                indices[live[i]] = next++;
+                i++;
+            } else {
+                live[i] = live[--active];
+            }
+        }
+    }
+}
+
+template <typename Exact>
+bool InstanceBvh::step(Traversal& ray, size_t index, Exact& exact) const {
+    if (ray.top == 0) {
+        return false;
+    }
+
+    const Visit visit = ray.stack[--ray.top];
+
+    // A hit found since the entry was pushed may already be nearer than its box.
+    if (visit.near >= ray.bestDistance) {
+        return ray.top > 0;
+    }
+
+    if (visit.count > 0) {
+        for (unsigned int i = visit.child; i < visit.child + visit.count; i++) {
+            const glm::vec3 center(m_Spheres[i]);
+            const float radius = m_Spheres[i].w;
+
+            // Ray against sphere, keeping the entry point (or the origin when starting inside). The squared
+            // miss distance is taken from the closest point rather than as b * b - c, which loses every digit
+            // to cancellation once the sphere is far away compared to its radius.
+            const glm::vec3 offset = center - ray.origin;
+            const float along = glm::dot(offset, ray.direction);
+            const glm::vec3 closest = offset - ray.direction * along;
+            const float discriminant = radius * radius - glm::dot(closest, closest);
+
+            if (discriminant < 0.0f) {
+                continue;
+            }
+
+            const float half = std::sqrt(discriminant);
+            const float entry = std::max(along - half, 0.0f);
+
+            if (entry >= ray.bestDistance || along + half < 0.0f) {
+                continue;
+            }
+
+            const float hit = exact(index, m_Indices[i], entry);
+
+            if (hit >= 0.0f && hit < ray.bestDistance) {
+                ray.best = m_Indices[i];
+                ray.bestDistance = hit;
+            }
+        }
+
+        return ray.top > 0;
+    }
+
+    const Node& node = m_Nodes[visit.child];
+
+    // Slab test of every lane at once. The selects are written out rather than taken from std::min and
+    // std::max so the loop compiles to packed min, max and compare instructions without branches.
+    float near[WIDTH];
+    int enter[WIDTH];
+
+    for (unsigned int lane = 0; lane < WIDTH; lane++) {
+        const float x0 = (node.minX[lane] - ray.origin.x) * ray.inverse.x;
+        const float x1 = (node.maxX[lane] - ray.origin.x) * ray.inverse.x;
+        const float y0 = (node.minY[lane] - ray.origin.y) * ray.inverse.y;
+        const float y1 = (node.maxY[lane] - ray.origin.y) * ray.inverse.y;
+        const float z0 = (node.minZ[lane] - ray.origin.z) * ray.inverse.z;
+        const float z1 = (node.maxZ[lane] - ray.origin.z) * ray.inverse.z;
+
+        const float nearX = x0 < x1 ? x0 : x1;
+        const float nearY = y0 < y1 ? y0 : y1;
+        const float nearZ = z0 < z1 ? z0 : z1;
+        const float farX = x0 < x1 ? x1 : x0;
+        const float farY = y0 < y1 ? y1 : y0;
+        const float farZ = z0 < z1 ? z1 : z0;
+
+        float entry = nearX > nearY ? nearX : nearY;
+        entry = entry > nearZ ? entry : nearZ;
+        entry = entry > 0.0f ? entry : 0.0f;
+
+        float exit = farX < farY ? farX : farY;
+        exit = exit < farZ ? exit : farZ;
+        exit = exit < ray.bestDistance ? exit : ray.bestDistance;
+
+        near[lane] = entry;
+        // Swapping the slabs turns an inverted box into an infinite one, so empty lanes are missed explicitly.
+        // A bitwise and, since a short-circuiting one is a branch and stops the loop from vectorizing.
+        enter[lane] = (entry <= exit) & (node.child[lane] != EMPTY);
+    }
+
+    // Usually only one or two lanes are entered, so only those are visited rather than branching on all eight.
+    unsigned int mask = 0;
+    for (unsigned int lane = 0; lane < WIDTH; lane++) {
+        mask |= static_cast<unsigned int>(enter[lane]) << lane;
+    }
+
+    // Pushed farthest first so the nearest is popped next and tightens bestDistance before the rest are opened.
+    Visit* pushed = ray.stack + ray.top;
+    unsigned int count = 0;
+
+    for (; mask != 0; mask &= mask - 1) {
+        const unsigned int lane = static_cast<unsigned int>(std::countr_zero(mask));
+        unsigned int slot = count++;
+        while (slot > 0 && pushed[slot - 1].near < near[lane]) {
+            pushed[slot] = pushed[slot - 1];
+            slot--;
+        }
+
+        pushed[slot] = { node.child[lane], node.count[lane], near[lane] };
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        prefetch(pushed[i]);
+    }
+
+    ray.top += count;
+
+    return ray.top > 0;
+}
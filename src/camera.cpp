@@ -94,4 +94,42 @@ void Camera::updateCameraVectors() {
     m_Front = glm::normalize(front);
     m_Right = glm::normalize(glm::cross(m_Front, m_WorldUp));
     m_Up    = glm::normalize(glm::cross(m_Right, m_Front));
+}
+
+void Camera::SetPose(glm::vec3 position, float yaw, float pitch) {
+    m_Position = position;
+    m_Yaw = yaw;
+    m_Pitch = pitch;
+
+    updateCameraVectors();
+}
+
+CameraPath::CameraPath(std::vector<CameraKey> keys) : m_Keys(std::move(keys)) {
+}
+
+void CameraPath::Apply(float t, Camera& camera) const {
+    if (m_Keys.empty()) {
+        return;
+    }
+
+    size_t next = 0;
+    while (next < m_Keys.size() && m_Keys[next].time < t) {
+        next++;
+    }
+
+    if (next == 0 || next == m_Keys.size()) {
+        const CameraKey& key = m_Keys[next == 0 ? 0 : m_Keys.size() - 1];
+        camera.SetPose(key.position, key.yaw, key.pitch);
+        return;
+    }
+
+    const CameraKey& from = m_Keys[next - 1];
+    const CameraKey& to = m_Keys[next];
+    float blend = (t - from.time) / glm::max(to.time - from.time, 1e-4f);
+
+    camera.SetPose(glm::mix(from.position, to.position, blend), glm::mix(from.yaw, to.yaw, blend), glm::mix(from.pitch, to.pitch, blend));
+}
+
+float CameraPath::GetDuration() const {
+    return m_Keys.empty() ? 0.0f : m_Keys.back().time;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <vector>
+
 enum Camera_Movement {
     FORWARD,
     BACKWARD,
@@ -37,6 +39,8 @@ public:
 
     glm::vec3 GetFront();
 
+    void SetPose(glm::vec3 position, float yaw, float pitch);
+
 private:
     glm::vec3 m_Position;
     glm::vec3 m_Front;
@@ -52,4 +56,25 @@ private:
     float m_Zoom;
 
     void updateCameraVectors();
+};
+
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// Scripted fly-through for benchmarks, interpolated linearly between keys.
+class CameraPath {
+public:
+    explicit CameraPath(std::vector<CameraKey> keys);
+
+    // Poses the camera at time t, clamped to the path's length.
+    void Apply(float t, Camera& camera) const;
+
+    float GetDuration() const;
+
+private:
+    std::vector<CameraKey> m_Keys;
 };
\ No newline at end of file
@@ -0,0 +1,541 @@
+#include "capture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <csignal>
+#endif
+
+namespace {
+    uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> entries;
+
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+
+                for (int k = 0; k < 8; k++) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                entries[n] = c;
+            }
+
+            return entries;
+        }();
+
+        crc = ~crc;
+
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    uint32_t adler32(const unsigned char* data, size_t size) {
+        constexpr uint32_t MOD = 65521;
+        // Largest run that can't overflow the sums before they are reduced.
+        constexpr size_t RUN = 5552;
+
+        uint32_t a = 1;
+        uint32_t b = 0;
+
+        while (size > 0) {
+            const size_t run = std::min(size, RUN);
+
+            for (size_t i = 0; i < run; i++) {
+                a += data[i];
+                b += a;
+            }
+
+            a %= MOD;
+            b %= MOD;
+            data += run;
+            size -= run;
+        }
+
+        return (b << 16) | a;
+    }
+
+    void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    void appendChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+        appendBigEndian(out, static_cast<uint32_t>(size));
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        appendBigEndian(out, crc32(data, size, crc32(reinterpret_cast<const unsigned char*>(type), 4)));
+    }
+
+    // 8-bit RGB PNG around scanlines that already carry their filter bytes. The zlib stream uses stored deflate
+    // blocks: larger files, but no compression cost on the writer thread.
+    void encodePng(const std::vector<unsigned char>& scanlines, int width, int height, std::vector<unsigned char>& png) {
+        static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        constexpr size_t MAX_STORED_BLOCK = 65535;
+
+        png.assign(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+        std::vector<unsigned char> header;
+        appendBigEndian(header, static_cast<uint32_t>(width));
+        appendBigEndian(header, static_cast<uint32_t>(height));
+        header.insert(header.end(), { 8, 2, 0, 0, 0 });
+        appendChunk(png, "IHDR", header.data(), header.size());
+
+        // IDAT is built in place, with its length patched in once the blocks are down.
+        const size_t chunkStart = png.size();
+        appendBigEndian(png, 0);
+        png.insert(png.end(), { 'I', 'D', 'A', 'T', 0x78, 0x01 });
+
+        for (size_t offset = 0; offset < scanlines.size(); offset += MAX_STORED_BLOCK) {
+            const size_t size = std::min(scanlines.size() - offset, MAX_STORED_BLOCK);
+            const bool last = offset + size == scanlines.size();
+
+            png.push_back(last ? 1 : 0);
+            png.push_back(static_cast<unsigned char>(size));
+            png.push_back(static_cast<unsigned char>(size >> 8));
+            png.push_back(static_cast<unsigned char>(~size));
+            png.push_back(static_cast<unsigned char>(~size >> 8));
+            png.insert(png.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+        }
+
+        appendBigEndian(png, adler32(scanlines.data(), scanlines.size()));
+
+        const size_t length = png.size() - chunkStart - 8;
+
+        for (int i = 0; i < 4; i++) {
+            png[chunkStart + i] = static_cast<unsigned char>(length >> (24 - 8 * i));
+        }
+
+        appendBigEndian(png, crc32(png.data() + chunkStart + 4, length + 4));
+        appendChunk(png, "IEND", nullptr, 0);
+    }
+
+    // Top-down RGB rows from bottom-up RGBA ones, each preceded by prefix zero bytes (PNG's filter type).
+    void toRgb(const unsigned char* rgba, int width, int height, size_t prefix, std::vector<unsigned char>& rgb) {
+        const size_t rowBytes = prefix + static_cast<size_t>(width) * 3;
+        rgb.resize(rowBytes * height);
+
+        for (int y = 0; y < height; y++) {
+            const unsigned char* source = rgba + static_cast<size_t>(height - 1 - y) * width * 4;
+            unsigned char* destination = rgb.data() + y * rowBytes;
+
+            std::fill(destination, destination + prefix, 0);
+            destination += prefix;
+
+            for (int x = 0; x < width; x++) {
+                destination[3 * x + 0] = source[4 * x + 0];
+                destination[3 * x + 1] = source[4 * x + 1];
+                destination[3 * x + 2] = source[4 * x + 2];
+            }
+        }
+    }
+
+    // Planar I420 with BT.601 limited-range coefficients in 8.8 fixed point. Chroma is the average of each 2x2
+    // block; odd sizes round the chroma planes up and average what is left at the edge.
+    void toI420(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& yuv) {
+        const int chromaWidth = (width + 1) / 2;
+        const int chromaHeight = (height + 1) / 2;
+
+        yuv.resize(static_cast<size_t>(width) * height + 2 * static_cast<size_t>(chromaWidth) * chromaHeight);
+
+        unsigned char* luma = yuv.data();
+        unsigned char* u = luma + static_cast<size_t>(width) * height;
+        unsigned char* v = u + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+        auto pixel = [&](int x, int y) {
+            return rgba + (static_cast<size_t>(height - 1 - y) * width + x) * 4;
+        };
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const unsigned char* p = pixel(x, y);
+                luma[y * width + x] = static_cast<unsigned char>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+            }
+        }
+
+        for (int cy = 0; cy < chromaHeight; cy++) {
+            for (int cx = 0; cx < chromaWidth; cx++) {
+                int r = 0;
+                int g = 0;
+                int b = 0;
+                int count = 0;
+
+                for (int y = 2 * cy; y < std::min(2 * cy + 2, height); y++) {
+                    for (int x = 2 * cx; x < std::min(2 * cx + 2, width); x++) {
+                        const unsigned char* p = pixel(x, y);
+                        r += p[0];
+                        g += p[1];
+                        b += p[2];
+                        count++;
+                    }
+                }
+
+                r /= count;
+                g /= count;
+                b /= count;
+
+                u[cy * chromaWidth + cx] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v[cy * chromaWidth + cx] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+    }
+
+    void replaceAll(std::string& text, const std::string& from, const std::string& to) {
+        for (size_t found = text.find(from); found != std::string::npos; found = text.find(from, found + to.size())) {
+            text.replace(found, from.size(), to);
+        }
+    }
+
+    void waitForFence(GLsync fence) {
+        while (true) {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+                return;
+            }
+
+            if (result == GL_WAIT_FAILED) {
+                std::cerr << "Waiting on a capture fence failed" << std::endl;
+                return;
+            }
+        }
+    }
+}
+
+FrameCapture::FrameCapture(const CaptureSettings& settings) : m_Settings(settings) {
+    // With a single buffer every read would be mapped the frame after it was issued, which is a stall.
+    m_Settings.ringSize = std::max(m_Settings.ringSize, 2u);
+    m_Settings.queueDepth = std::max(m_Settings.queueDepth, 1u);
+    m_Ring.resize(m_Settings.ringSize);
+
+    for (Readback& slot : m_Ring) {
+        GL_CHECK(glGenBuffers(1, &slot.pbo));
+    }
+
+    if (m_Settings.format == CaptureFormat::Png) {
+        std::error_code error;
+        std::filesystem::create_directories(m_Settings.target, error);
+
+        if (error) {
+            std::cerr << "Could not create capture directory " << m_Settings.target << ": " << error.message() << std::endl;
+            m_Open = false;
+        }
+    } else if (m_Settings.format == CaptureFormat::Yuv) {
+        m_File.open(m_Settings.target, std::ios::binary | std::ios::trunc);
+
+        if (!m_File) {
+            std::cerr << "Could not open capture file " << m_Settings.target << std::endl;
+            m_Open = false;
+        }
+    }
+
+    // The pipe is opened by the writer once the first frame says what size to pass the command.
+    m_Failed = !m_Open;
+    m_Writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture() {
+    Finish();
+
+    for (Readback& slot : m_Ring) {
+        ReleaseGpuMemory(GpuResource::Buffer, slot.pbo);
+        GL_CHECK(glDeleteBuffers(1, &slot.pbo));
+    }
+}
+
+bool FrameCapture::IsOpen() const {
+    return m_Open;
+}
+
+void FrameCapture::Capture(int width, int height) {
+    auto start = std::chrono::steady_clock::now();
+    m_Stats.fenceWaitMs = 0.0f;
+
+    // Hand over every read that has finished, oldest first, so frames reach the writer in order.
+    for (unsigned int i = 0; i < m_Ring.size(); i++) {
+        Readback& pending = m_Ring[(m_Next + i) % m_Ring.size()];
+
+        if (!pending.fence) {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(pending.fence, 0, 0);
+
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        collect(pending);
+    }
+
+    Readback& slot = m_Ring[m_Next];
+
+    // The GPU is a whole ring behind. This is the one place capture blocks, and the pacer's frames-in-flight
+    // limit normally keeps it from happening with the default ring.
+    if (slot.fence) {
+        auto waitStart = std::chrono::steady_clock::now();
+        waitForFence(slot.fence);
+        m_Stats.fenceWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+        collect(slot);
+    }
+
+    if (width > 0 && height > 0) {
+        const size_t bytes = static_cast<size_t>(width) * height * 4;
+
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+
+        if (bytes > slot.capacity) {
+            GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ));
+            TrackGpuMemory(GpuResource::Buffer, slot.pbo, MemoryCategory::Capture, bytes);
+            slot.capacity = bytes;
+        }
+
+        // RGBA rows are always 4-byte aligned, so the default pack alignment holds.
+        GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+        GL_CHECK(glReadBuffer(GL_BACK));
+        GL_CHECK(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        slot.width = width;
+        slot.height = height;
+        slot.frame = m_Frames++;
+        m_Next = (m_Next + 1) % m_Ring.size();
+        m_Stats.captured++;
+    }
+
+    m_Stats.captureMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_Stats.totalCaptureMs += m_Stats.captureMs;
+    m_Stats.totalFenceWaitMs += m_Stats.fenceWaitMs;
+}
+
+void FrameCapture::Finish() {
+    if (!m_Writer.joinable()) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < m_Ring.size(); i++) {
+        Readback& pending = m_Ring[(m_Next + i) % m_Ring.size()];
+
+        if (pending.fence) {
+            waitForFence(pending.fence);
+            collect(pending);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+
+    m_Wake.notify_one();
+    m_Writer.join();
+
+    if (m_Pipe) {
+#if defined(_WIN32)
+        _pclose(m_Pipe);
+#else
+        pclose(m_Pipe);
+#endif
+        m_Pipe = nullptr;
+    }
+
+    m_File.close();
+}
+
+CaptureStats FrameCapture::GetStats() const {
+    CaptureStats stats = m_Stats;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    stats.written = m_Written;
+    stats.dropped = m_Dropped;
+    stats.totalWriteMs = m_WriteMs;
+
+    return stats;
+}
+
+void FrameCapture::collect(Readback& slot) {
+    GL_CHECK(glDeleteSync(slot.fence));
+    slot.fence = nullptr;
+
+    Frame frame;
+    frame.width = slot.width;
+    frame.height = slot.height;
+    frame.index = slot.frame;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (m_Queue.size() >= m_Settings.queueDepth) {
+            m_Dropped++;
+            return;
+        }
+
+        if (!m_Free.empty()) {
+            frame.pixels = std::move(m_Free.back());
+            m_Free.pop_back();
+        }
+    }
+
+    const size_t bytes = static_cast<size_t>(slot.width) * slot.height * 4;
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+
+    if (mapped) {
+        MemoryScope scope(MemoryCategory::Capture);
+        frame.pixels.resize(bytes);
+        std::memcpy(frame.pixels.data(), mapped, bytes);
+        GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (!mapped) {
+        std::cerr << "Mapping a capture buffer failed" << std::endl;
+        m_Dropped++;
+        m_Free.push_back(std::move(frame.pixels));
+        return;
+    }
+
+    m_Queue.push_back(std::move(frame));
+    m_Wake.notify_one();
+}
+
+void FrameCapture::writerLoop() {
+    MemoryScope scope(MemoryCategory::Capture);
+
+    while (true) {
+        Frame frame;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+
+            // Stopping still drains whatever was queued first.
+            if (m_Queue.empty()) {
+                return;
+            }
+
+            frame = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const bool written = !m_Failed && write(frame);
+        const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (written) {
+            m_Written++;
+        } else {
+            m_Dropped++;
+        }
+
+        m_WriteMs += ms;
+        m_Free.push_back(std::move(frame.pixels));
+    }
+}
+
+bool FrameCapture::write(const Frame& frame) {
+    if (m_Settings.format == CaptureFormat::Png) {
+        return writePng(frame);
+    }
+
+    return writeStream(frame);
+}
+
+bool FrameCapture::writePng(const Frame& frame) {
+    toRgb(frame.pixels.data(), frame.width, frame.height, 1, m_Scratch);
+    encodePng(m_Scratch, frame.width, frame.height, m_Encoded);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.png", frame.index);
+
+    const std::filesystem::path path = std::filesystem::path(m_Settings.target) / name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(m_Encoded.data()), static_cast<std::streamsize>(m_Encoded.size()));
+
+    if (!file) {
+        std::cerr << "Could not write capture frame " << path.string() << "; dropping the rest" << std::endl;
+        m_Failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool FrameCapture::writeStream(const Frame& frame) {
+    if (m_StreamWidth == 0) {
+        m_StreamWidth = frame.width;
+        m_StreamHeight = frame.height;
+
+        if (m_Settings.format == CaptureFormat::Pipe) {
+            std::string command = m_Settings.target;
+            replaceAll(command, "{width}", std::to_string(frame.width));
+            replaceAll(command, "{height}", std::to_string(frame.height));
+
+#if defined(_WIN32)
+            m_Pipe = _popen(command.c_str(), "wb");
+#else
+            // An encoder that exits early should fail the next write, not kill the process.
+            std::signal(SIGPIPE, SIG_IGN);
+            m_Pipe = popen(command.c_str(), "w");
+#endif
+
+            if (!m_Pipe) {
+                std::cerr << "Could not start capture command " << command << std::endl;
+                m_Failed = true;
+                return false;
+            }
+        }
+    }
+
+    // Raw streams carry no per-frame header, so a stream keeps the size it started with.
+    if (frame.width != m_StreamWidth || frame.height != m_StreamHeight) {
+        if (!m_SizeWarned) {
+            std::cerr << "Capture stream is " << m_StreamWidth << "x" << m_StreamHeight
+                      << "; dropping frames of other sizes" << std::endl;
+            m_SizeWarned = true;
+        }
+
+        return false;
+    }
+
+    if (m_Settings.format == CaptureFormat::Yuv) {
+        toI420(frame.pixels.data(), frame.width, frame.height, m_Scratch);
+        m_File.write(reinterpret_cast<const char*>(m_Scratch.data()), static_cast<std::streamsize>(m_Scratch.size()));
+
+        if (!m_File) {
+            std::cerr << "Could not write to capture file " << m_Settings.target << "; dropping the rest" << std::endl;
+            m_Failed = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    toRgb(frame.pixels.data(), frame.width, frame.height, 0, m_Scratch);
+
+    if (std::fwrite(m_Scratch.data(), 1, m_Scratch.size(), m_Pipe) != m_Scratch.size()) {
+        std::cerr << "Capture command stopped accepting frames; dropping the rest" << std::endl;
+        m_Failed = true;
+        return false;
+    }
+
+    return true;
+}
\ No newline at end of file
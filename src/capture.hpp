@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory.hpp"
+#include "utility.hpp"
+
+enum class CaptureFormat {
+    // One PNG per frame, numbered, in the target directory. Stored without compression so encoding stays
+    // cheap enough for the writer to keep up.
+    Png,
+    // Every frame appended to the target file as planar I420, BT.601 limited range.
+    Yuv,
+    // Raw top-down RGB24 frames written to the standard input of the target command, typically an encoder.
+    // "{width}" and "{height}" in the command are replaced with the frame size when the first frame arrives.
+    Pipe
+};
+
+struct CaptureSettings {
+    CaptureFormat format = CaptureFormat::Png;
+    // Directory for Png, file for Yuv, command line for Pipe.
+    std::string target = "capture";
+    // Pixel buffers the readbacks rotate through. A frame is copied out of its buffer ringSize - 1 frames
+    // after it was read, by which time its fence has normally signalled; more buffers ride out deeper GPU queues.
+    unsigned int ringSize = 3;
+    // Frames waiting for the writer thread. Once it falls this far behind, new frames are dropped rather than
+    // holding up the render thread.
+    unsigned int queueDepth = 8;
+};
+
+struct CaptureStats {
+    unsigned long long captured = 0;
+    unsigned long long written = 0;
+    // Frames lost to a full writer queue, a size change mid-stream or a failed write.
+    unsigned long long dropped = 0;
+    // Render thread time of the last Capture call: issuing the read, copying finished frames out and any wait.
+    float captureMs = 0.0f;
+    // Part of captureMs spent blocked because the ring came round before the GPU finished a read.
+    float fenceWaitMs = 0.0f;
+    // Totals over the whole capture, for the overhead summary.
+    float totalCaptureMs = 0.0f;
+    float totalFenceWaitMs = 0.0f;
+    float totalWriteMs = 0.0f;
+};
+
+// Records the default framebuffer without stalling the pipeline. Each frame's glReadPixels goes into a pixel
+// buffer object and is followed by a fence; the buffer is only mapped a few frames later, once the fence has
+// signalled, so the copy never waits on rendering. Mapped pixels are handed to a writer thread, which flips,
+// converts and writes them. The render thread's share is one GPU-side copy per frame plus a memcpy of the
+// frame out of mapped memory, reported per frame in CaptureStats. Needs a current GL context.
+class FrameCapture {
+public:
+    explicit FrameCapture(const CaptureSettings& settings);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // False when the target could not be opened; frames captured anyway are counted as dropped.
+    bool IsOpen() const;
+
+    // Queues a read of the back buffer. Call once the frame is complete, before swapping buffers.
+    void Capture(int width, int height);
+    // Copies out every read still in flight, waiting on the GPU if needed, and lets the writer drain. Capture
+    // must not be called afterwards.
+    void Finish();
+
+    // Writer counters are read under its lock, so this returns a snapshot.
+    CaptureStats GetStats() const;
+
+private:
+    struct Readback {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        unsigned long long frame = 0;
+    };
+
+    // Bottom-up RGBA rows, as glReadPixels returns them.
+    struct Frame {
+        std::vector<unsigned char> pixels;
+        int width = 0;
+        int height = 0;
+        unsigned long long index = 0;
+    };
+
+    CaptureSettings m_Settings;
+    CaptureStats m_Stats;
+    std::vector<Readback> m_Ring;
+    // Slot the next read goes to, which is also the oldest one still pending, if any is.
+    unsigned int m_Next = 0;
+    unsigned long long m_Frames = 0;
+    bool m_Open = true;
+
+    std::thread m_Writer;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<Frame> m_Queue;
+    // Pixel storage the writer has finished with, reused for later frames.
+    std::vector<std::vector<unsigned char>> m_Free;
+    unsigned long long m_Written = 0;
+    unsigned long long m_Dropped = 0;
+    float m_WriteMs = 0.0f;
+    bool m_Stop = false;
+
+    // Writer thread only.
+    std::ofstream m_File;
+    FILE* m_Pipe = nullptr;
+    int m_StreamWidth = 0;
+    int m_StreamHeight = 0;
+    bool m_Failed = false;
+    bool m_SizeWarned = false;
+    std::vector<unsigned char> m_Scratch;
+    std::vector<unsigned char> m_Encoded;
+
+    void collect(Readback& slot);
+    void writerLoop();
+    bool write(const Frame& frame);
+    bool writePng(const Frame& frame);
+    bool writeStream(const Frame& frame);
+};
\ No newline at end of file
@@ -0,0 +1,432 @@
+#include "commands.hpp"
+
+#include <chrono>
+
+namespace {
+    using A = CommandArg;
+
+    // Indexed by CommandType.
+    const CommandInfo COMMAND_INFO[COMMAND_TYPE_COUNT] = {
+        { "UseProgram", 1, { A::Program } },
+        { "Uniform", 2, { A::UniformLocation, A::Value } },
+        { "BindVertexArray", 1, { A::VertexArray } },
+        { "BindTexture", 3, { A::Value, A::Value, A::Texture } },
+        { "BindBuffer", 2, { A::Value, A::Buffer } },
+        { "BindBufferBase", 3, { A::Value, A::Value, A::Buffer } },
+        { "BufferSubData", 2, { A::Value, A::Value } },
+        { "VertexAttribPointer", 7, { A::Value, A::Value, A::Value, A::Value, A::Value, A::Value, A::Value } },
+        { "Capability", 2, { A::Value, A::Value } },
+        { "DepthFunc", 1, { A::Value } },
+        { "PolygonMode", 1, { A::Value } },
+        { "CullFace", 1, { A::Value } },
+        { "BlendFunc", 4, { A::Value, A::Value, A::Value, A::Value } },
+        { "ClearColor", 0, {} },
+        { "Viewport", 4, { A::Value, A::Value, A::Value, A::Value } },
+        { "Clear", 1, { A::Value } },
+        { "BindFramebuffer", 2, { A::Value, A::Framebuffer } },
+        { "DrawArrays", 3, { A::Value, A::Value, A::Value } },
+        { "DrawElementsInstanced", 6, { A::Value, A::Value, A::Value, A::Value, A::Value, A::Value } },
+        { "MultiDrawElements", 2, { A::Value, A::Value } },
+        { "MultiDrawElementsIndirect", 5, { A::Value, A::Value, A::Value, A::Value, A::Value } }
+    };
+
+    const void* bufferOffset(uint32_t offset) {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
+    }
+
+    void issue(CommandType type, const uint32_t* a, const unsigned char* data, size_t dataSize) {
+        switch (type) {
+        case CommandType::UseProgram:
+            GL_CHECK(glUseProgram(a[0]));
+            break;
+        case CommandType::Uniform: {
+            const GLint location = static_cast<GLint>(a[0]);
+            const float* values = reinterpret_cast<const float*>(data);
+
+            switch (static_cast<UniformType>(a[1])) {
+            case UniformType::Int: {
+                GLint value;
+                std::memcpy(&value, data, sizeof(value));
+                GL_CHECK(glUniform1i(location, value));
+                break;
+            }
+            case UniformType::Float: GL_CHECK(glUniform1fv(location, 1, values)); break;
+            case UniformType::Vec2: GL_CHECK(glUniform2fv(location, 1, values)); break;
+            case UniformType::Vec3: GL_CHECK(glUniform3fv(location, 1, values)); break;
+            case UniformType::Vec4: GL_CHECK(glUniform4fv(location, 1, values)); break;
+            case UniformType::Mat3: GL_CHECK(glUniformMatrix3fv(location, 1, GL_FALSE, values)); break;
+            case UniformType::Mat4: GL_CHECK(glUniformMatrix4fv(location, 1, GL_FALSE, values)); break;
+            }
+
+            break;
+        }
+        case CommandType::BindVertexArray:
+            GL_CHECK(glBindVertexArray(a[0]));
+            break;
+        case CommandType::BindTexture:
+            GL_CHECK(glActiveTexture(GL_TEXTURE0 + a[0]));
+            GL_CHECK(glBindTexture(a[1], a[2]));
+            GL_CHECK(glActiveTexture(GL_TEXTURE0));
+            break;
+        case CommandType::BindBuffer:
+            GL_CHECK(glBindBuffer(a[0], a[1]));
+            break;
+        case CommandType::BindBufferBase:
+            GL_CHECK(glBindBufferBase(a[0], a[1], a[2]));
+            break;
+        case CommandType::BufferSubData:
+            GL_CHECK(glBufferSubData(a[0], a[1], dataSize, data));
+            break;
+        case CommandType::VertexAttribPointer:
+            if (a[6]) {
+                GL_CHECK(glVertexAttribIPointer(a[0], a[1], a[2], a[4], bufferOffset(a[5])));
+            } else {
+                GL_CHECK(glVertexAttribPointer(a[0], a[1], a[2], static_cast<GLboolean>(a[3]), a[4], bufferOffset(a[5])));
+            }
+            break;
+        case CommandType::Capability:
+            if (a[1]) {
+                GL_CHECK(glEnable(a[0]));
+            } else {
+                GL_CHECK(glDisable(a[0]));
+            }
+            break;
+        case CommandType::DepthFunc:
+            GL_CHECK(glDepthFunc(a[0]));
+            break;
+        case CommandType::PolygonMode:
+            GL_CHECK(glPolygonMode(GL_FRONT_AND_BACK, a[0]));
+            break;
+        case CommandType::CullFace:
+            GL_CHECK(glCullFace(a[0]));
+            break;
+        case CommandType::BlendFunc:
+            GL_CHECK(glBlendFuncSeparate(a[0], a[1], a[2], a[3]));
+            break;
+        case CommandType::ClearColor: {
+            float color[4];
+            std::memcpy(color, data, sizeof(color));
+            GL_CHECK(glClearColor(color[0], color[1], color[2], color[3]));
+            break;
+        }
+        case CommandType::Viewport:
+            GL_CHECK(glViewport(static_cast<GLint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2]), static_cast<GLsizei>(a[3])));
+            break;
+        case CommandType::Clear:
+            GL_CHECK(glClear(a[0]));
+            break;
+        case CommandType::BindFramebuffer:
+            GL_CHECK(glBindFramebuffer(a[0], a[1]));
+            break;
+        case CommandType::DrawArrays:
+            GL_CHECK(glDrawArrays(a[0], static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2])));
+            break;
+        case CommandType::DrawElementsInstanced:
+            if (GLAD_GL_VERSION_4_2) {
+                GL_CHECK(glDrawElementsInstancedBaseInstance(a[0], a[1], a[2], bufferOffset(a[3]), a[4], a[5]));
+            } else {
+                GL_CHECK(glDrawElementsInstanced(a[0], a[1], a[2], bufferOffset(a[3]), a[4]));
+            }
+            break;
+        case CommandType::MultiDrawElements: {
+            // Counts, then offsets widened back to pointers.
+            const GLsizei drawCount = static_cast<GLsizei>(dataSize / (2 * sizeof(uint32_t)));
+            thread_local std::vector<GLsizei> counts;
+            thread_local std::vector<const void*> offsets;
+
+            counts.resize(drawCount);
+            offsets.resize(drawCount);
+
+            for (GLsizei i = 0; i < drawCount; i++) {
+                uint32_t count, offset;
+                std::memcpy(&count, data + i * sizeof(uint32_t), sizeof(count));
+                std::memcpy(&offset, data + (drawCount + i) * sizeof(uint32_t), sizeof(offset));
+
+                counts[i] = static_cast<GLsizei>(count);
+                offsets[i] = bufferOffset(offset);
+            }
+
+            GL_CHECK(glMultiDrawElements(a[0], counts.data(), a[1], offsets.data(), drawCount));
+            break;
+        }
+        case CommandType::MultiDrawElementsIndirect:
+            GL_CHECK(glMultiDrawElementsIndirect(a[0], a[1], bufferOffset(a[2]), a[3], a[4]));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+const CommandInfo& GetCommandInfo(CommandType type) {
+    return COMMAND_INFO[static_cast<size_t>(type)];
+}
+
+void CommandBuffer::Reset() {
+    m_Bytes.clear();
+    m_Count = 0;
+}
+
+bool CommandBuffer::IsEmpty() const {
+    return m_Count == 0;
+}
+
+size_t CommandBuffer::GetCommandCount() const {
+    return m_Count;
+}
+
+size_t CommandBuffer::GetSize() const {
+    return m_Bytes.size();
+}
+
+void CommandBuffer::UseProgram(const Shader& shader) {
+    UseProgram(shader.GetID());
+}
+
+void CommandBuffer::UseProgram(GLuint program) {
+    record(CommandType::UseProgram, { program });
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, bool value) {
+    const GLint integer = value;
+    setUniform(shader, name, UniformType::Int, &integer, sizeof(integer));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, int value) {
+    const GLint integer = value;
+    setUniform(shader, name, UniformType::Int, &integer, sizeof(integer));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, float value) {
+    setUniform(shader, name, UniformType::Float, &value, sizeof(value));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, const glm::vec2& value) {
+    setUniform(shader, name, UniformType::Vec2, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, const glm::vec3& value) {
+    setUniform(shader, name, UniformType::Vec3, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, const glm::vec4& value) {
+    setUniform(shader, name, UniformType::Vec4, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, const glm::mat3& value) {
+    setUniform(shader, name, UniformType::Mat3, &value[0][0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(const Shader& shader, const std::string& name, const glm::mat4& value) {
+    setUniform(shader, name, UniformType::Mat4, &value[0][0], sizeof(value));
+}
+
+void CommandBuffer::BindVertexArray(GLuint vertexArray) {
+    record(CommandType::BindVertexArray, { vertexArray });
+}
+
+void CommandBuffer::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+    record(CommandType::BindTexture, { unit, target, texture });
+}
+
+void CommandBuffer::BindBuffer(GLenum target, GLuint buffer) {
+    record(CommandType::BindBuffer, { target, buffer });
+}
+
+void CommandBuffer::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    record(CommandType::BindBufferBase, { target, index, buffer });
+}
+
+void CommandBuffer::BufferSubData(GLenum target, size_t offset, size_t size, const void* data) {
+    record(CommandType::BufferSubData, { target, static_cast<uint32_t>(offset) }, data, size);
+}
+
+void CommandBuffer::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset) {
+    record(CommandType::VertexAttribPointer, { index, static_cast<uint32_t>(size), type, normalized, static_cast<uint32_t>(stride), static_cast<uint32_t>(offset), 0 });
+}
+
+void CommandBuffer::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) {
+    record(CommandType::VertexAttribPointer, { index, static_cast<uint32_t>(size), type, GL_FALSE, static_cast<uint32_t>(stride), static_cast<uint32_t>(offset), 1 });
+}
+
+void CommandBuffer::Enable(GLenum capability) {
+    record(CommandType::Capability, { capability, 1 });
+}
+
+void CommandBuffer::Disable(GLenum capability) {
+    record(CommandType::Capability, { capability, 0 });
+}
+
+void CommandBuffer::DepthFunc(GLenum func) {
+    record(CommandType::DepthFunc, { func });
+}
+
+void CommandBuffer::PolygonMode(GLenum mode) {
+    record(CommandType::PolygonMode, { mode });
+}
+
+void CommandBuffer::CullFace(GLenum mode) {
+    record(CommandType::CullFace, { mode });
+}
+
+void CommandBuffer::BlendFunc(GLenum sourceRgb, GLenum destinationRgb, GLenum sourceAlpha, GLenum destinationAlpha) {
+    record(CommandType::BlendFunc, { sourceRgb, destinationRgb, sourceAlpha, destinationAlpha });
+}
+
+void CommandBuffer::ClearColor(const glm::vec4& color) {
+    record(CommandType::ClearColor, {}, &color[0], sizeof(color));
+}
+
+void CommandBuffer::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    record(CommandType::Viewport, { static_cast<uint32_t>(x), static_cast<uint32_t>(y), static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+}
+
+void CommandBuffer::Clear(GLbitfield mask) {
+    record(CommandType::Clear, { mask });
+}
+
+void CommandBuffer::BindFramebuffer(GLenum target, GLuint framebuffer) {
+    record(CommandType::BindFramebuffer, { target, framebuffer });
+}
+
+void CommandBuffer::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    record(CommandType::DrawArrays, { mode, static_cast<uint32_t>(first), static_cast<uint32_t>(count) });
+}
+
+void CommandBuffer::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instances, GLuint baseInstance) {
+    record(CommandType::DrawElementsInstanced, { mode, static_cast<uint32_t>(count), type, static_cast<uint32_t>(offset), static_cast<uint32_t>(instances), baseInstance });
+}
+
+void CommandBuffer::MultiDrawElements(GLenum mode, const GLsizei* counts, GLenum type, const void* const* offsets, GLsizei drawCount) {
+    // Recorded directly into the stream rather than through a temporary, to keep the fallback path allocation-free.
+    const size_t dataSize = 2 * sizeof(uint32_t) * static_cast<size_t>(drawCount);
+    record(CommandType::MultiDrawElements, { mode, type }, nullptr, dataSize);
+
+    unsigned char* data = m_Bytes.data() + m_Bytes.size() - dataSize;
+
+    for (GLsizei i = 0; i < drawCount; i++) {
+        const uint32_t count = static_cast<uint32_t>(counts[i]);
+        const uint32_t offset = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(offsets[i]));
+
+        std::memcpy(data + i * sizeof(uint32_t), &count, sizeof(count));
+        std::memcpy(data + (drawCount + i) * sizeof(uint32_t), &offset, sizeof(offset));
+    }
+}
+
+void CommandBuffer::MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, GLsizei drawCount, GLsizei stride) {
+    record(CommandType::MultiDrawElementsIndirect, { mode, type, static_cast<uint32_t>(offset), static_cast<uint32_t>(drawCount), static_cast<uint32_t>(stride) });
+}
+
+void CommandBuffer::Execute(CommandTimings* timings) const {
+    size_t offset = 0;
+    uint32_t args[MAX_COMMAND_ARGS];
+
+    while (offset < m_Bytes.size()) {
+        Header header;
+        std::memcpy(&header, m_Bytes.data() + offset, sizeof(header));
+
+        const unsigned char* argBytes = m_Bytes.data() + offset + sizeof(Header);
+        std::memcpy(args, argBytes, 4 * header.argCount);
+
+        const unsigned char* data = argBytes + 4 * header.argCount;
+
+        if (timings) {
+            auto start = std::chrono::steady_clock::now();
+            issue(header.type, args, data, header.dataSize);
+
+            const size_t type = static_cast<size_t>(header.type);
+            timings->counts[type]++;
+            timings->nanoseconds[type] += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        } else {
+            issue(header.type, args, data, header.dataSize);
+        }
+
+        offset += recordSize(header);
+    }
+}
+
+const std::vector<unsigned char>& CommandBuffer::GetBytes() const {
+    return m_Bytes;
+}
+
+bool CommandBuffer::Assign(std::vector<unsigned char> bytes) {
+    Reset();
+
+    size_t offset = 0;
+    size_t count = 0;
+
+    while (offset < bytes.size()) {
+        Header header;
+
+        if (bytes.size() - offset < sizeof(header)) {
+            return false;
+        }
+
+        std::memcpy(&header, bytes.data() + offset, sizeof(header));
+
+        if (header.type >= CommandType::Count || header.argCount != GetCommandInfo(header.type).argCount) {
+            return false;
+        }
+
+        const size_t size = recordSize(header);
+
+        if (size > bytes.size() - offset) {
+            return false;
+        }
+
+        offset += size;
+        count++;
+    }
+
+    m_Bytes = std::move(bytes);
+    m_Count = count;
+
+    return true;
+}
+
+size_t CommandBuffer::recordSize(const Header& header) {
+    // Payloads are padded so the next header starts four-byte aligned.
+    return sizeof(Header) + 4 * header.argCount + ((header.dataSize + 3) & ~static_cast<size_t>(3));
+}
+
+void CommandBuffer::record(CommandType type, std::initializer_list<uint32_t> args, const void* data, size_t dataSize) {
+    Header header {};
+    header.type = type;
+    header.argCount = static_cast<uint8_t>(args.size());
+    header.dataSize = static_cast<uint32_t>(dataSize);
+
+    const size_t start = m_Bytes.size();
+    m_Bytes.resize(start + recordSize(header));
+
+    unsigned char* out = m_Bytes.data() + start;
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    for (uint32_t arg : args) {
+        std::memcpy(out, &arg, sizeof(arg));
+        out += sizeof(arg);
+    }
+
+    if (data) {
+        std::memcpy(out, data, dataSize);
+    }
+
+    m_Count++;
+}
+
+void CommandBuffer::setUniform(const Shader& shader, const std::string& name, UniformType type, const void* value, size_t size) {
+    static bool notified = false;
+
+    const GLint location = glGetUniformLocation(shader.GetID(), name.c_str());
+
+    if (location == -1) {
+        if (!notified && !shader.IsFallback()) {
+            std::cerr << "Failed to find \"" << name << "\"" << std::endl;
+            notified = true;
+        }
+
+        return;
+    }
+
+    record(CommandType::Uniform, { static_cast<uint32_t>(location), static_cast<uint32_t>(type) }, value, size);
+}
\ No newline at end of file
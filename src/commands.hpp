@@ -0,0 +1,199 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+#include "utility.hpp"
+
+enum class CommandType : uint8_t {
+    UseProgram,
+    Uniform,
+    BindVertexArray,
+    BindTexture,
+    BindBuffer,
+    BindBufferBase,
+    BufferSubData,
+    VertexAttribPointer,
+    Capability,
+    DepthFunc,
+    PolygonMode,
+    CullFace,
+    BlendFunc,
+    ClearColor,
+    Viewport,
+    Clear,
+    BindFramebuffer,
+    DrawArrays,
+    DrawElementsInstanced,
+    MultiDrawElements,
+    MultiDrawElementsIndirect,
+    Count
+};
+
+constexpr size_t COMMAND_TYPE_COUNT = static_cast<size_t>(CommandType::Count);
+constexpr unsigned int MAX_COMMAND_ARGS = 7;
+
+// What a command argument holds, so a saved frame can find the GL objects it uses and renumber them when
+// loaded into another context.
+enum class CommandArg : uint8_t {
+    Value,
+    Program,
+    VertexArray,
+    Texture,
+    Buffer,
+    Framebuffer,
+    // Only meaningful for the program most recently used before the command.
+    UniformLocation
+};
+
+struct CommandInfo {
+    const char* name;
+    unsigned int argCount;
+    CommandArg args[MAX_COMMAND_ARGS];
+};
+
+const CommandInfo& GetCommandInfo(CommandType type);
+
+enum class UniformType : uint32_t {
+    Int,
+    Float,
+    Vec2,
+    Vec3,
+    Vec4,
+    Mat3,
+    Mat4
+};
+
+// One recorded command as ForEach presents it. Arguments are 32 bits each and are read and written through
+// the accessors, since the stream makes no alignment promises beyond four bytes.
+struct CommandView {
+    CommandType type;
+    unsigned int argCount;
+    unsigned char* args;
+    const unsigned char* data;
+    size_t dataSize;
+
+    uint32_t GetArg(unsigned int index) const {
+        uint32_t value;
+        std::memcpy(&value, args + 4 * index, sizeof(value));
+        return value;
+    }
+
+    void SetArg(unsigned int index, uint32_t value) {
+        std::memcpy(args + 4 * index, &value, sizeof(value));
+    }
+};
+
+// CPU time spent issuing each type of command, summed over every Execute it was passed to.
+struct CommandTimings {
+    unsigned long long counts[COMMAND_TYPE_COUNT] = {};
+    double nanoseconds[COMMAND_TYPE_COUNT] = {};
+};
+
+// Linear stream of the GL calls a pass makes: binds, uniforms, buffer updates, state changes and draws, each a
+// small header, a few 32-bit arguments and any payload copied in at record time. Recording touches no GL state
+// except to resolve uniform locations, so a whole pass can be recorded first and submitted in one go, timed on
+// its own or saved for replay. The buffer keeps its memory across Reset, so steady-state recording doesn't allocate.
+class CommandBuffer {
+public:
+    void Reset();
+
+    bool IsEmpty() const;
+    size_t GetCommandCount() const;
+    size_t GetSize() const;
+
+    void UseProgram(const Shader& shader);
+    void UseProgram(GLuint program);
+
+    // Looks the location up now, as Shader::Set does. Names the program doesn't use record nothing; the first one
+    // is reported, as Shader::Set reports its first.
+    void SetUniform(const Shader& shader, const std::string& name, bool value);
+    void SetUniform(const Shader& shader, const std::string& name, int value);
+    void SetUniform(const Shader& shader, const std::string& name, float value);
+    void SetUniform(const Shader& shader, const std::string& name, const glm::vec2& value);
+    void SetUniform(const Shader& shader, const std::string& name, const glm::vec3& value);
+    void SetUniform(const Shader& shader, const std::string& name, const glm::vec4& value);
+    void SetUniform(const Shader& shader, const std::string& name, const glm::mat3& value);
+    void SetUniform(const Shader& shader, const std::string& name, const glm::mat4& value);
+
+    void BindVertexArray(GLuint vertexArray);
+    // unit is an index, not a GL_TEXTUREi enum. The active unit is left at 0 afterwards.
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    // Copies size bytes of data into the stream.
+    void BufferSubData(GLenum target, size_t offset, size_t size, const void* data);
+    // Applies to the bound vertex array, reading from the buffer bound to GL_ARRAY_BUFFER when it runs.
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset);
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset);
+
+    void Enable(GLenum capability);
+    void Disable(GLenum capability);
+    void DepthFunc(GLenum func);
+    void PolygonMode(GLenum mode);
+    void CullFace(GLenum mode);
+    void BlendFunc(GLenum sourceRgb, GLenum destinationRgb, GLenum sourceAlpha, GLenum destinationAlpha);
+    void ClearColor(const glm::vec4& color);
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void Clear(GLbitfield mask);
+    void BindFramebuffer(GLenum target, GLuint framebuffer);
+
+    void DrawArrays(GLenum mode, GLint first, GLsizei count);
+    // A non-zero baseInstance needs GL 4.2; below that the caller re-points its instance attributes instead.
+    void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instances, GLuint baseInstance = 0);
+    // Copies the counts and offsets into the stream.
+    void MultiDrawElements(GLenum mode, const GLsizei* counts, GLenum type, const void* const* offsets, GLsizei drawCount);
+    // Reads drawCount commands from the bound GL_DRAW_INDIRECT_BUFFER. GL 4.3.
+    void MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, GLsizei drawCount, GLsizei stride);
+
+    // Issues every command in order. With timings, each one is timed and added to its type's total.
+    void Execute(CommandTimings* timings = nullptr) const;
+
+    // The raw stream, for saving frames.
+    const std::vector<unsigned char>& GetBytes() const;
+    // Takes a stream read back from disk. Returns false, leaving the buffer empty, if it doesn't parse.
+    bool Assign(std::vector<unsigned char> bytes);
+
+    // Calls visitor(CommandView&) for each command in order. The visitor may rewrite arguments in place.
+    template <typename Visitor>
+    void ForEach(Visitor&& visitor);
+
+private:
+    struct Header {
+        CommandType type;
+        uint8_t argCount;
+        uint16_t reserved;
+        uint32_t dataSize;
+    };
+
+    std::vector<unsigned char> m_Bytes;
+    size_t m_Count = 0;
+
+    static size_t recordSize(const Header& header);
+
+    void record(CommandType type, std::initializer_list<uint32_t> args, const void* data = nullptr, size_t dataSize = 0);
+    void setUniform(const Shader& shader, const std::string& name, UniformType type, const void* value, size_t size);
+};
+
+template <typename Visitor>
+void CommandBuffer::ForEach(Visitor&& visitor) {
+    size_t offset = 0;
+
+    while (offset < m_Bytes.size()) {
+        Header header;
+        std::memcpy(&header, m_Bytes.data() + offset, sizeof(header));
+
+        unsigned char* args = m_Bytes.data() + offset + sizeof(Header);
+        CommandView view { header.type, header.argCount, args, args + 4 * header.argCount, header.dataSize };
+        visitor(view);
+
+        offset += recordSize(header);
+    }
+}
\ No newline at end of file
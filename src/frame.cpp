@@ -0,0 +1,35 @@
+#include "frame.hpp"
+
+FramePacket& FrameQueue::AcquireWrite() {
+    const unsigned long long written = m_Written.load(std::memory_order_relaxed);
+
+    unsigned long long read = m_Read.load(std::memory_order_acquire);
+    while (written - read == m_Slots.size()) {
+        m_Read.wait(read, std::memory_order_acquire);
+        read = m_Read.load(std::memory_order_acquire);
+    }
+
+    return m_Slots[written % m_Slots.size()];
+}
+
+void FrameQueue::Push() {
+    m_Written.fetch_add(1, std::memory_order_release);
+    m_Written.notify_one();
+}
+
+FramePacket& FrameQueue::AcquireRead() {
+    const unsigned long long read = m_Read.load(std::memory_order_relaxed);
+
+    unsigned long long written = m_Written.load(std::memory_order_acquire);
+    while (written == read) {
+        m_Written.wait(written, std::memory_order_acquire);
+        written = m_Written.load(std::memory_order_acquire);
+    }
+
+    return m_Slots[read % m_Slots.size()];
+}
+
+void FrameQueue::Release() {
+    m_Read.fetch_add(1, std::memory_order_release);
+    m_Read.notify_one();
+}
\ No newline at end of file
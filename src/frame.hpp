@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#include "lod.hpp"
+
+// Everything the render thread needs for one frame. The simulation thread fills it in and never touches
+// it again until the render thread hands the slot back.
+struct FramePacket {
+    unsigned long long frame = 0;
+    // When input for this frame was sampled, for measuring input-to-present latency.
+    std::chrono::steady_clock::time_point inputTime;
+    // Simulation thread CPU time spent producing the packet.
+    float simulationMs = 0.0f;
+
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    int viewportWidth = 0;
+    int viewportHeight = 0;
+
+    bool lineMode = false;
+    bool indirectInstances = true;
+
+    // The draw list is one range per LOD level, so the visible set is the whole of it. It is only copied
+    // when culling changed it; otherwise the render thread keeps drawing the last one it received.
+    VisibleSet visible;
+    bool visibleChanged = false;
+
+    // Last packet of the run; the render thread exits after consuming it.
+    bool quit = false;
+};
+
+// Lock-free single-producer single-consumer queue holding two packets, so the simulation thread can build
+// frame N + 1 while the render thread draws frame N. Each side blocks on an atomic wait only when the other
+// has fallen a whole frame behind.
+class FrameQueue {
+public:
+    // Producer side: a free slot to fill, then Push to publish it.
+    FramePacket& AcquireWrite();
+    void Push();
+
+    // Consumer side: the oldest published packet, then Release to give the slot back.
+    FramePacket& AcquireRead();
+    void Release();
+
+private:
+    std::array<FramePacket, 2> m_Slots;
+    // Packets published and released so far. Slots are used round-robin, so the counters alone say which
+    // slot each side owns.
+    std::atomic<unsigned long long> m_Written = 0;
+    std::atomic<unsigned long long> m_Read = 0;
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "frustum.hpp"
+
+BoundingSphere ComputeBoundingSphere(std::span<const glm::vec3> points) {
+    BoundingSphere sphere;
+
+    if (points.empty()) {
+        return sphere;
+    }
+
+    glm::vec3 min = points[0];
+    glm::vec3 max = points[0];
+
+    for (const glm::vec3& point : points) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    sphere.center = (min + max) * 0.5f;
+
+    for (const glm::vec3& point : points) {
+        sphere.radius = glm::max(sphere.radius, glm::length(point - sphere.center));
+    }
+
+    return sphere;
+}
+
+BoundingSphere TransformSphere(const BoundingSphere& sphere, const glm::mat4& matrix) {
+    float scaleX = glm::length(glm::vec3(matrix[0]));
+    float scaleY = glm::length(glm::vec3(matrix[1]));
+    float scaleZ = glm::length(glm::vec3(matrix[2]));
+
+    BoundingSphere result;
+    result.center = glm::vec3(matrix * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * glm::max(scaleX, glm::max(scaleY, scaleZ));
+
+    return result;
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    m_Planes[0] = row3 + row0;
+    m_Planes[1] = row3 - row0;
+    m_Planes[2] = row3 + row1;
+    m_Planes[3] = row3 - row1;
+    m_Planes[4] = row3 + row2;
+    m_Planes[5] = row3 - row2;
+
+    for (glm::vec4& plane : m_Planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::Intersects(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : m_Planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::Intersects(const glm::vec3& min, const glm::vec3& max) const {
+    for (const glm::vec4& plane : m_Planes) {
+        glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x,
+                           plane.y >= 0.0f ? max.y : min.y,
+                           plane.z >= 0.0f ? max.z : min.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const std::array<glm::vec4, 6>& Frustum::GetPlanes() const {
+    return m_Planes;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// One camera of a frame. Multi-view rendering culls against several and keeps what any of them sees.
+struct CameraView {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+};
+
+BoundingSphere ComputeBoundingSphere(std::span<const glm::vec3> points);
+
+// Transforms a local-space sphere by an instance matrix, scaling the radius by the largest axis scale.
+BoundingSphere TransformSphere(const BoundingSphere& sphere, const glm::mat4& matrix);
+
+class Frustum {
+public:
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    bool Intersects(const glm::vec3& center, float radius) const;
+    bool Intersects(const glm::vec3& min, const glm::vec3& max) const;
+
+    const std::array<glm::vec4, 6>& GetPlanes() const;
+
+private:
+    // Left, right, bottom, top, near, far. Normals point inwards.
+    std::array<glm::vec4, 6> m_Planes;
+};
\ No newline at end of file
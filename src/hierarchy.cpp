@@ -0,0 +1,156 @@
+#include "hierarchy.hpp"
+
+#include <atomic>
+
+glm::mat4 Transform::ToMatrix() const {
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation);
+    return glm::scale(matrix, scale);
+}
+
+NodeId TransformHierarchy::AddNode(NodeId parent, const Transform& local, InstanceHandle instance) {
+    NodeId node = static_cast<NodeId>(m_Position.size());
+    unsigned int position = static_cast<unsigned int>(m_Parent.size());
+
+    unsigned int parentPosition = parent == NO_PARENT ? NO_PARENT : m_Position[parent];
+
+    m_Parent.push_back(parentPosition);
+    m_Depth.push_back(parentPosition == NO_PARENT ? 0 : m_Depth[parentPosition] + 1);
+    m_Local.push_back(local);
+    m_World.push_back(glm::mat4(1.0f));
+    m_Instance.push_back(instance);
+    m_LocalDirty.push_back(1);
+    m_Changed.push_back(0);
+    m_NodeAt.push_back(node);
+    m_Position.push_back(position);
+
+    // Level bounds are rebuilt by the next Update, which also restores depth order if this node broke it.
+    m_Unsorted = true;
+
+    return node;
+}
+
+void TransformHierarchy::SetLocal(NodeId node, const Transform& local) {
+    unsigned int position = m_Position[node];
+
+    m_Local[position] = local;
+    m_LocalDirty[position] = 1;
+}
+
+const Transform& TransformHierarchy::GetLocal(NodeId node) const {
+    return m_Local[m_Position[node]];
+}
+
+const glm::mat4& TransformHierarchy::GetWorld(NodeId node) const {
+    return m_World[m_Position[node]];
+}
+
+size_t TransformHierarchy::Update(ThreadPool& pool, bool full) {
+    if (m_Unsorted) {
+        sort();
+    }
+
+    std::atomic<size_t> recomputed = 0;
+
+    for (size_t level = 0; level + 1 < m_LevelStart.size(); level++) {
+        const size_t levelBegin = m_LevelStart[level];
+        const size_t levelEnd = m_LevelStart[level + 1];
+
+        pool.ParallelFor(levelEnd - levelBegin, GRAIN, [&](size_t begin, size_t end) {
+            size_t count = 0;
+
+            for (size_t i = levelBegin + begin; i < levelBegin + end; i++) {
+                const unsigned int parent = m_Parent[i];
+                const bool dirty = full || m_LocalDirty[i] || (parent != NO_PARENT && m_Changed[parent]);
+
+                m_Changed[i] = dirty;
+
+                if (!dirty) {
+                    continue;
+                }
+
+                glm::mat4 local = m_Local[i].ToMatrix();
+                m_World[i] = parent == NO_PARENT ? local : m_World[parent] * local;
+                m_LocalDirty[i] = 0;
+                count++;
+            }
+
+            recomputed += count;
+        });
+    }
+
+    return recomputed;
+}
+
+void TransformHierarchy::WriteInstances(Model& model) const {
+    for (size_t i = 0; i < m_Changed.size(); i++) {
+        if (m_Changed[i] && m_Instance[i].slot != InstanceHandle::INVALID) {
+            model.SetInstance(m_Instance[i], m_World[i]);
+        }
+    }
+}
+
+size_t TransformHierarchy::GetNodeCount() const {
+    return m_Parent.size();
+}
+
+size_t TransformHierarchy::GetLevelCount() const {
+    return m_LevelStart.empty() ? 0 : m_LevelStart.size() - 1;
+}
+
+// Stable counting sort by depth. Nodes keep their relative order within a level, so a hierarchy built
+// breadth first is left untouched apart from the level bounds.
+void TransformHierarchy::sort() {
+    unsigned int levels = 0;
+    for (unsigned int depth : m_Depth) {
+        levels = std::max(levels, depth + 1);
+    }
+
+    m_LevelStart.assign(levels + 1, 0);
+    for (unsigned int depth : m_Depth) {
+        m_LevelStart[depth + 1]++;
+    }
+
+    for (unsigned int level = 0; level < levels; level++) {
+        m_LevelStart[level + 1] += m_LevelStart[level];
+    }
+
+    std::vector<unsigned int> sorted(m_Depth.size());
+    std::vector<size_t> next(m_LevelStart.begin(), m_LevelStart.end() - 1);
+
+    for (unsigned int i = 0; i < m_Depth.size(); i++) {
+        sorted[i] = static_cast<unsigned int>(next[m_Depth[i]]++);
+    }
+
+    std::vector<unsigned int> parent(m_Parent.size());
+    std::vector<unsigned int> depth(m_Depth.size());
+    std::vector<Transform> local(m_Local.size());
+    std::vector<glm::mat4> world(m_World.size());
+    std::vector<InstanceHandle> instance(m_Instance.size());
+    std::vector<unsigned char> localDirty(m_LocalDirty.size());
+    std::vector<NodeId> nodeAt(m_NodeAt.size());
+
+    for (unsigned int i = 0; i < m_Parent.size(); i++) {
+        unsigned int to = sorted[i];
+
+        parent[to] = m_Parent[i] == NO_PARENT ? NO_PARENT : sorted[m_Parent[i]];
+        depth[to] = m_Depth[i];
+        local[to] = m_Local[i];
+        world[to] = m_World[i];
+        instance[to] = m_Instance[i];
+        localDirty[to] = m_LocalDirty[i];
+        nodeAt[to] = m_NodeAt[i];
+
+        m_Position[m_NodeAt[i]] = to;
+    }
+
+    m_Parent = std::move(parent);
+    m_Depth = std::move(depth);
+    m_Local = std::move(local);
+    m_World = std::move(world);
+    m_Instance = std::move(instance);
+    m_LocalDirty = std::move(localDirty);
+    m_NodeAt = std::move(nodeAt);
+    m_Changed.assign(m_Parent.size(), 0);
+
+    m_Unsorted = false;
+}
\ No newline at end of file
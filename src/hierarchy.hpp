@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+#include "model.hpp"
+#include "parallel.hpp"
+#include "registry.hpp"
+
+using NodeId = unsigned int;
+
+constexpr NodeId NO_PARENT = 0xFFFFFFFF;
+
+struct Transform {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    glm::mat4 ToMatrix() const;
+};
+
+// Parent-relative transforms kept in flat arrays sorted by depth, so every level is one contiguous run
+// whose parents all sit in earlier runs. Update walks the levels in order and fans each one out over a
+// thread pool, recomputing only nodes whose local transform or parent changed.
+class TransformHierarchy {
+public:
+    // Nodes may drive a model instance, whose matrix is replaced by the node's world matrix.
+    NodeId AddNode(NodeId parent, const Transform& local, InstanceHandle instance = InstanceHandle());
+
+    void SetLocal(NodeId node, const Transform& local);
+    const Transform& GetLocal(NodeId node) const;
+    const glm::mat4& GetWorld(NodeId node) const;
+
+    // Recomputes dirty nodes and their descendants. full recomputes every node instead, as a baseline.
+    // Returns the number of world matrices recomputed.
+    size_t Update(ThreadPool& pool, bool full = false);
+
+    // Copies the world matrices recomputed by the last Update into the instances they drive.
+    void WriteInstances(Model& model) const;
+
+    size_t GetNodeCount() const;
+    size_t GetLevelCount() const;
+
+private:
+    // Nodes handled by one task in each level's parallel loop.
+    static constexpr size_t GRAIN = 4096;
+
+    // Indexed by depth-sorted position. Parents are stored as positions too.
+    std::vector<unsigned int> m_Parent;
+    std::vector<unsigned int> m_Depth;
+    std::vector<Transform> m_Local;
+    std::vector<glm::mat4> m_World;
+    std::vector<InstanceHandle> m_Instance;
+    std::vector<unsigned char> m_LocalDirty;
+    std::vector<unsigned char> m_Changed;
+    std::vector<NodeId> m_NodeAt;
+
+    // Position of each node, which moves whenever the arrays are re-sorted.
+    std::vector<unsigned int> m_Position;
+    // Start of every depth level in the sorted arrays, plus the end.
+    std::vector<size_t> m_LevelStart;
+    bool m_Unsorted = false;
+
+    void sort();
+};
\ No newline at end of file
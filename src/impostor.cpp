@@ -0,0 +1,153 @@
+#include "impostor.hpp"
+
+ImpostorAtlas::~ImpostorAtlas() {
+    if (m_Texture) {
+        ReleaseGpuMemory(GpuResource::Texture, m_Texture);
+        GL_CHECK(glDeleteTextures(1, &m_Texture));
+    }
+
+    if (m_VAO) {
+        GL_CHECK(glDeleteVertexArrays(1, &m_VAO));
+    }
+}
+
+void ImpostorAtlas::Bake(std::vector<Mesh>& meshes, const BoundingSphere& bounds, Shader& bakeShader, const ImpostorSettings& settings) {
+    m_Settings = settings;
+    m_Bounds = bounds;
+
+    const GLsizei width = static_cast<GLsizei>(settings.columns * settings.cellSize);
+    const GLsizei height = static_cast<GLsizei>(settings.rows * settings.cellSize);
+
+    if (!m_Texture) {
+        GL_CHECK(glGenTextures(1, &m_Texture));
+    }
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_Texture));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    TrackGpuMemory(GpuResource::Texture, m_Texture, MemoryCategory::Textures, static_cast<size_t>(width) * height * 4 * 4 / 3);
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    GLuint depth;
+    GL_CHECK(glGenRenderbuffers(1, &depth));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, depth));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+
+    GLuint framebuffer;
+    GL_CHECK(glGenFramebuffers(1, &framebuffer));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Texture, 0));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth));
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: Impostor atlas framebuffer is incomplete" << std::endl;
+    }
+
+    GLint viewport[4];
+    GLfloat clearColor[4];
+    GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+    GL_CHECK(glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor));
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+    GL_CHECK(glViewport(0, 0, width, height));
+    GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    GL_CHECK(glDisable(GL_CULL_FACE));
+
+    const float radius = glm::max(bounds.radius, 1e-4f);
+    const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+
+    bakeShader.Use();
+    bakeShader.Set("projection", projection);
+
+    for (unsigned int row = 0; row < settings.rows; row++) {
+        // Cell centres in elevation, so no view sits exactly on a pole where the up vector degenerates.
+        float elevation = ((row + 0.5f) / settings.rows - 0.5f) * glm::pi<float>();
+
+        for (unsigned int column = 0; column < settings.columns; column++) {
+            float azimuth = static_cast<float>(column) / settings.columns * glm::two_pi<float>();
+
+            glm::vec3 direction(std::cos(elevation) * std::cos(azimuth), std::sin(elevation), std::cos(elevation) * std::sin(azimuth));
+            glm::mat4 view = glm::lookAt(bounds.center + direction * 2.0f * radius, bounds.center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+            bakeShader.Set("view", view);
+
+            GL_CHECK(glViewport(column * settings.cellSize, row * settings.cellSize, settings.cellSize, settings.cellSize));
+
+            CommandBuffer commands;
+            for (Mesh& mesh : meshes) {
+                mesh.Draw(commands, 1);
+            }
+
+            commands.Execute();
+        }
+    }
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_Texture));
+    GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GL_CHECK(glDeleteFramebuffers(1, &framebuffer));
+    GL_CHECK(glDeleteRenderbuffers(1, &depth));
+
+    if (cullFace) {
+        GL_CHECK(glEnable(GL_CULL_FACE));
+    }
+
+    GL_CHECK(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+    GL_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+}
+
+void ImpostorAtlas::Draw(Shader& shader, CommandBuffer& commands, unsigned int first, unsigned int count) {
+    if (!m_Texture || !m_VAO || count == 0) {
+        return;
+    }
+
+    commands.SetUniform(shader, "bounds", glm::vec4(m_Bounds.center, m_Bounds.radius));
+    commands.SetUniform(shader, "atlasGrid", glm::vec2(static_cast<float>(m_Settings.columns), static_cast<float>(m_Settings.rows)));
+    commands.SetUniform(shader, "atlas", 0);
+
+    commands.BindTexture(0, GL_TEXTURE_2D, m_Texture);
+
+    commands.Enable(GL_PROGRAM_POINT_SIZE);
+    commands.BindVertexArray(m_VAO);
+    commands.DrawArrays(GL_POINTS, static_cast<GLint>(first), static_cast<GLsizei>(count));
+    commands.BindVertexArray(0);
+    commands.Disable(GL_PROGRAM_POINT_SIZE);
+}
+
+void ImpostorAtlas::SetInstanceBuffer(unsigned int buffer) {
+    if (!m_VAO) {
+        GL_CHECK(glGenVertexArrays(1, &m_VAO));
+    }
+
+    // Each sprite is a single vertex, so the instance matrices are read per vertex rather than per instance.
+    GL_CHECK(glBindVertexArray(m_VAO));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+
+    for (unsigned int column = 0; column < 4; column++) {
+        GL_CHECK(glEnableVertexAttribArray(3 + column));
+        GL_CHECK(glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(column * sizeof(glm::vec4))));
+    }
+
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void ImpostorAtlas::SetInstanceIdBuffer(unsigned int buffer) {
+    if (!m_VAO) {
+        GL_CHECK(glGenVertexArrays(1, &m_VAO));
+    }
+
+    GL_CHECK(glBindVertexArray(m_VAO));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    GL_CHECK(glEnableVertexAttribArray(7));
+    GL_CHECK(glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(unsigned int), reinterpret_cast<void*>(0)));
+    GL_CHECK(glBindVertexArray(0));
+}
+
+bool ImpostorAtlas::IsBaked() const {
+    return m_Texture != 0;
+}
\ No newline at end of file
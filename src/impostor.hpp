@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <vector>
+
+#include "commands.hpp"
+#include "frustum.hpp"
+#include "memory.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "utility.hpp"
+
+struct ImpostorSettings {
+    // Views around the model baked into the atlas, laid out as columns of azimuth and rows of elevation.
+    unsigned int columns = 8;
+    unsigned int rows = 4;
+    unsigned int cellSize = 64;
+};
+
+// Multi-view atlas of a model rendered at load time. Each cell stores the local-space normal in RGB and
+// coverage in alpha so the far-field sprites can be shaded like the full mesh.
+class ImpostorAtlas {
+public:
+    ImpostorAtlas() = default;
+    ~ImpostorAtlas();
+
+    ImpostorAtlas(const ImpostorAtlas&) = delete;
+    ImpostorAtlas& operator=(const ImpostorAtlas&) = delete;
+
+    void Bake(std::vector<Mesh>& meshes, const BoundingSphere& bounds, Shader& bakeShader, const ImpostorSettings& settings = ImpostorSettings());
+
+    // Draws count instances starting at first from the instance buffer as one point sprite each.
+    void Draw(Shader& shader, CommandBuffer& commands, unsigned int first, unsigned int count);
+
+    // Points the sprite attributes at the model's instance buffer. Called again whenever that buffer changes.
+    void SetInstanceBuffer(unsigned int buffer);
+    void SetInstanceIdBuffer(unsigned int buffer);
+
+    bool IsBaked() const;
+
+private:
+    ImpostorSettings m_Settings;
+    BoundingSphere m_Bounds;
+
+    GLuint m_Texture = 0;
+    GLuint m_VAO = 0;
+};
\ No newline at end of file
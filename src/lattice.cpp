@@ -0,0 +1,139 @@
+#include "lattice.hpp"
+
+namespace {
+    // Must match hash() in lattice.vert.
+    unsigned int hash(unsigned int x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // std140 layout of the Lattice block.
+    struct LatticeBlock {
+        glm::vec4 origin;
+        glm::vec4 spacing;
+        glm::uvec4 dims;
+        glm::uvec4 bricks;
+    };
+
+    glm::vec3 jitterOffset(const LatticeDesc& desc, const glm::uvec3& cell) {
+        if (!desc.jitterSeed) {
+            return glm::vec3(0.0f);
+        }
+
+        unsigned int h = hash(cell.x ^ hash(cell.y ^ hash(cell.z ^ desc.jitterSeed)));
+        glm::vec3 random(static_cast<float>(h & 0x3FFu), static_cast<float>((h >> 10) & 0x3FFu), static_cast<float>((h >> 20) & 0x3FFu));
+
+        return (random / 1023.0f * 2.0f - 1.0f) * desc.jitter * desc.spacing;
+    }
+}
+
+glm::mat4 LatticeMatrix(const LatticeDesc& desc, const glm::uvec3& cell) {
+    glm::vec3 position = desc.origin + glm::vec3(cell.x, cell.y, cell.z) * desc.spacing + jitterOffset(desc, cell);
+
+    glm::mat4 matrix(1.0f);
+    matrix = glm::translate(matrix, position);
+    matrix = glm::scale(matrix, glm::vec3(desc.scale));
+
+    return matrix;
+}
+
+std::vector<glm::mat4> BuildLatticeMatrices(const LatticeDesc& desc) {
+    std::vector<glm::mat4> matrices;
+    matrices.reserve(static_cast<size_t>(desc.dims.x) * desc.dims.y * desc.dims.z);
+
+    for (unsigned int x = 0; x < desc.dims.x; x++) {
+        for (unsigned int y = 0; y < desc.dims.y; y++) {
+            for (unsigned int z = 0; z < desc.dims.z; z++) {
+                matrices.push_back(LatticeMatrix(desc, glm::uvec3(x, y, z)));
+            }
+        }
+    }
+
+    return matrices;
+}
+
+ProceduralLattice::ProceduralLattice(const LatticeDesc& desc) : m_Desc(desc) {
+    m_Bricks = glm::uvec3((desc.dims.x + BRICK_SIZE - 1) / BRICK_SIZE,
+                          (desc.dims.y + BRICK_SIZE - 1) / BRICK_SIZE,
+                          (desc.dims.z + BRICK_SIZE - 1) / BRICK_SIZE);
+
+    LatticeBlock block;
+    block.origin = glm::vec4(desc.origin, desc.scale);
+    block.spacing = glm::vec4(desc.spacing, desc.jitterSeed ? desc.jitter : 0.0f);
+    block.dims = glm::uvec4(desc.dims.x, desc.dims.y, desc.dims.z, desc.jitterSeed);
+    block.bricks = glm::uvec4(m_Bricks.x, m_Bricks.y, m_Bricks.z, BRICK_SIZE);
+
+    GL_CHECK(glGenBuffers(1, &m_UBO));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_UBO));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, sizeof(LatticeBlock), &block, GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, m_UBO, MemoryCategory::Instances, sizeof(LatticeBlock));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+
+    m_Ranges.push_back({ 0, GetInstanceCount() });
+}
+
+ProceduralLattice::~ProceduralLattice() {
+    ReleaseGpuMemory(GpuResource::Buffer, m_UBO);
+    GL_CHECK(glDeleteBuffers(1, &m_UBO));
+}
+
+void ProceduralLattice::Cull(const glm::mat4& viewProjection, const BoundingSphere& localBounds) {
+    Frustum frustum(viewProjection);
+
+    const unsigned int brickVolume = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    const float jitter = m_Desc.jitterSeed ? m_Desc.jitter : 0.0f;
+    const glm::vec3 margin = glm::abs(m_Desc.spacing) * jitter + glm::vec3(localBounds.radius * m_Desc.scale);
+    const glm::vec3 offset = localBounds.center * m_Desc.scale;
+
+    m_Ranges.clear();
+
+    unsigned int brick = 0;
+    for (unsigned int bx = 0; bx < m_Bricks.x; bx++) {
+        for (unsigned int by = 0; by < m_Bricks.y; by++) {
+            for (unsigned int bz = 0; bz < m_Bricks.z; bz++, brick++) {
+                glm::uvec3 first(bx * BRICK_SIZE, by * BRICK_SIZE, bz * BRICK_SIZE);
+                glm::uvec3 last(glm::min(first.x + BRICK_SIZE, m_Desc.dims.x) - 1,
+                                glm::min(first.y + BRICK_SIZE, m_Desc.dims.y) - 1,
+                                glm::min(first.z + BRICK_SIZE, m_Desc.dims.z) - 1);
+
+                glm::vec3 a = m_Desc.origin + glm::vec3(first.x, first.y, first.z) * m_Desc.spacing + offset;
+                glm::vec3 b = m_Desc.origin + glm::vec3(last.x, last.y, last.z) * m_Desc.spacing + offset;
+
+                if (!frustum.Intersects(glm::min(a, b) - margin, glm::max(a, b) + margin)) {
+                    continue;
+                }
+
+                unsigned int start = brick * brickVolume;
+                if (!m_Ranges.empty() && m_Ranges.back().first + m_Ranges.back().count == start) {
+                    m_Ranges.back().count += brickVolume;
+                } else {
+                    m_Ranges.push_back({ start, brickVolume });
+                }
+            }
+        }
+    }
+}
+
+void ProceduralLattice::Bind(CommandBuffer& commands) const {
+    commands.BindBufferBase(GL_UNIFORM_BUFFER, LATTICE_UBO_BINDING, m_UBO);
+}
+
+const std::vector<InstanceRange>& ProceduralLattice::GetRanges() const {
+    return m_Ranges;
+}
+
+const LatticeDesc& ProceduralLattice::GetDesc() const {
+    return m_Desc;
+}
+
+unsigned int ProceduralLattice::GetInstanceCount() const {
+    return m_Bricks.x * m_Bricks.y * m_Bricks.z * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+}
+
+glm::mat4 ProceduralLattice::GetMatrix(const glm::uvec3& cell) const {
+    return LatticeMatrix(m_Desc, cell);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+
+#include "commands.hpp"
+#include "frustum.hpp"
+#include "lod.hpp"
+#include "memory.hpp"
+#include "utility.hpp"
+
+constexpr GLuint LATTICE_UBO_BINDING = 0;
+
+struct LatticeDesc {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 spacing = glm::vec3(5.0f, 5.0f, -5.0f);
+    glm::uvec3 dims = glm::uvec3(100, 100, 100);
+    float scale = 0.1f;
+    // Per-instance random offset as a fraction of the spacing. A seed of 0 disables it.
+    unsigned int jitterSeed = 0;
+    float jitter = 0.25f;
+};
+
+// Instance transforms computed from gl_InstanceID in lattice.vert instead of being stored per instance.
+// Instances are numbered brick by brick so any run of visible bricks is one contiguous instance range.
+class ProceduralLattice {
+public:
+    static constexpr unsigned int BRICK_SIZE = 8;
+
+    explicit ProceduralLattice(const LatticeDesc& desc);
+    ~ProceduralLattice();
+
+    ProceduralLattice(const ProceduralLattice&) = delete;
+    ProceduralLattice& operator=(const ProceduralLattice&) = delete;
+
+    void Cull(const glm::mat4& viewProjection, const BoundingSphere& localBounds);
+
+    // Binds the descriptor block; draws must also set the "instanceBase" uniform to the range start.
+    void Bind(CommandBuffer& commands) const;
+
+    const std::vector<InstanceRange>& GetRanges() const;
+    const LatticeDesc& GetDesc() const;
+    unsigned int GetInstanceCount() const;
+
+    // CPU reference of the transform lattice.vert decodes, for anything that needs the matrices back.
+    glm::mat4 GetMatrix(const glm::uvec3& cell) const;
+
+private:
+    LatticeDesc m_Desc;
+    glm::uvec3 m_Bricks;
+    std::vector<InstanceRange> m_Ranges;
+
+    GLuint m_UBO = 0;
+};
+
+// Transform of one lattice cell, the CPU reference of what lattice.vert decodes.
+glm::mat4 LatticeMatrix(const LatticeDesc& desc, const glm::uvec3& cell);
+// Every cell's transform with z varying fastest, for a model that stores its instances.
+std::vector<glm::mat4> BuildLatticeMatrices(const LatticeDesc& desc);
\ No newline at end of file
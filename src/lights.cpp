@@ -0,0 +1,319 @@
+#include "lights.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    void uploadBuffer(GLuint buffer, const void* data, size_t bytes) {
+        GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, buffer));
+        GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW));
+        GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+
+        TrackGpuMemory(GpuResource::Buffer, buffer, MemoryCategory::Lighting, bytes);
+    }
+
+    void createBufferTexture(GLuint& buffer, GLuint& texture, GLenum format, size_t bytes) {
+        GL_CHECK(glGenBuffers(1, &buffer));
+        GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, buffer));
+        GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW));
+        GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+        TrackGpuMemory(GpuResource::Buffer, buffer, MemoryCategory::Lighting, bytes);
+
+        GL_CHECK(glGenTextures(1, &texture));
+        GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, texture));
+        GL_CHECK(glTexBuffer(GL_TEXTURE_BUFFER, format, buffer));
+        GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, 0));
+    }
+}
+
+LightClusters::LightClusters(const ClusterSettings& settings) : m_Settings(settings) {
+    m_Settings.tilesX = std::max(m_Settings.tilesX, 1u);
+    m_Settings.tilesY = std::max(m_Settings.tilesY, 1u);
+    m_Settings.slices = std::max(m_Settings.slices, 1u);
+    m_Settings.maxLightsPerCluster = std::max(m_Settings.maxLightsPerCluster, 1u);
+
+    createBufferTexture(m_LightBuffer, m_LightTexture, GL_RGBA32F, 2 * sizeof(glm::vec4));
+    createBufferTexture(m_GridBuffer, m_GridTexture, GL_RG32UI, getClusterCount() * sizeof(glm::uvec2));
+    createBufferTexture(m_IndexBuffer, m_IndexTexture, GL_R32UI, sizeof(unsigned int));
+
+    m_Grid.assign(getClusterCount(), glm::uvec2(0, 0));
+}
+
+LightClusters::~LightClusters() {
+    GL_CHECK(glDeleteTextures(1, &m_LightTexture));
+    GL_CHECK(glDeleteTextures(1, &m_GridTexture));
+    GL_CHECK(glDeleteTextures(1, &m_IndexTexture));
+
+    ReleaseGpuMemory(GpuResource::Buffer, m_LightBuffer);
+    ReleaseGpuMemory(GpuResource::Buffer, m_GridBuffer);
+    ReleaseGpuMemory(GpuResource::Buffer, m_IndexBuffer);
+    GL_CHECK(glDeleteBuffers(1, &m_LightBuffer));
+    GL_CHECK(glDeleteBuffers(1, &m_GridBuffer));
+    GL_CHECK(glDeleteBuffers(1, &m_IndexBuffer));
+}
+
+void LightClusters::Build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, ThreadPool& pool) {
+    MemoryScope scope(MemoryCategory::Lighting);
+    auto start = std::chrono::steady_clock::now();
+
+    if (projection != m_Projection || nearPlane != m_Near || farPlane != m_Far) {
+        rebuildClusters(projection, nearPlane, farPlane);
+    }
+
+    const size_t count = lights.size();
+
+    m_Bounds.resize(count);
+    m_SliceFirst.resize(count);
+    m_SliceLast.resize(count);
+
+    pool.ParallelFor(count, 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            boundLight(lights[i], view, i);
+        }
+    });
+
+    const unsigned int clusters = getClusterCount();
+    const unsigned int maxLights = m_Settings.maxLightsPerCluster;
+    const unsigned int tilesX = m_Settings.tilesX;
+    const unsigned int tilesY = m_Settings.tilesY;
+
+    m_Counts.assign(clusters, 0);
+    m_Scratch.resize(static_cast<size_t>(clusters) * maxLights);
+
+    std::atomic<unsigned int> overflowed = 0;
+
+    // Each slice is one task and owns every cluster in it, so lists are appended to without synchronisation.
+    // The scan is scalar. Each light only visits the tiles it covers, and walking those and appending costs more
+    // than the sphere tests themselves, so testing lights in SIMD lanes against every tile of a row, or against
+    // per-tile candidate lists, gave identical lists but ran no faster.
+    pool.ParallelFor(m_Settings.slices, 1, [&](size_t begin, size_t end) {
+        unsigned int dropped = 0;
+
+        for (size_t slice = begin; slice < end; slice++) {
+            for (size_t i = 0; i < count; i++) {
+                if (m_SliceFirst[i] > slice || m_SliceLast[i] < slice) {
+                    continue;
+                }
+
+                const LightBounds& bounds = m_Bounds[i];
+                const glm::vec3 center(bounds.sphere);
+                const float radiusSquared = bounds.sphere.w * bounds.sphere.w;
+
+                for (unsigned int y = bounds.tilesY.x; y <= bounds.tilesY.y; y++) {
+                    for (unsigned int x = bounds.tilesX.x; x <= bounds.tilesX.y; x++) {
+                        const unsigned int cluster = (static_cast<unsigned int>(slice) * tilesY + y) * tilesX + x;
+
+                        glm::vec3 offset = glm::clamp(center, m_ClusterMin[cluster], m_ClusterMax[cluster]) - center;
+
+                        if (glm::dot(offset, offset) > radiusSquared) {
+                            continue;
+                        }
+
+                        unsigned int& clusterCount = m_Counts[cluster];
+
+                        if (clusterCount == maxLights) {
+                            dropped++;
+                            continue;
+                        }
+
+                        m_Scratch[static_cast<size_t>(cluster) * maxLights + clusterCount++] = static_cast<unsigned int>(i);
+                    }
+                }
+            }
+        }
+
+        overflowed += dropped;
+    });
+
+    m_Grid.resize(clusters);
+    m_Stats.maxPerCluster = 0;
+
+    size_t total = 0;
+    for (unsigned int cluster = 0; cluster < clusters; cluster++) {
+        m_Grid[cluster] = glm::uvec2(static_cast<unsigned int>(total), m_Counts[cluster]);
+        total += m_Counts[cluster];
+        m_Stats.maxPerCluster = std::max(m_Stats.maxPerCluster, m_Counts[cluster]);
+    }
+
+    m_Indices.resize(total);
+
+    for (unsigned int cluster = 0; cluster < clusters; cluster++) {
+        auto first = m_Scratch.begin() + static_cast<size_t>(cluster) * maxLights;
+        std::copy(first, first + m_Counts[cluster], m_Indices.begin() + m_Grid[cluster].x);
+    }
+
+    m_Stats.indices = total;
+    m_Stats.overflowed = overflowed;
+    m_Stats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusters::Upload(const std::vector<PointLight>& lights, bool clusters) {
+    MemoryScope scope(MemoryCategory::Lighting);
+    auto start = std::chrono::steady_clock::now();
+
+    m_LightCount = static_cast<unsigned int>(lights.size());
+    m_LightData.resize(std::max<size_t>(lights.size(), 1) * 2, glm::vec4(0.0f));
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        m_LightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+        m_LightData[i * 2 + 1] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+    }
+
+    uploadBuffer(m_LightBuffer, m_LightData.data(), m_LightData.size() * sizeof(glm::vec4));
+
+    if (clusters) {
+        // A buffer texture can't be empty, so a frame without any assignments still uploads one index.
+        if (m_Indices.empty()) {
+            m_Indices.push_back(0);
+        }
+
+        uploadBuffer(m_GridBuffer, m_Grid.data(), m_Grid.size() * sizeof(glm::uvec2));
+        uploadBuffer(m_IndexBuffer, m_Indices.data(), m_Indices.size() * sizeof(unsigned int));
+    }
+
+    m_Stats.uploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusters::Bind(Shader& shader, CommandBuffer& commands, LightingMode mode, float viewportWidth, float viewportHeight) const {
+    commands.SetUniform(shader, "lightingMode", static_cast<int>(mode));
+
+    if (mode == LightingMode::None) {
+        return;
+    }
+
+    commands.BindTexture(LIGHT_DATA_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_LightTexture);
+    commands.BindTexture(LIGHT_GRID_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_GridTexture);
+    commands.BindTexture(LIGHT_INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_IndexTexture);
+
+    commands.SetUniform(shader, "lightData", static_cast<int>(LIGHT_DATA_TEXTURE_UNIT));
+    commands.SetUniform(shader, "lightGrid", static_cast<int>(LIGHT_GRID_TEXTURE_UNIT));
+    commands.SetUniform(shader, "lightIndices", static_cast<int>(LIGHT_INDEX_TEXTURE_UNIT));
+    commands.SetUniform(shader, "lightCount", static_cast<int>(m_LightCount));
+
+    const float tilesX = static_cast<float>(m_Settings.tilesX);
+    const float tilesY = static_cast<float>(m_Settings.tilesY);
+    const float slices = static_cast<float>(m_Settings.slices);
+
+    commands.SetUniform(shader, "clusterGrid", glm::vec3(tilesX, tilesY, slices));
+    commands.SetUniform(shader, "clusterScale", glm::vec2(tilesX / viewportWidth, tilesY / viewportHeight));
+    commands.SetUniform(shader, "clusterDepth", glm::vec2(m_Near, slices / std::log(m_Far / m_Near)));
+}
+
+const ClusterSettings& LightClusters::GetSettings() const {
+    return m_Settings;
+}
+
+const ClusterStats& LightClusters::GetStats() const {
+    return m_Stats;
+}
+
+unsigned int LightClusters::getClusterCount() const {
+    return m_Settings.tilesX * m_Settings.tilesY * m_Settings.slices;
+}
+
+float LightClusters::sliceDepth(unsigned int slice) const {
+    return m_Near * std::pow(m_Far / m_Near, static_cast<float>(slice) / static_cast<float>(m_Settings.slices));
+}
+
+void LightClusters::rebuildClusters(const glm::mat4& projection, float nearPlane, float farPlane) {
+    m_Projection = projection;
+    m_Near = nearPlane;
+    m_Far = farPlane;
+
+    const unsigned int tilesX = m_Settings.tilesX;
+    const unsigned int tilesY = m_Settings.tilesY;
+
+    m_ClusterMin.resize(getClusterCount());
+    m_ClusterMax.resize(getClusterCount());
+
+    for (unsigned int slice = 0; slice < m_Settings.slices; slice++) {
+        const float nearDepth = sliceDepth(slice);
+        const float farDepth = sliceDepth(slice + 1);
+
+        for (unsigned int y = 0; y < tilesY; y++) {
+            const float bottom = -1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(tilesY);
+            const float top = -1.0f + 2.0f * static_cast<float>(y + 1) / static_cast<float>(tilesY);
+
+            for (unsigned int x = 0; x < tilesX; x++) {
+                const float left = -1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(tilesX);
+                const float right = -1.0f + 2.0f * static_cast<float>(x + 1) / static_cast<float>(tilesX);
+
+                // The tile's edges spread out with depth, so the box spans both ends of the slice.
+                const unsigned int cluster = (slice * tilesY + y) * tilesX + x;
+
+                m_ClusterMin[cluster] = glm::vec3(std::min(left * nearDepth, left * farDepth) / projection[0][0],
+                                                  std::min(bottom * nearDepth, bottom * farDepth) / projection[1][1],
+                                                  -farDepth);
+                m_ClusterMax[cluster] = glm::vec3(std::max(right * nearDepth, right * farDepth) / projection[0][0],
+                                                  std::max(top * nearDepth, top * farDepth) / projection[1][1],
+                                                  -nearDepth);
+            }
+        }
+    }
+}
+
+void LightClusters::boundLight(const PointLight& light, const glm::mat4& view, size_t index) {
+    const glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+    const float radius = light.radius;
+    const float depth = -center.z;
+
+    LightBounds& bounds = m_Bounds[index];
+    bounds.sphere = glm::vec4(center, radius);
+
+    m_SliceFirst[index] = 1;
+    m_SliceLast[index] = 0;
+
+    if (depth + radius < m_Near || depth - radius > m_Far) {
+        return;
+    }
+
+    const float slices = static_cast<float>(m_Settings.slices);
+    const float depthScale = slices / std::log(m_Far / m_Near);
+
+    auto sliceOf = [&](float d) {
+        float slice = std::floor(std::log(std::max(d, m_Near) / m_Near) * depthScale);
+        return static_cast<unsigned int>(glm::clamp(slice, 0.0f, slices - 1.0f));
+    };
+
+    const unsigned int tilesX = m_Settings.tilesX;
+    const unsigned int tilesY = m_Settings.tilesY;
+
+    bounds.tilesX = glm::uvec2(0, tilesX - 1);
+    bounds.tilesY = glm::uvec2(0, tilesY - 1);
+
+    // Lights reaching past the near plane could cover any tile. Otherwise the sphere's box projects to a
+    // screen rectangle bounded by its corners, since x / depth is monotonic in both.
+    const float nearest = depth - radius;
+
+    if (nearest > m_Near) {
+        const float farthest = depth + radius;
+
+        auto project = [&](float value, float scale, bool lowest) {
+            float a = value / nearest * scale;
+            float b = value / farthest * scale;
+            return lowest ? std::min(a, b) : std::max(a, b);
+        };
+
+        const float minX = project(center.x - radius, m_Projection[0][0], true);
+        const float maxX = project(center.x + radius, m_Projection[0][0], false);
+        const float minY = project(center.y - radius, m_Projection[1][1], true);
+        const float maxY = project(center.y + radius, m_Projection[1][1], false);
+
+        if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+            return;
+        }
+
+        auto tileOf = [](float ndc, unsigned int tiles) {
+            float tile = std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tiles));
+            return static_cast<unsigned int>(glm::clamp(tile, 0.0f, static_cast<float>(tiles - 1)));
+        };
+
+        bounds.tilesX = glm::uvec2(tileOf(minX, tilesX), tileOf(maxX, tilesX));
+        bounds.tilesY = glm::uvec2(tileOf(minY, tilesY), tileOf(maxY, tilesY));
+    }
+
+    m_SliceFirst[index] = sliceOf(depth - radius);
+    m_SliceLast[index] = sliceOf(std::min(depth + radius, m_Far));
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "commands.hpp"
+#include "memory.hpp"
+#include "parallel.hpp"
+#include "shader.hpp"
+#include "utility.hpp"
+
+// Texture units holding the light buffers, kept clear of the material units and the transform buffer.
+constexpr GLuint LIGHT_DATA_TEXTURE_UNIT = 12;
+constexpr GLuint LIGHT_GRID_TEXTURE_UNIT = 13;
+constexpr GLuint LIGHT_INDEX_TEXTURE_UNIT = 14;
+
+struct PointLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    // Distance at which the light's contribution reaches zero.
+    float radius = 20.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+};
+
+// Must match the lightingMode values in model.frag.
+enum class LightingMode {
+    None = 0,
+    Clustered = 1,
+    BruteForce = 2
+};
+
+struct ClusterSettings {
+    // Screen tiles across and down, and depth slices spaced logarithmically between the near and far planes.
+    unsigned int tilesX = 16;
+    unsigned int tilesY = 9;
+    unsigned int slices = 24;
+    // Lights past this many in one cluster are dropped from it.
+    unsigned int maxLightsPerCluster = 256;
+};
+
+struct ClusterStats {
+    float cullMs = 0.0f;
+    float uploadMs = 0.0f;
+    // Light indices across all clusters, and the most any one cluster holds.
+    size_t indices = 0;
+    unsigned int maxPerCluster = 0;
+    unsigned int overflowed = 0;
+};
+
+// Clustered forward shading. Build assigns lights to a froxel grid fitted to the camera, and Upload writes the
+// lights, each cluster's offset and count and the packed index lists to buffer textures that model.frag reads,
+// so a fragment only loops over the lights that can reach its cluster.
+class LightClusters {
+public:
+    explicit LightClusters(const ClusterSettings& settings = ClusterSettings());
+    ~LightClusters();
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // CPU only. Slices are spread over the pool, each owning its clusters, so no locking is needed.
+    void Build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, ThreadPool& pool);
+
+    // Brute-force shading only needs the lights themselves, so the cluster lists can be skipped.
+    void Upload(const std::vector<PointLight>& lights, bool clusters = true);
+
+    // Binds the buffers and sets the uniforms model.frag reads. The viewport is the one being rendered to.
+    void Bind(Shader& shader, CommandBuffer& commands, LightingMode mode, float viewportWidth, float viewportHeight) const;
+
+    const ClusterSettings& GetSettings() const;
+    const ClusterStats& GetStats() const;
+
+private:
+    // A light's view-space sphere and the tiles its projected bounds cover.
+    struct LightBounds {
+        glm::vec4 sphere;
+        glm::uvec2 tilesX;
+        glm::uvec2 tilesY;
+    };
+
+    ClusterSettings m_Settings;
+    ClusterStats m_Stats;
+
+    // View-space bounds of every cluster, rebuilt when the projection changes.
+    std::vector<glm::vec3> m_ClusterMin;
+    std::vector<glm::vec3> m_ClusterMax;
+    glm::mat4 m_Projection = glm::mat4(0.0f);
+    float m_Near = 0.0f;
+    float m_Far = 0.0f;
+
+    std::vector<LightBounds> m_Bounds;
+    // First and last slice of each light, kept apart from the rest so the per-slice scan reads only these. A
+    // culled light has its first slice past its last.
+    std::vector<unsigned int> m_SliceFirst;
+    std::vector<unsigned int> m_SliceLast;
+
+    // Fixed-size list per cluster filled during Build, then packed into m_Indices.
+    std::vector<unsigned int> m_Scratch;
+    std::vector<unsigned int> m_Counts;
+    std::vector<glm::uvec2> m_Grid;
+    std::vector<unsigned int> m_Indices;
+    std::vector<glm::vec4> m_LightData;
+    unsigned int m_LightCount = 0;
+
+    GLuint m_LightBuffer = 0;
+    GLuint m_LightTexture = 0;
+    GLuint m_GridBuffer = 0;
+    GLuint m_GridTexture = 0;
+    GLuint m_IndexBuffer = 0;
+    GLuint m_IndexTexture = 0;
+
+    unsigned int getClusterCount() const;
+    float sliceDepth(unsigned int slice) const;
+    void rebuildClusters(const glm::mat4& projection, float nearPlane, float farPlane);
+    void boundLight(const PointLight& light, const glm::mat4& view, size_t index);
+};
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "lod.hpp"
+
+void LodSelector::SetInstances(const std::vector<glm::mat4>& matrices, const BoundingSphere& localBounds) {
+    m_Spheres.resize(matrices.size());
+
+    for (size_t i = 0; i < matrices.size(); i++) {
+        BoundingSphere sphere = TransformSphere(localBounds, matrices[i]);
+        m_Spheres[i] = glm::vec4(sphere.center, sphere.radius);
+    }
+
+    m_State.assign(matrices.size(), CULLED);
+    m_Result.visible.clear();
+    m_Result.ranges.clear();
+}
+
+void LodSelector::Resize(size_t count) {
+    m_Spheres.resize(count);
+    m_State.resize(count, CULLED);
+    m_Invalidated = true;
+}
+
+void LodSelector::SetInstance(size_t index, const glm::mat4& matrix, const BoundingSphere& localBounds) {
+    BoundingSphere sphere = TransformSphere(localBounds, matrix);
+    m_Spheres[index] = glm::vec4(sphere.center, sphere.radius);
+    m_State[index] = CULLED;
+    m_Invalidated = true;
+}
+
+bool LodSelector::Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors) {
+    m_Views.clear();
+    addView(view, projection, viewportHeight);
+
+    return select(lodCount, settings, enabled, impostors);
+}
+
+bool LodSelector::Update(const std::vector<CameraView>& views, float viewportHeight, unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors) {
+    m_Views.clear();
+
+    for (const CameraView& view : views) {
+        addView(view.view, view.projection, viewportHeight);
+    }
+
+    return select(lodCount, settings, enabled, impostors);
+}
+
+void LodSelector::addView(const glm::mat4& view, const glm::mat4& projection, float viewportHeight) {
+    glm::mat3 rotation(view);
+
+    ViewState state;
+    state.frustum = Frustum(projection * view);
+    state.eye = -(glm::transpose(rotation) * glm::vec3(view[3]));
+    state.pixelScale = projection[1][1] * viewportHeight;
+
+    m_Views.push_back(state);
+}
+
+bool LodSelector::select(unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors) {
+    // Only as many thresholds as the meshes have levels for, followed by the impostor cut-off when enabled.
+    m_Thresholds.clear();
+    if (enabled) {
+        unsigned int meshThresholds = glm::min(lodCount > 0 ? lodCount - 1 : 0, static_cast<unsigned int>(settings.thresholds.size()));
+        m_Thresholds.assign(settings.thresholds.begin(), settings.thresholds.begin() + meshThresholds);
+    }
+
+    m_Result.meshLevels = static_cast<unsigned int>(m_Thresholds.size()) + 1;
+
+    if (impostors && settings.impostorThreshold > 0.0f) {
+        m_Thresholds.push_back(settings.impostorThreshold);
+    }
+
+    m_Counts.assign(m_Thresholds.size() + 1, 0);
+    bool changed = m_Invalidated || m_Result.ranges.size() != m_Counts.size();
+    m_Invalidated = false;
+
+    for (size_t i = 0; i < m_Spheres.size(); i++) {
+        glm::vec3 center(m_Spheres[i]);
+        float radius = m_Spheres[i].w;
+
+        unsigned char state = CULLED;
+        float size = -1.0f;
+
+        for (const ViewState& view : m_Views) {
+            if (view.frustum.Intersects(center, radius)) {
+                float distance = glm::max(glm::length(center - view.eye), 1e-4f);
+                size = glm::max(size, radius * view.pixelScale / distance);
+            }
+        }
+
+        if (size >= 0.0f) {
+            unsigned int level = selectLevel(size, m_State[i], settings.hysteresis);
+            state = static_cast<unsigned char>(level);
+            m_Counts[level]++;
+        }
+
+        if (state != m_State[i]) {
+            m_State[i] = state;
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return false;
+    }
+
+    m_Result.ranges.assign(m_Counts.size(), InstanceRange());
+
+    unsigned int total = 0;
+    for (size_t level = 0; level < m_Counts.size(); level++) {
+        m_Result.ranges[level].first = total;
+        total += m_Counts[level];
+    }
+
+    m_Result.visible.resize(total);
+
+    for (size_t i = 0; i < m_State.size(); i++) {
+        if (m_State[i] == CULLED) {
+            continue;
+        }
+
+        InstanceRange& range = m_Result.ranges[m_State[i]];
+        m_Result.visible[range.first + range.count++] = static_cast<unsigned int>(i);
+    }
+
+    return true;
+}
+
+const std::vector<unsigned int>& LodSelector::GetVisible() const {
+    return m_Result.visible;
+}
+
+const std::vector<InstanceRange>& LodSelector::GetRanges() const {
+    return m_Result.ranges;
+}
+
+unsigned int LodSelector::GetMeshLevels() const {
+    return m_Result.meshLevels;
+}
+
+const VisibleSet& LodSelector::GetResult() const {
+    return m_Result;
+}
+
+const std::vector<glm::vec4>& LodSelector::GetSpheres() const {
+    return m_Spheres;
+}
+
+unsigned int LodSelector::selectLevel(float size, unsigned char current, float hysteresis) const {
+    const std::vector<float>& thresholds = m_Thresholds;
+    const unsigned int levels = static_cast<unsigned int>(thresholds.size());
+
+    unsigned int target = 0;
+    while (target < levels && size < thresholds[target]) {
+        target++;
+    }
+
+    if (current == CULLED || current > levels) {
+        return target;
+    }
+
+    // Only step across a boundary once the size is clearly past it in the direction of travel.
+    unsigned int level = current;
+
+    while (level < target && size < thresholds[level] * (1.0f - hysteresis)) {
+        level++;
+    }
+
+    while (level > target && size > thresholds[level - 1] * (1.0f + hysteresis)) {
+        level--;
+    }
+
+    return level;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "frustum.hpp"
+
+struct LodSettings {
+    // Simplified levels generated at import on top of the source mesh.
+    unsigned int levels = 3;
+    // Target index count of each level relative to the previous one.
+    float reduction = 0.5f;
+    // Largest simplification error allowed, relative to the mesh extent.
+    float maxError = 0.05f;
+    // Projected diameter in pixels below which an instance drops to the next level.
+    std::vector<float> thresholds = { 96.0f, 32.0f, 8.0f };
+    // Fraction of a threshold an instance has to move past before it switches level, which avoids popping.
+    float hysteresis = 0.15f;
+    // Projected diameter in pixels below which an instance is drawn as an impostor instead of a mesh.
+    float impostorThreshold = 4.0f;
+};
+
+struct InstanceRange {
+    unsigned int first = 0;
+    unsigned int count = 0;
+};
+
+// Culling and LOD output for one frame. Plain data, so it can be copied out and handed to another thread.
+struct VisibleSet {
+    // Instance indices grouped by level; ranges[lod] is the slice belonging to that level.
+    std::vector<unsigned int> visible;
+    std::vector<InstanceRange> ranges;
+    // Number of leading ranges drawn as meshes. A trailing range past these holds the impostor tier.
+    unsigned int meshLevels = 1;
+};
+
+class LodSelector {
+public:
+    void SetInstances(const std::vector<glm::mat4>& matrices, const BoundingSphere& localBounds);
+
+    // Incremental counterparts for a registry that adds, removes or moves instances in place.
+    // A rewritten instance starts without hysteresis, as if it had just come into view.
+    void Resize(size_t count);
+    void SetInstance(size_t index, const glm::mat4& matrix, const BoundingSphere& localBounds);
+
+    // Culls and buckets every instance by screen-space size. Returns true when the visible set or any level
+    // assignment changed, meaning the instance buffer has to be rebuilt from GetVisible().
+    bool Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors);
+
+    // Same for several views at once: an instance is kept if any view sees it and takes the level of the view
+    // it appears largest in, so one visible set serves every view.
+    bool Update(const std::vector<CameraView>& views, float viewportHeight, unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors);
+
+    // Instance indices grouped by level; GetRanges()[lod] is the slice belonging to that level.
+    const std::vector<unsigned int>& GetVisible() const;
+    const std::vector<InstanceRange>& GetRanges() const;
+
+    // Number of leading ranges drawn as meshes. A trailing range past these holds the impostor tier.
+    unsigned int GetMeshLevels() const;
+
+    const VisibleSet& GetResult() const;
+
+    // World-space bounding sphere of every instance, xyz centre and w radius.
+    const std::vector<glm::vec4>& GetSpheres() const;
+
+private:
+    static constexpr unsigned char CULLED = 0xFF;
+
+    struct ViewState {
+        Frustum frustum;
+        glm::vec3 eye;
+        float pixelScale;
+    };
+
+    std::vector<glm::vec4> m_Spheres;
+    std::vector<unsigned char> m_State;
+    VisibleSet m_Result;
+    std::vector<unsigned int> m_Counts;
+    std::vector<float> m_Thresholds;
+    std::vector<ViewState> m_Views;
+    // Set when instances were rewritten, since a moved instance can keep the state of the one it replaced.
+    bool m_Invalidated = false;
+
+    void addView(const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+    bool select(unsigned int lodCount, const LodSettings& settings, bool enabled, bool impostors);
+    unsigned int selectLevel(float size, unsigned char current, float hysteresis) const;
+};
\ No newline at end of file
@@ -10,32 +10,185 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
 
 #include "camera.hpp"
+#include "capture.hpp"
+#include "commands.hpp"
 #include "shader.hpp"
 #include "model.hpp"
+#include "scene.hpp"
+#include "frame.hpp"
+#include "hierarchy.hpp"
+#include "pacing.hpp"
+#include "resolution.hpp"
+#include "multiview.hpp"
+#include "lights.hpp"
+#include "shadows.hpp"
+#include "parallel.hpp"
+#include "memory.hpp"
+#include "replay.hpp"
+#include "shaders.hpp"
 #include "utility.hpp"
 
+// Averages over one step of --light-bench: a light count shaded one way for a few seconds.
+struct LightBenchSample {
+    unsigned int lights = 0;
+    LightingMode mode = LightingMode::Clustered;
+    unsigned int frames = 0;
+    unsigned int gpuSamples = 0;
+    float frameMs = 0.0f;
+    float cullMs = 0.0f;
+    float gpuMs = 0.0f;
+};
+
 void glfw_error(const char* msg);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 GLFWwindow* create_window();
 void process_input(GLFWwindow* window, float deltaTime);
 void process_joystick_input(float deltaTime);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 GLuint load_cubemap(std::vector<std::string> faces);
 GLuint create_cube();
+void print_path_summary(const std::vector<float>& frameMs, const std::vector<float>& gpuMs, const std::vector<float>& scales);
+void print_capture_summary(const CaptureStats& stats);
+void assign_sampler_units(Shader& shader);
+void create_lights(unsigned int count, std::vector<PointLight>& anchors, std::vector<PointLight>& lights);
+void print_light_bench(const std::vector<LightBenchSample>& samples);
+void run_pick_bench(Model& model, ThreadPool& pool);
+void run_threaded(GLFWwindow* window, const PacingSettings& pacing, ShaderManager& shaders, Model& model, Shader& shader, Shader& impostorShader, Shader& skyboxShader, GLuint skybox, GLuint cubemapTexture);
+void build_views(std::vector<CameraView>& views, unsigned int count, float aspect);
+void run_multiview(GLFWwindow* window, const PacingSettings& pacing, ShaderManager& shaders, Model& model, Shader& shader, Shader& skyboxShader, GLuint skybox, GLuint cubemapTexture, unsigned int viewCount);
 
 float windowWidth = 800.0f;
 float windowHeight = 600.0f;
 
+// Far enough to see the whole lattice from outside; distant instances fall through to impostors.
+constexpr float FAR_PLANE = 1000.0f;
+
+// Direction the sun shines in, for the shadowed directional light.
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
 float deltaTime = 0.0f;
 
+bool lineMode = false;
 bool debugDraw = false;
+bool lodEnabled = true;
+bool impostorsEnabled = true;
+bool indirectInstances = true;
+bool sceneSubmit = true;
+bool hierarchyFull = false;
+bool dynamicResolution = false;
+bool multiviewPasses = false;
+LightingMode lightingMode = LightingMode::None;
+bool shadowsEnabled = false;
+bool pickRequested = false;
+
+int main(int argc, char** argv) {
+    const auto startupStart = std::chrono::steady_clock::now();
+
+    bool proceduralLattice = false;
+    bool sceneBench = false;
+    bool registryBench = false;
+    bool hierarchyBench = false;
+    bool threaded = false;
+    bool cameraPathBench = false;
+    unsigned int multiviewCount = 0;
+    unsigned int lightCount = 0;
+    bool lightBench = false;
+    bool shadowMaps = false;
+    bool meshletCulling = true;
+    bool pickBench = false;
+    bool releaseCpuCopies = false;
+    MemoryBudget memoryBudget;
+    std::string modelPath = "./assets/models/cube/scene.gltf";
+    PacingSettings pacing;
+    bool capturing = false;
+    CaptureSettings captureSettings;
+    std::string recordPath;
+    float recordSlowMs = 0.0f;
+    std::string shaderDirectory = "./assets/shaders";
+    bool syncShaders = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--procedural") {
+            proceduralLattice = true;
+        } else if (std::string(argv[i]) == "--scene-bench") {
+            sceneBench = true;
+        } else if (std::string(argv[i]) == "--registry-bench") {
+            registryBench = true;
+        } else if (std::string(argv[i]) == "--hierarchy-bench") {
+            hierarchyBench = true;
+        } else if (std::string(argv[i]) == "--threaded") {
+            threaded = true;
+        } else if (std::string(argv[i]) == "--dynamic-resolution") {
+            dynamicResolution = true;
+        } else if (std::string(argv[i]) == "--camera-path") {
+            cameraPathBench = true;
+        } else if (std::string(argv[i]) == "--shadows") {
+            shadowMaps = true;
+        } else if (std::string(argv[i]) == "--pick-bench") {
+            pickBench = true;
+        } else if (std::string(argv[i]) == "--no-meshlets") {
+            meshletCulling = false;
+        } else if (std::string(argv[i]) == "--release-cpu-copies") {
+            releaseCpuCopies = true;
+        } else if (std::string(argv[i]) == "--gpu-budget" && i + 1 < argc) {
+            memoryBudget.gpuBytes = static_cast<size_t>(std::max(std::atof(argv[++i]), 0.0) * 1024.0 * 1024.0);
+        } else if (std::string(argv[i]) == "--cpu-budget" && i + 1 < argc) {
+            memoryBudget.cpuBytes = static_cast<size_t>(std::max(std::atof(argv[++i]), 0.0) * 1024.0 * 1024.0);
+        } else if (std::string(argv[i]) == "--model" && i + 1 < argc) {
+            modelPath = argv[++i];
+        } else if (std::string(argv[i]) == "--light-bench") {
+            lightBench = true;
+        } else if (std::string(argv[i]) == "--lights" && i + 1 < argc) {
+            lightCount = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+        } else if (std::string(argv[i]) == "--multiview-passes") {
+            multiviewPasses = true;
+        } else if (std::string(argv[i]) == "--multiview" && i + 1 < argc) {
+            multiviewCount = static_cast<unsigned int>(std::clamp(std::atoi(argv[++i]), 1, static_cast<int>(MAX_VIEWS)));
+        } else if (std::string(argv[i]) == "--swap-interval" && i + 1 < argc) {
+            pacing.swapInterval = std::atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--frames-in-flight" && i + 1 < argc) {
+            pacing.maxFramesInFlight = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::string(argv[i]) == "--fps-limit" && i + 1 < argc) {
+            pacing.frameLimit = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::string(argv[i]) == "--capture" && i + 2 < argc) {
+            const std::string format = argv[++i];
+            captureSettings.target = argv[++i];
+            capturing = true;
+
+            if (format == "png") {
+                captureSettings.format = CaptureFormat::Png;
+            } else if (format == "yuv") {
+                captureSettings.format = CaptureFormat::Yuv;
+            } else if (format == "pipe") {
+                captureSettings.format = CaptureFormat::Pipe;
+            } else {
+                std::cerr << "Unknown capture format " << format << " (png, yuv or pipe); not capturing" << std::endl;
+                capturing = false;
+            }
+        } else if (std::string(argv[i]) == "--capture-ring" && i + 1 < argc) {
+            captureSettings.ringSize = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 2));
+        } else if (std::string(argv[i]) == "--record-frame" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::string(argv[i]) == "--record-slow" && i + 1 < argc) {
+            recordSlowMs = static_cast<float>(std::max(std::atof(argv[++i]), 0.0));
+        } else if (std::string(argv[i]) == "--shader-dir" && i + 1 < argc) {
+            shaderDirectory = argv[++i];
+        } else if (std::string(argv[i]) == "--sync-shaders") {
+            syncShaders = true;
+        }
+    }
 
-int main(void) {
     GLFWwindow* window = create_window();
     if (!window) {
         glfwTerminate();
@@ -54,68 +207,738 @@ int main(void) {
     GLuint cubemapTexture = load_cubemap(faces);
     GLuint skybox = create_cube();
 
-    Shader shader("./assets/shaders/model.vert", nullptr, "./assets/shaders/model.frag");
-    Shader skyboxShader("./assets/shaders/skybox.vert", nullptr, "./assets/shaders/skybox.frag");
+    // Every program is issued here and none is waited on, so setup runs while the driver compiles them. With
+    // parallel compile support the first frames draw with flat stand-ins until each one is ready; without it
+    // the first frame waits for them. --sync-shaders compiles them one at a time, as before, for comparison,
+    // and --shader-dir points the loading and the hot reload at another copy of the shaders.
+    auto shaderStart = std::chrono::steady_clock::now();
+    ShaderManager shaders(shaderDirectory, !syncShaders);
+
+    const char* vertexPath = proceduralLattice ? "lattice.vert" : "model.vert";
+
+    Shader& shader = shaders.Load(vertexPath, nullptr, "model.frag", [proceduralLattice](Shader& program) {
+        assign_sampler_units(program);
+
+        if (proceduralLattice) {
+            program.BindUniformBlock("Lattice", LATTICE_UBO_BINDING);
+        }
+    });
+    Shader& skyboxShader = shaders.Load("skybox.vert", nullptr, "skybox.frag");
+    Shader& impostorShader = shaders.Load("impostor.vert", nullptr, "impostor.frag");
+    Shader* depthShader = shadowMaps ? &shaders.Load("shadow_depth.vert", nullptr, "shadow_depth.frag") : nullptr;
+
+    const float shaderIssueMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+    bool shadersReported = false;
+    bool firstFrameReported = false;
+
+    std::cout << (syncShaders ? "Compiled " : "Issued ") << shaders.GetProgramCount() << " shader programs in " << shaderIssueMs << " ms ("
+              << (syncShaders ? "synchronous" : shaders.IsParallel() ? "parallel compile" : "batched, no parallel compile extension") << ")\n";
 
     constexpr unsigned int NUM_ROWS = 100;
     constexpr unsigned int NUM_COLUMNS = 100;
     constexpr unsigned int NUM_SLICES = 100;
 
-    std::vector<glm::mat4> modelMatrices;
-    modelMatrices.reserve(NUM_ROWS * NUM_COLUMNS * NUM_SLICES);
+    // Converts the model's meshes during import and later runs the per-frame parallel loops.
+    ThreadPool pool;
+
+    auto setupStart = std::chrono::steady_clock::now();
+    const unsigned long long setupAllocations = HeapAllocationCount();
+
+    std::unique_ptr<Model> model;
+    size_t instanceBytes = 0;
+
+    LatticeDesc lattice;
+    lattice.spacing = glm::vec3(5.0f, 5.0f, -5.0f);
+    lattice.dims = glm::uvec3(NUM_ROWS, NUM_COLUMNS, NUM_SLICES);
+    lattice.scale = 0.1f;
+
+    if (proceduralLattice) {
+        model = std::make_unique<Model>(modelPath, lattice, false, LodSettings(), &pool);
+    } else {
+        // The registry takes this buffer over, so it is charged to instances from the start.
+        MemoryScope scope(MemoryCategory::Instances);
+
+        std::vector<glm::mat4> modelMatrices = BuildLatticeMatrices(lattice);
+
+        instanceBytes = modelMatrices.size() * sizeof(glm::mat4);
+        model = std::make_unique<Model>(modelPath, std::move(modelMatrices), false, LodSettings(), &pool);
+    }
+
+    float setupMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+    const unsigned long long setupAllocationCount = HeapAllocationCount() - setupAllocations;
+    const size_t setupPeakBytes = PeakResidentBytes();
+
+    // The same 1M instances split over many prototypes, submitted either through one shared Scene buffer
+    // or as separate Model objects. V and B switch between the two.
+    constexpr unsigned int BENCH_PROTOTYPES = 500;
+    constexpr unsigned int BENCH_INSTANCES = 2000;
+
+    Scene scene;
+    std::vector<std::unique_ptr<Model>> separateModels;
+
+    if (sceneBench) {
+        for (unsigned int p = 0; p < BENCH_PROTOTYPES; p++) {
+            std::vector<glm::mat4> matrices;
+            matrices.reserve(BENCH_INSTANCES);
+
+            for (unsigned int i = 0; i < BENCH_INSTANCES; i++) {
+                unsigned int index = p * BENCH_INSTANCES + i;
+                glm::vec3 cell(index / (NUM_COLUMNS * NUM_SLICES), (index / NUM_SLICES) % NUM_COLUMNS, index % NUM_SLICES);
 
-    for (unsigned int x = 0; x < NUM_ROWS; x++) {
-        for (unsigned int y = 0; y < NUM_COLUMNS; y++) {
-            for (unsigned int z = 0; z < NUM_SLICES; z++) {
                 glm::mat4 modelMatrix(1.0f);
-                modelMatrix = glm::translate(modelMatrix, glm::vec3(x * 5.0f, y * 5.0f, z * -5.0f));
+                modelMatrix = glm::translate(modelMatrix, glm::vec3(cell.x * 5.0f, cell.y * 5.0f, cell.z * -5.0f));
                 modelMatrix = glm::scale(modelMatrix, glm::vec3(0.1f));
 
-                modelMatrices.push_back(modelMatrix);
+                matrices.push_back(modelMatrix);
+            }
+
+            PrototypeId prototype = scene.AddPrototype(modelPath);
+            scene.AddInstances(prototype, matrices);
+
+            separateModels.push_back(std::make_unique<Model>(modelPath, std::move(matrices)));
+        }
+
+        scene.Build();
+
+        std::cout << "Scene benchmark: " << scene.GetPrototypeCount() << " prototypes, " << scene.GetInstanceCount() << " instances\n";
+    }
+
+    // Rebuilds the lattice as fleets of rotating rings: one root per row, one ring per column and a cube per
+    // slice, with each cube driving the model instance at the same lattice position.
+    TransformHierarchy hierarchy;
+    std::vector<NodeId> rings;
+
+    if (hierarchyBench && !proceduralLattice) {
+        for (unsigned int x = 0; x < NUM_ROWS; x++) {
+            Transform fleet;
+            fleet.position = glm::vec3(x * 5.0f, 0.0f, 0.0f);
+            NodeId fleetNode = hierarchy.AddNode(NO_PARENT, fleet);
+
+            for (unsigned int y = 0; y < NUM_COLUMNS; y++) {
+                Transform ring;
+                ring.position = glm::vec3(0.0f, y * 5.0f, 0.0f);
+                NodeId ringNode = hierarchy.AddNode(fleetNode, ring);
+                rings.push_back(ringNode);
+
+                for (unsigned int z = 0; z < NUM_SLICES; z++) {
+                    Transform cube;
+                    cube.position = glm::vec3(0.0f, 0.0f, z * -5.0f);
+                    cube.scale = glm::vec3(0.1f);
+
+                    size_t index = (x * NUM_COLUMNS + y) * NUM_SLICES + z;
+                    hierarchy.AddNode(ringNode, cube, model->GetInstances().HandleAt(index));
+                }
+            }
+        }
+
+        hierarchy.Update(pool);
+
+        std::cout << "Hierarchy benchmark: " << hierarchy.GetNodeCount() << " nodes in " << hierarchy.GetLevelCount()
+                  << " levels, " << pool.GetThreadCount() << " threads\n";
+    }
+
+    if (!proceduralLattice) {
+        // Needed finished right away and only once, so it is compiled on the spot rather than managed.
+        Shader bakeShader((shaderDirectory + "/impostor_bake.vert").c_str(), nullptr, (shaderDirectory + "/impostor_bake.frag").c_str());
+        model->BakeImpostors(bakeShader);
+    }
+
+    // Edits and exact picks need the instance matrices on the CPU, so the benchmarks that make them keep them.
+    if (releaseCpuCopies) {
+        const bool keepInstances = registryBench || hierarchyBench || pickBench;
+        const size_t freed = model->ReleaseCpuCopies(keepInstances);
+
+        std::cout << "Released " << freed / (1024.0 * 1024.0) << " MB of CPU copies after upload"
+                  << (!proceduralLattice && !model->GetInstances().IsReleased() ? ", instance matrices kept" : "") << "\n";
+    }
+
+    const MemoryUsage setupMemory = GetMemoryUsage();
+    std::cout << "Memory after setup:\n";
+    PrintMemoryReport(std::cout, setupMemory);
+    bool overMemoryBudget = !WithinMemoryBudget(setupMemory, memoryBudget);
+
+    if (overMemoryBudget) {
+        std::cerr << "Memory over budget after setup" << std::endl;
+    }
+
+    std::cout << NUM_ROWS * NUM_COLUMNS * NUM_SLICES << " models instancated!\n";
+    std::cout << (proceduralLattice ? "Procedural" : "Matrix") << " instance setup took " << setupMs << " ms, "
+              << instanceBytes / (1024.0 * 1024.0) << " MB of per-instance data, "
+              << setupAllocationCount << " heap allocations, peak RSS " << setupPeakBytes / (1024.0 * 1024.0) << " MB\n";
+
+    const ImportStats& importStats = model->importStats;
+    std::cout << "Imported " << importStats.meshes << " meshes in " << importStats.readMs + importStats.buildMs + importStats.uploadMs << " ms: "
+              << importStats.readMs << " ms reading, " << importStats.buildMs << " ms converting on " << importStats.threads << " threads, "
+              << importStats.uploadMs << " ms uploading\n";
+
+    const MaterialStats& materialStats = model->materials.GetStats();
+    std::cout << materialStats.materials << " materials, " << materialStats.textures << " textures packed into "
+              << materialStats.arrays << " texture arrays (" << materialStats.bytes / (1024.0 * 1024.0) << " MB)\n";
+
+    if (multiviewCount > 0) {
+        if (proceduralLattice || sceneBench || registryBench || hierarchyBench || threaded) {
+            std::cerr << "--multiview only drives the single-threaded matrix lattice; running one view" << std::endl;
+        } else {
+            if (capturing) {
+                std::cerr << "--capture records the single-view loop only; running multiview without it" << std::endl;
+            }
+
+            if (!recordPath.empty()) {
+                std::cerr << "--record-frame records the single-view loop only; running multiview without it" << std::endl;
+            }
+
+            run_multiview(window, pacing, shaders, *model, shader, skyboxShader, skybox, cubemapTexture, multiviewCount);
+
+            glfwDestroyWindow(window);
+            glfwTerminate();
+
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (threaded) {
+        if (proceduralLattice || sceneBench || registryBench || hierarchyBench) {
+            std::cerr << "--threaded only drives the matrix lattice; running single-threaded" << std::endl;
+        } else {
+            if (capturing) {
+                std::cerr << "--capture records the single-threaded loop only; running threaded without it" << std::endl;
+            }
+
+            if (!recordPath.empty()) {
+                std::cerr << "--record-frame records the single-threaded loop only; running threaded without it" << std::endl;
             }
+
+            run_threaded(window, pacing, shaders, *model, shader, impostorShader, skyboxShader, skybox, cubemapTexture);
+
+            glfwDestroyWindow(window);
+            glfwTerminate();
+
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (pickBench) {
+        if (proceduralLattice) {
+            std::cerr << "--pick-bench needs the matrix lattice's stored instances; running without" << std::endl;
+        } else {
+            run_pick_bench(*model, pool);
+
+            glfwDestroyWindow(window);
+            glfwTerminate();
+
+            exit(EXIT_SUCCESS);
         }
     }
 
-    Model model("./assets/models/cube/scene.gltf", modelMatrices);
+    FramePacer pacer(pacing);
+    FrameClock clock;
+
+    // --capture records every frame through a ring of pixel buffers that are read a few frames late, which
+    // costs a GPU copy and a memcpy per frame but never a pipeline stall. Comparing --camera-path runs with
+    // and without it measures the difference; the capture summary shows the render thread's part of it.
+    std::unique_ptr<FrameCapture> capture;
+    float captureMsSinceReport = 0.0f;
+
+    if (capturing) {
+        capture = std::make_unique<FrameCapture>(captureSettings);
+
+        if (!capture->IsOpen()) {
+            capture.reset();
+        }
+    }
 
-    float lastFrame = 0.0f;
+    // The scene pass is recorded into this buffer and then submitted in one go, so its CPU cost splits into
+    // building the commands and issuing them. --record-frame saves one recorded pass, with the GL objects it
+    // uses, for the replay tool: the first frame past two seconds, or with --record-slow the first frame whose
+    // CPU time up to submission exceeds that many milliseconds.
+    CommandBuffer frameCommands;
+    float executeMsSinceReport = 0.0f;
+    bool frameRecorded = recordPath.empty();
+
+    // The scene renders offscreen at a scale of the window size and is blitted up to it. R and T switch the
+    // controller that picks the scale from the scene pass's GPU time on and off.
+    RenderTarget sceneTarget;
+    GpuTimer sceneTimer;
+    ResolutionController resolution;
+    float sceneGpuMsSinceReport = 0.0f;
+    unsigned int sceneGpuSamplesSinceReport = 0;
+
+    // Fixed fly-through for comparing runs: the lattice face from outside, into the middle of it, up out of
+    // it towards the sky and across a corner.
+    CameraPath benchmarkPath({
+        { 0.0f, glm::vec3(250.0f, 250.0f, 300.0f), -90.0f, 0.0f },
+        { 8.0f, glm::vec3(250.0f, 250.0f, 20.0f), -90.0f, 0.0f },
+        { 14.0f, glm::vec3(250.0f, 250.0f, -200.0f), -90.0f, -10.0f },
+        { 20.0f, glm::vec3(250.0f, 520.0f, -250.0f), -90.0f, 80.0f },
+        { 26.0f, glm::vec3(-100.0f, 250.0f, 100.0f), -45.0f, 0.0f },
+        { 32.0f, glm::vec3(250.0f, 250.0f, 300.0f), -90.0f, 0.0f }
+    });
+    float pathTime = 0.0f;
+    std::vector<float> pathFrameMs;
+    std::vector<float> pathGpuMs;
+    std::vector<float> pathScales;
+
+    float lastReport = 0.0f;
+    unsigned int framesSinceReport = 0;
+    size_t uploadBytesSinceReport = 0;
+    float uploadMsSinceReport = 0.0f;
+    float submitMsSinceReport = 0.0f;
+    float churnMsSinceReport = 0.0f;
+    float hierarchyMsSinceReport = 0.0f;
+    size_t hierarchyNodesSinceReport = 0;
+    float cpuMsSinceReport = 0.0f;
+    float inputToSubmitMsSinceReport = 0.0f;
+    float submitToGpuMsSinceReport = 0.0f;
+    float fenceWaitMsSinceReport = 0.0f;
+    auto inputTime = std::chrono::steady_clock::now();
+
+    // Removes and re-adds this many random instances every frame to exercise the registry's dirty-range uploads.
+    constexpr unsigned int CHURN_PER_FRAME = 10000;
+    std::mt19937 churnRng(1234);
+
+    // Point lights drifting around fixed anchors spread through the lattice. C shades them with clustered
+    // culling and X with a brute-force loop over every light.
+    LightClusters clusters;
+    std::vector<PointLight> lightAnchors;
+    std::vector<PointLight> lights;
+
+    if (lightCount > 0) {
+        create_lights(lightCount, lightAnchors, lights);
+        lightingMode = LightingMode::Clustered;
+    }
 
-    std::cout << modelMatrices.size() << " models instancated!\n";
+    // --light-bench steps through these counts, shading each with clustered culling and then brute force, and
+    // prints a table at the end. The first half second of every step is left out as warm-up.
+    const std::vector<unsigned int> lightBenchCounts = { 100, 300, 1000, 3000, 10000 };
+    constexpr float LIGHT_BENCH_SECONDS = 3.0f;
+    constexpr float LIGHT_BENCH_WARMUP = 0.5f;
+    std::vector<LightBenchSample> lightBenchSamples;
+    LightBenchSample lightBenchSample;
+    float lightBenchStart = -1.0f;
+
+    // Cascaded shadows from the sun, cast by the matrix lattice. P and Z switch them on and off.
+    std::unique_ptr<CascadedShadows> shadows;
+
+    if (shadowMaps) {
+        if (proceduralLattice || sceneBench) {
+            std::cerr << "--shadows needs the matrix lattice's resident transforms; running without" << std::endl;
+        } else {
+            shadows = std::make_unique<CascadedShadows>();
+            shadowsEnabled = true;
+        }
+    }
 
     while (!glfwWindowShouldClose(window)) {
+        pacer.BeginFrame();
+
+        auto frameStart = std::chrono::steady_clock::now();
+
+        shaders.Update();
+
+        if (!shadersReported && shaders.IsReady()) {
+            std::cout << "All shader programs ready " << std::chrono::duration<float, std::milli>(frameStart - startupStart).count() << " ms after startup\n";
+            shadersReported = true;
+        }
+
         float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        deltaTime = clock.Tick();
 
         process_input(window, deltaTime);
         process_joystick_input(deltaTime);
 
+        if (lightBench && (lightBenchStart < 0.0f || currentFrame - lightBenchStart >= LIGHT_BENCH_SECONDS)) {
+            if (lightBenchStart >= 0.0f) {
+                lightBenchSamples.push_back(lightBenchSample);
+            }
+
+            const size_t step = lightBenchSamples.size();
+
+            if (step == lightBenchCounts.size() * 2) {
+                print_light_bench(lightBenchSamples);
+                glfwSetWindowShouldClose(window, true);
+                lightBench = false;
+            } else {
+                create_lights(lightBenchCounts[step / 2], lightAnchors, lights);
+
+                lightBenchSample = LightBenchSample();
+                lightBenchSample.lights = lightBenchCounts[step / 2];
+                lightBenchSample.mode = step % 2 == 0 ? LightingMode::Clustered : LightingMode::BruteForce;
+                lightingMode = lightBenchSample.mode;
+                lightBenchStart = currentFrame;
+            }
+        }
+
+        if (cameraPathBench) {
+            pathTime += clock.GetRawDelta();
+
+            if (pathTime > benchmarkPath.GetDuration()) {
+                print_path_summary(pathFrameMs, pathGpuMs, pathScales);
+                glfwSetWindowShouldClose(window, true);
+            }
+
+            benchmarkPath.Apply(pathTime, camera);
+        }
+
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.GetZoom()), windowWidth / windowHeight, 0.1f, 100.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.GetZoom()), windowWidth / windowHeight, 0.1f, FAR_PLANE);
+
+        if (registryBench && !proceduralLattice) {
+            auto churnStart = std::chrono::steady_clock::now();
+
+            for (unsigned int i = 0; i < CHURN_PER_FRAME; i++) {
+                std::uniform_int_distribution<size_t> pick(0, model->GetInstances().GetCount() - 1);
+                model->RemoveInstance(model->GetInstances().HandleAt(pick(churnRng)));
+            }
+
+            std::uniform_int_distribution<unsigned int> cell(0, NUM_ROWS - 1);
+            for (unsigned int i = 0; i < CHURN_PER_FRAME; i++) {
+                glm::mat4 modelMatrix(1.0f);
+                modelMatrix = glm::translate(modelMatrix, glm::vec3(cell(churnRng) * 5.0f, cell(churnRng) * 5.0f, cell(churnRng) * -5.0f));
+                modelMatrix = glm::scale(modelMatrix, glm::vec3(0.1f));
+
+                model->AddInstance(modelMatrix);
+            }
+
+            churnMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - churnStart).count();
+        }
+
+        if (hierarchyBench && !proceduralLattice) {
+            // Spinning 1% of the rings dirties 1% of the cubes.
+            std::uniform_int_distribution<size_t> pick(0, rings.size() - 1);
+            for (size_t i = 0; i < rings.size() / 100; i++) {
+                NodeId ring = rings[pick(churnRng)];
+
+                Transform local = hierarchy.GetLocal(ring);
+                local.rotation = glm::normalize(local.rotation * glm::angleAxis(deltaTime, glm::vec3(0.0f, 0.0f, 1.0f)));
+                hierarchy.SetLocal(ring, local);
+            }
+
+            auto hierarchyStart = std::chrono::steady_clock::now();
+            hierarchyNodesSinceReport += hierarchy.Update(pool, hierarchyFull);
+            hierarchyMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - hierarchyStart).count();
+
+            hierarchy.WriteInstances(*model);
+        }
+
+        const int screenWidth = static_cast<int>(windowWidth);
+        const int screenHeight = static_cast<int>(windowHeight);
+        const float scale = dynamicResolution ? resolution.GetScale() : 1.0f;
+        const int renderWidth = std::max(static_cast<int>(screenWidth * scale), 1);
+        const int renderHeight = std::max(static_cast<int>(screenHeight * scale), 1);
+
+        model->lodEnabled = lodEnabled;
+        model->impostorsEnabled = impostorsEnabled;
+        model->indirectInstances = indirectInstances;
+        model->meshletCulling = meshletCulling;
+        model->Update(view, projection, static_cast<float>(renderHeight));
+
+        // The cursor is captured for mouse look, so a click picks whatever is under the centre of the view.
+        if (pickRequested) {
+            pickRequested = false;
+
+            auto pickStart = std::chrono::steady_clock::now();
+            RayHit hit;
+            bool picked = model->RaycastInstances(camera.GetPosition(), camera.GetFront(), hit, FAR_PLANE);
+            float pickMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pickStart).count();
+
+            if (picked) {
+                std::cout << "Picked instance " << hit.instance.slot << " at (" << hit.point.x << ", " << hit.point.y << ", " << hit.point.z
+                          << "), " << hit.distance << " away, in " << pickMs << " ms" << std::endl;
+            } else {
+                std::cout << "Nothing under the cursor (" << pickMs << " ms)" << std::endl;
+            }
+        }
+
+        const bool lit = !lights.empty() && lightingMode != LightingMode::None;
 
-        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        if (lit) {
+            for (size_t i = 0; i < lights.size(); i++) {
+                float phase = currentFrame + static_cast<float>(i) * 0.618f;
+                lights[i].position = lightAnchors[i].position + glm::vec3(std::cos(phase), 0.5f * std::sin(0.7f * phase), std::sin(phase)) * 4.0f;
+            }
+
+            if (lightingMode == LightingMode::Clustered) {
+                clusters.Build(lights, view, projection, 0.1f, FAR_PLANE, pool);
+            }
+
+            clusters.Upload(lights, lightingMode == LightingMode::Clustered);
+        }
+
+        const bool shadowed = shadows && shadowsEnabled;
+
+        if (shadowed) {
+            shadows->Render(*model, *depthShader, view, glm::radians(camera.GetZoom()), windowWidth / windowHeight, 0.1f, SUN_DIRECTION, pool);
+        }
+
+        sceneTarget.Resize(std::max(static_cast<int>(screenWidth * resolution.GetSettings().maxScale), 1), std::max(static_cast<int>(screenHeight * resolution.GetSettings().maxScale), 1));
+
+        frameCommands.Reset();
+        sceneTarget.Bind(frameCommands, renderWidth, renderHeight);
+
+        frameCommands.PolygonMode(lineMode ? GL_LINE : GL_FILL);
+        frameCommands.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        frameCommands.UseProgram(shader);
+        frameCommands.SetUniform(shader, "projection", projection);
+        frameCommands.SetUniform(shader, "view", view);
+        clusters.Bind(shader, frameCommands, lit ? lightingMode : LightingMode::None, static_cast<float>(renderWidth), static_cast<float>(renderHeight));
 
-        shader.Use();
-        shader.Set("projection", projection);
-        shader.Set("view", view);
+        if (shadows) {
+            shadows->Bind(shader, frameCommands, shadowed);
+        }
+
+        if (sceneBench) {
+            auto submitStart = std::chrono::steady_clock::now();
+            unsigned int drawCalls = 0;
+
+            if (sceneSubmit) {
+                scene.Draw(shader, frameCommands);
+                drawCalls = scene.stats.drawCalls;
+            } else {
+                for (std::unique_ptr<Model>& separate : separateModels) {
+                    separate->Draw(shader, frameCommands);
+                    drawCalls += separate->stats.drawCalls;
+                }
+            }
+
+            submitMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+            framesSinceReport++;
+
+            if (currentFrame - lastReport >= 1.0f) {
+                std::cout << "[" << (sceneSubmit ? "Scene" : "Separate models") << "] "
+                          << 1000.0f * (currentFrame - lastReport) / framesSinceReport << " ms/frame, "
+                          << submitMsSinceReport / framesSinceReport << " ms CPU submit, "
+                          << drawCalls << " draw calls\n";
+
+                lastReport = currentFrame;
+                framesSinceReport = 0;
+                submitMsSinceReport = 0.0f;
+            }
+        } else {
+            model->Draw(shader, frameCommands);
+
+            frameCommands.UseProgram(impostorShader);
+            frameCommands.SetUniform(impostorShader, "projection", projection);
+            frameCommands.SetUniform(impostorShader, "view", view);
+            frameCommands.SetUniform(impostorShader, "viewPos", camera.GetPosition());
+            frameCommands.SetUniform(impostorShader, "viewportHeight", static_cast<float>(renderHeight));
 
-        model.Draw(shader);
+            model->DrawImpostors(impostorShader, frameCommands);
 
-        GL_CHECK(glDepthFunc(GL_LEQUAL));
+            framesSinceReport++;
+            uploadBytesSinceReport += model->stats.uploadBytes;
+            uploadMsSinceReport += model->stats.uploadMs;
+        }
 
-        skyboxShader.Use();
-        skyboxShader.Set("projection", projection);
-        skyboxShader.Set("view", glm::mat4(glm::mat3(camera.GetViewMatrix())));
+        if (!sceneBench && currentFrame - lastReport >= 1.0f) {
+            std::cout << "[LOD " << (lodEnabled ? "on" : "off") << ", impostors " << (impostorsEnabled ? "on" : "off") << "] "
+                      << 1000.0f * (currentFrame - lastReport) / framesSinceReport << " ms/frame, "
+                      << model->stats.instances << " visible instances ("
+                      << model->stats.impostors << " impostors), "
+                      << model->stats.drawCalls << " draw calls, "
+                      << model->stats.vertices << " vertices, "
+                      << model->stats.triangles << " triangles submitted ("
+                      << model->stats.fullDetailTriangles << " without LOD), "
+                      << (indirectInstances ? "indirect" : "attribute") << " instance upload "
+                      << uploadBytesSinceReport / framesSinceReport << " bytes/frame in "
+                      << uploadMsSinceReport / framesSinceReport << " ms/frame, "
+                      << cpuMsSinceReport / framesSinceReport << " ms CPU, "
+                      << inputToSubmitMsSinceReport / framesSinceReport << " ms input-to-submit, "
+                      << submitToGpuMsSinceReport / framesSinceReport << " ms submit-to-GPU, "
+                      << fenceWaitMsSinceReport / framesSinceReport << " ms fence wait, "
+                      << executeMsSinceReport / framesSinceReport << " ms executing "
+                      << frameCommands.GetCommandCount() << " commands ("
+                      << frameCommands.GetSize() / 1024 << " KB), "
+                      << "resolution scale " << scale << (dynamicResolution ? " (dynamic)" : " (fixed)") << ", "
+                      << sceneGpuMsSinceReport / std::max(sceneGpuSamplesSinceReport, 1u) << " ms GPU scene pass";
+
+            if (registryBench) {
+                std::cout << ", " << CHURN_PER_FRAME << " removes + adds in " << churnMsSinceReport / framesSinceReport << " ms/frame";
+            }
 
-        GL_CHECK(glBindVertexArray(skybox));
-        GL_CHECK(glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture));
-        GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 36));
-        GL_CHECK(glBindVertexArray(0));
+            if (model->stats.meshlets + model->stats.meshletsCulled > 0) {
+                std::cout << ", " << model->stats.meshlets << " of " << model->stats.meshlets + model->stats.meshletsCulled
+                          << " clusters drawn, culled in " << model->stats.meshletCullMs << " ms";
+            }
 
-        GL_CHECK(glDepthFunc(GL_LESS));
+            if (model->stats.unbatchedTextureBinds > 0) {
+                std::cout << ", " << model->stats.textureBinds << " texture binds ("
+                          << model->stats.unbatchedTextureBinds << " binding per mesh), "
+                          << model->stats.materialSwitches << " material switches";
+            }
+
+            if (lit) {
+                std::cout << ", " << lights.size() << " lights "
+                          << (lightingMode == LightingMode::Clustered ? "clustered" : "brute force");
+
+                if (lightingMode == LightingMode::Clustered) {
+                    std::cout << " (" << clusters.GetStats().cullMs << " ms culling, "
+                              << clusters.GetStats().indices << " indices, "
+                              << clusters.GetStats().maxPerCluster << " max per cluster)";
+                }
+            }
+
+            if (shadowed) {
+                std::cout << ", shadow cascades";
+
+                for (unsigned int c = 0; c < shadows->GetCascadeCount(); c++) {
+                    const CascadeStats& cascade = shadows->GetStats(c);
+
+                    std::cout << " [" << c << ": " << cascade.casters << " casters, "
+                              << (cascade.rendered ? "drawn, " : "cached, ")
+                              << cascade.cullMs << " ms cull, "
+                              << cascade.gpuMs << " ms GPU]";
+                }
+            }
+
+            if (hierarchyBench) {
+                std::cout << ", " << (hierarchyFull ? "full" : "incremental") << " hierarchy update of "
+                          << hierarchyNodesSinceReport / framesSinceReport << " nodes in "
+                          << hierarchyMsSinceReport / framesSinceReport << " ms/frame";
+            }
+
+            const MemoryUsage memory = GetMemoryUsage();
+
+            std::cout << ", " << memory.GpuTotal() / (1024.0 * 1024.0) << " MB GPU, "
+                      << memory.CpuTotal() / (1024.0 * 1024.0) << " MB CPU tracked";
+
+            if (capture) {
+                const CaptureStats captureStats = capture->GetStats();
+
+                std::cout << ", capture " << captureMsSinceReport / framesSinceReport << " ms/frame ("
+                          << captureStats.written << " written, " << captureStats.dropped << " dropped)";
+            }
+
+            std::cout << "\n";
+
+            // Warns once on crossing the budget, with the breakdown, and again only after dropping back under it.
+            if (WithinMemoryBudget(memory, memoryBudget)) {
+                overMemoryBudget = false;
+            } else if (!overMemoryBudget) {
+                std::cerr << "Memory over budget (" << memoryBudget.gpuBytes / (1024.0 * 1024.0) << " MB GPU, "
+                          << memoryBudget.cpuBytes / (1024.0 * 1024.0) << " MB CPU; 0 is unlimited):" << std::endl;
+                PrintMemoryReport(std::cerr, memory);
+                overMemoryBudget = true;
+            }
+
+            lastReport = currentFrame;
+            framesSinceReport = 0;
+            uploadBytesSinceReport = 0;
+            uploadMsSinceReport = 0.0f;
+            churnMsSinceReport = 0.0f;
+            hierarchyMsSinceReport = 0.0f;
+            hierarchyNodesSinceReport = 0;
+            cpuMsSinceReport = 0.0f;
+            inputToSubmitMsSinceReport = 0.0f;
+            submitToGpuMsSinceReport = 0.0f;
+            fenceWaitMsSinceReport = 0.0f;
+            sceneGpuMsSinceReport = 0.0f;
+            sceneGpuSamplesSinceReport = 0;
+            captureMsSinceReport = 0.0f;
+            executeMsSinceReport = 0.0f;
+        }
+
+        frameCommands.DepthFunc(GL_LEQUAL);
+
+        frameCommands.UseProgram(skyboxShader);
+        frameCommands.SetUniform(skyboxShader, "projection", projection);
+        frameCommands.SetUniform(skyboxShader, "view", glm::mat4(glm::mat3(camera.GetViewMatrix())));
+
+        frameCommands.BindVertexArray(skybox);
+        frameCommands.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        frameCommands.DrawArrays(GL_TRIANGLES, 0, 36);
+        frameCommands.BindVertexArray(0);
+
+        frameCommands.DepthFunc(GL_LESS);
+
+        // Saved before submission, so the snapshot holds the state the pass starts from.
+        if (!frameRecorded) {
+            const float recordedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+            if (recordSlowMs > 0.0f ? recordedMs > recordSlowMs : currentFrame >= 2.0f) {
+                if (SaveFrame(recordPath, frameCommands, renderWidth, renderHeight)) {
+                    std::cout << "Recorded frame to " << recordPath << " (" << frameCommands.GetCommandCount() << " commands, "
+                              << recordedMs << " ms CPU before submission)" << std::endl;
+                }
+
+                frameRecorded = true;
+            }
+        }
+
+        auto executeStart = std::chrono::steady_clock::now();
+
+        sceneTimer.Begin();
+        frameCommands.Execute();
+        sceneTimer.End();
+
+        const float executeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - executeStart).count();
+        executeMsSinceReport += executeMs;
+
+        if (sceneBench) {
+            submitMsSinceReport += executeMs;
+        }
+
+        sceneTarget.BlitToScreen(renderWidth, renderHeight, screenWidth, screenHeight);
+
+        if (capture) {
+            capture->Capture(screenWidth, screenHeight);
+            captureMsSinceReport += capture->GetStats().captureMs;
+        }
+
+        float sceneGpuMs = 0.0f;
+        while (sceneTimer.Poll(sceneGpuMs)) {
+            if (dynamicResolution) {
+                resolution.Update(sceneGpuMs);
+            }
+
+            sceneGpuMsSinceReport += sceneGpuMs;
+            sceneGpuSamplesSinceReport++;
+
+            if (lightBench && currentFrame - lightBenchStart >= LIGHT_BENCH_WARMUP) {
+                lightBenchSample.gpuMs += sceneGpuMs;
+                lightBenchSample.gpuSamples++;
+            }
+
+            if (cameraPathBench) {
+                pathGpuMs.push_back(sceneGpuMs);
+            }
+        }
+
+        if (lightBench && currentFrame - lightBenchStart >= LIGHT_BENCH_WARMUP) {
+            lightBenchSample.frameMs += clock.GetRawDelta() * 1000.0f;
+            lightBenchSample.cullMs += lightingMode == LightingMode::Clustered ? clusters.GetStats().cullMs : 0.0f;
+            lightBenchSample.frames++;
+        }
+
+        if (cameraPathBench) {
+            pathFrameMs.push_back(clock.GetRawDelta() * 1000.0f);
+            pathScales.push_back(scale);
+        }
+
+        cpuMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
 
         glfwSwapBuffers(window);
+        pacer.EndFrame(inputTime);
+
+        if (!firstFrameReported) {
+            std::cout << "First frame presented " << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupStart).count()
+                      << " ms after startup, " << shaders.GetPendingCount() << " shader programs still compiling\n";
+            firstFrameReported = true;
+        }
+
+        inputToSubmitMsSinceReport += pacer.GetStats().inputToSubmitMs;
+        submitToGpuMsSinceReport += pacer.GetStats().submitToGpuMs;
+        fenceWaitMsSinceReport += pacer.GetStats().fenceWaitMs;
+
         glfwPollEvents();
+        inputTime = std::chrono::steady_clock::now();
+    }
+
+    // The capture's buffers and fences have to go before the context does.
+    if (capture) {
+        capture->Finish();
+        print_capture_summary(capture->GetStats());
+        capture.reset();
     }
 
     glfwDestroyWindow(window);
@@ -133,7 +956,6 @@ void glfw_error(const char* msg) {
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     windowWidth = static_cast<float>(width);
     windowHeight = static_cast<float>(height);
-    GL_CHECK(glViewport(0, 0, width, height));
 }
 
 GLFWwindow* create_window() {
@@ -177,6 +999,7 @@ GLFWwindow* create_window() {
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetScrollCallback(window, scroll_callback);
 
     if (glfwJoystickPresent(GLFW_JOYSTICK_1) && glfwJoystickIsGamepad(GLFW_JOYSTICK_1)) {
@@ -187,8 +1010,6 @@ GLFWwindow* create_window() {
 }
 
 void process_input(GLFWwindow* window, float deltaTime) {
-    static bool lineMode = false;
-
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
@@ -216,11 +1037,59 @@ void process_input(GLFWwindow* window, float deltaTime) {
     if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
         debugDraw = false;
 
-    if (lineMode) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    }
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
+        lodEnabled = true;
+
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+        lodEnabled = false;
+
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS)
+        impostorsEnabled = true;
+
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
+        impostorsEnabled = false;
+
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS)
+        indirectInstances = true;
+
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+        indirectInstances = false;
+
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS)
+        sceneSubmit = true;
+
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS)
+        sceneSubmit = false;
+
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
+        hierarchyFull = false;
+
+    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+        hierarchyFull = true;
+
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+        dynamicResolution = true;
+
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+        dynamicResolution = false;
+
+    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS)
+        multiviewPasses = false;
+
+    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS)
+        multiviewPasses = true;
+
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+        lightingMode = LightingMode::Clustered;
+
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
+        lightingMode = LightingMode::BruteForce;
+
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+        shadowsEnabled = true;
+
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
+        shadowsEnabled = false;
 }
 
 void process_joystick_input(float deltaTime) {
@@ -278,6 +1147,12 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
     camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
+void mouse_button_callback(GLFWwindow*, int button, int action, int) {
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        pickRequested = true;
+    }
+}
+
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
@@ -288,11 +1163,14 @@ GLuint load_cubemap(std::vector<std::string> faces) {
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    size_t bytes = 0;
     for (unsigned int i = 0; i < faces.size(); i++) {
         unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
 
         if (data) {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            // Drivers pad RGB8 out to four bytes a texel.
+            bytes += static_cast<size_t>(width) * height * 4;
         } else {
             std::cerr << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
         }
@@ -308,6 +1186,8 @@ GLuint load_cubemap(std::vector<std::string> faces) {
 
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
+    TrackGpuMemory(GpuResource::Texture, textureID, MemoryCategory::Textures, bytes);
+
     return textureID;
 }
 
@@ -364,6 +1244,7 @@ GLuint create_cube() {
     GL_CHECK(glGenBuffers(1, &VBO));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
     GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, VBO, MemoryCategory::Geometry, sizeof(vertices));
 
     GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void*>(0)));
     GL_CHECK(glEnableVertexAttribArray(0));
@@ -372,4 +1253,640 @@ GLuint create_cube() {
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
     return VAO;
+}
+
+// Mean and variance of the frame and GPU times over a camera path run, so runs with and without the
+// resolution controller can be compared on smoothness as well as speed.
+void print_path_summary(const std::vector<float>& frameMs, const std::vector<float>& gpuMs, const std::vector<float>& scales) {
+    auto meanAndVariance = [](const std::vector<float>& samples, float& mean, float& variance) {
+        mean = 0.0f;
+        variance = 0.0f;
+
+        if (samples.empty()) {
+            return;
+        }
+
+        for (float sample : samples) {
+            mean += sample;
+        }
+
+        mean /= static_cast<float>(samples.size());
+
+        for (float sample : samples) {
+            variance += (sample - mean) * (sample - mean);
+        }
+
+        variance /= static_cast<float>(samples.size());
+    };
+
+    float frameMean, frameVariance, gpuMean, gpuVariance, scaleMean, scaleVariance;
+    meanAndVariance(frameMs, frameMean, frameVariance);
+    meanAndVariance(gpuMs, gpuMean, gpuVariance);
+    meanAndVariance(scales, scaleMean, scaleVariance);
+
+    float minScale = scales.empty() ? 0.0f : *std::min_element(scales.begin(), scales.end());
+    float maxScale = scales.empty() ? 0.0f : *std::max_element(scales.begin(), scales.end());
+
+    std::cout << "Camera path (" << (dynamicResolution ? "dynamic resolution" : "fixed resolution") << "): "
+              << frameMs.size() << " frames, "
+              << frameMean << " ms/frame (variance " << frameVariance << "), "
+              << gpuMean << " ms GPU scene pass (variance " << gpuVariance << "), "
+              << "scale " << scaleMean << " mean, " << minScale << " min, " << maxScale << " max" << std::endl;
+}
+
+void print_capture_summary(const CaptureStats& stats) {
+    const float frames = static_cast<float>(std::max(stats.captured, 1ull));
+
+    std::cout << "Capture: " << stats.captured << " frames read back, "
+              << stats.written << " written, " << stats.dropped << " dropped; "
+              << stats.totalCaptureMs / frames << " ms/frame on the render thread ("
+              << stats.totalFenceWaitMs / frames << " ms waiting on fences), "
+              << stats.totalWriteMs / frames << " ms/frame on the writer thread" << std::endl;
+}
+
+// Samplers of different types may not share a texture unit, even ones a branch leaves unused, so every
+// buffer texture and the shadow map model.frag declares gets its own unit up front, not only once bound.
+void assign_sampler_units(Shader& shader) {
+    shader.Use();
+    shader.Set("transforms", static_cast<int>(TRANSFORM_TEXTURE_UNIT));
+    shader.Set("lightData", static_cast<int>(LIGHT_DATA_TEXTURE_UNIT));
+    shader.Set("lightGrid", static_cast<int>(LIGHT_GRID_TEXTURE_UNIT));
+    shader.Set("lightIndices", static_cast<int>(LIGHT_INDEX_TEXTURE_UNIT));
+    shader.Set("shadowMap", static_cast<int>(SHADOW_MAP_TEXTURE_UNIT));
+
+    for (unsigned int i = 0; i < MAX_MATERIAL_ARRAYS; i++) {
+        shader.Set("materialArrays[" + std::to_string(i) + "]", static_cast<int>(MATERIAL_TEXTURE_UNIT + i));
+    }
+}
+
+// Scatters lights through the lattice with random colours and reaches. The anchors are where each one drifts
+// around; lights is the animated copy that gets culled and uploaded.
+void create_lights(unsigned int count, std::vector<PointLight>& anchors, std::vector<PointLight>& lights) {
+    MemoryScope scope(MemoryCategory::Lighting);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 495.0f);
+    std::uniform_real_distribution<float> radius(10.0f, 25.0f);
+    std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+    anchors.resize(count);
+
+    for (PointLight& light : anchors) {
+        light.position = glm::vec3(position(rng), position(rng), -position(rng));
+        light.radius = radius(rng);
+        light.color = glm::vec3(channel(rng), channel(rng), channel(rng));
+        light.intensity = 1.0f;
+    }
+
+    lights = anchors;
+}
+
+void print_light_bench(const std::vector<LightBenchSample>& samples) {
+    std::cout << "Light benchmark (ms/frame, ms CPU culling, ms GPU scene pass):\n";
+
+    for (const LightBenchSample& sample : samples) {
+        float frames = static_cast<float>(std::max(sample.frames, 1u));
+
+        std::cout << "  " << sample.lights << " lights "
+                  << (sample.mode == LightingMode::Clustered ? "clustered:   " : "brute force: ")
+                  << sample.frameMs / frames << ", "
+                  << sample.cullMs / frames << ", "
+                  << sample.gpuMs / static_cast<float>(std::max(sample.gpuSamples, 1u)) << "\n";
+    }
+}
+
+// Input, camera and culling stay on the main thread, where GLFW requires events to be handled. A render
+// thread takes over the GL context and draws the packets handed to it through a two-slot queue, so a slow
+// frame on either side overlaps with the other instead of adding to it.
+void run_threaded(GLFWwindow* window, const PacingSettings& pacing, ShaderManager& shaders, Model& model, Shader& shader, Shader& impostorShader, Shader& skyboxShader, GLuint skybox, GLuint cubemapTexture) {
+    FrameQueue queue;
+
+    glfwMakeContextCurrent(nullptr);
+
+    std::thread renderThread([&] {
+        glfwMakeContextCurrent(window);
+
+        // GL objects owned by the pacer have to go before the context is released.
+        {
+            FramePacer pacer(pacing);
+
+            // The render thread's copy of the draw list, replaced whenever a packet carries a new one.
+            VisibleSet visible;
+            CommandBuffer commands;
+
+            auto lastReport = std::chrono::steady_clock::now();
+            unsigned int framesSinceReport = 0;
+            float simulationMsSinceReport = 0.0f;
+            float renderMsSinceReport = 0.0f;
+            float inputToSubmitMsSinceReport = 0.0f;
+            float submitToGpuMsSinceReport = 0.0f;
+            size_t uploadBytesSinceReport = 0;
+
+            while (true) {
+                pacer.BeginFrame();
+
+                FramePacket& packet = queue.AcquireRead();
+
+                if (packet.quit) {
+                    queue.Release();
+                    break;
+                }
+
+                auto renderStart = std::chrono::steady_clock::now();
+
+                // Shader rebuilds are GL work, so they are picked up here rather than on the main thread.
+                shaders.Update();
+
+                const bool changed = packet.visibleChanged;
+                if (changed) {
+                    std::swap(visible, packet.visible);
+                }
+
+                const glm::mat4 view = packet.view;
+                const glm::mat4 projection = packet.projection;
+                const glm::vec3 viewPos = packet.viewPos;
+                const int viewportWidth = packet.viewportWidth;
+                const int viewportHeight = packet.viewportHeight;
+                const bool wireframe = packet.lineMode;
+                const auto inputTime = packet.inputTime;
+                simulationMsSinceReport += packet.simulationMs;
+                model.indirectInstances = packet.indirectInstances;
+
+                // Hand the slot back before drawing so the next packet can be built while this one renders.
+                queue.Release();
+
+                commands.Reset();
+                commands.Viewport(0, 0, viewportWidth, viewportHeight);
+                commands.PolygonMode(wireframe ? GL_LINE : GL_FILL);
+                commands.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                commands.UseProgram(shader);
+                commands.SetUniform(shader, "projection", projection);
+                commands.SetUniform(shader, "view", view);
+
+                model.Draw(shader, commands, visible, changed);
+
+                commands.UseProgram(impostorShader);
+                commands.SetUniform(impostorShader, "projection", projection);
+                commands.SetUniform(impostorShader, "view", view);
+                commands.SetUniform(impostorShader, "viewPos", viewPos);
+                commands.SetUniform(impostorShader, "viewportHeight", static_cast<float>(viewportHeight));
+
+                model.DrawImpostors(impostorShader, commands, visible);
+
+                commands.DepthFunc(GL_LEQUAL);
+
+                commands.UseProgram(skyboxShader);
+                commands.SetUniform(skyboxShader, "projection", projection);
+                commands.SetUniform(skyboxShader, "view", glm::mat4(glm::mat3(view)));
+
+                commands.BindVertexArray(skybox);
+                commands.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                commands.DrawArrays(GL_TRIANGLES, 0, 36);
+                commands.BindVertexArray(0);
+
+                commands.DepthFunc(GL_LESS);
+                commands.Execute();
+
+                renderMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+
+                glfwSwapBuffers(window);
+                pacer.EndFrame(inputTime);
+
+                auto presented = std::chrono::steady_clock::now();
+                inputToSubmitMsSinceReport += pacer.GetStats().inputToSubmitMs;
+                submitToGpuMsSinceReport += pacer.GetStats().submitToGpuMs;
+                uploadBytesSinceReport += model.stats.uploadBytes;
+                framesSinceReport++;
+
+                float sinceReport = std::chrono::duration<float>(presented - lastReport).count();
+                if (sinceReport >= 1.0f) {
+                    std::cout << "[Threaded] " << 1000.0f * sinceReport / framesSinceReport << " ms/frame, "
+                              << model.stats.instances << " visible instances ("
+                              << model.stats.impostors << " impostors), "
+                              << model.stats.drawCalls << " draw calls, "
+                              << uploadBytesSinceReport / framesSinceReport << " bytes/frame uploaded, "
+                              << simulationMsSinceReport / framesSinceReport << " ms CPU simulation, "
+                              << renderMsSinceReport / framesSinceReport << " ms CPU render, "
+                              << inputToSubmitMsSinceReport / framesSinceReport << " ms input-to-submit, "
+                              << submitToGpuMsSinceReport / framesSinceReport << " ms submit-to-GPU\n";
+
+                    lastReport = presented;
+                    framesSinceReport = 0;
+                    simulationMsSinceReport = 0.0f;
+                    renderMsSinceReport = 0.0f;
+                    inputToSubmitMsSinceReport = 0.0f;
+                    submitToGpuMsSinceReport = 0.0f;
+                    uploadBytesSinceReport = 0;
+                }
+            }
+        }
+
+        glfwMakeContextCurrent(nullptr);
+    });
+
+    FrameClock clock;
+    unsigned long long frame = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        // Waiting for a free slot before sampling input keeps the input as fresh as possible when drawn.
+        FramePacket& packet = queue.AcquireWrite();
+
+        glfwPollEvents();
+        auto inputTime = std::chrono::steady_clock::now();
+
+        deltaTime = clock.Tick();
+
+        process_input(window, deltaTime);
+        process_joystick_input(deltaTime);
+
+        packet.frame = frame++;
+        packet.inputTime = inputTime;
+        packet.view = camera.GetViewMatrix();
+        packet.projection = glm::perspective(glm::radians(camera.GetZoom()), windowWidth / windowHeight, 0.1f, FAR_PLANE);
+        packet.viewPos = camera.GetPosition();
+        packet.viewportWidth = static_cast<int>(windowWidth);
+        packet.viewportHeight = static_cast<int>(windowHeight);
+        packet.lineMode = lineMode;
+        packet.indirectInstances = indirectInstances;
+
+        model.lodEnabled = lodEnabled;
+        model.impostorsEnabled = impostorsEnabled;
+        packet.visibleChanged = model.Cull(packet.view, packet.projection, windowHeight, packet.visible);
+
+        packet.simulationMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - inputTime).count();
+        packet.quit = false;
+
+        queue.Push();
+    }
+
+    FramePacket& last = queue.AcquireWrite();
+    last.quit = true;
+    queue.Push();
+
+    renderThread.join();
+
+    glfwMakeContextCurrent(window);
+}
+
+// Two views are a stereo pair either side of the camera. More are split-screen views turned evenly around it.
+void build_views(std::vector<CameraView>& views, unsigned int count, float aspect) {
+    constexpr float STEREO_SEPARATION = 0.5f;
+
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    const glm::vec3 position = camera.GetPosition();
+    const glm::vec3 front = camera.GetFront();
+    const glm::mat4 projection = glm::perspective(glm::radians(camera.GetZoom()), aspect, 0.1f, FAR_PLANE);
+
+    views.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        glm::vec3 eye = position;
+        glm::vec3 direction = front;
+
+        if (count == 2) {
+            glm::vec3 right = glm::normalize(glm::cross(front, up));
+            eye += right * STEREO_SEPARATION * (i == 0 ? -0.5f : 0.5f);
+        } else if (count > 2) {
+            float angle = 360.0f * static_cast<float>(i) / static_cast<float>(count);
+            direction = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(angle), up) * glm::vec4(front, 0.0f));
+        }
+
+        views[i].view = glm::lookAt(eye, eye + direction, up);
+        views[i].projection = projection;
+    }
+}
+
+// Renders every view into its own layer of a texture array and tiles the layers onto the window. By default
+// one instanced draw per mesh level covers all views, with a geometry shader copying each triangle to the
+// layers that see it; U switches to drawing the views as separate passes for comparison and Y switches back.
+void run_multiview(GLFWwindow* window, const PacingSettings& pacing, ShaderManager& shaders, Model& model, Shader& shader, Shader& skyboxShader, GLuint skybox, GLuint cubemapTexture, unsigned int viewCount) {
+    Shader& multiviewShader = shaders.Load("multiview.vert", "multiview.geom", "model.frag", [](Shader& program) {
+        program.BindUniformBlock("Views", MULTIVIEW_UBO_BINDING);
+        assign_sampler_units(program);
+    });
+    Shader& skyboxMultiviewShader = shaders.Load("skybox_multiview.vert", "skybox_multiview.geom", "skybox.frag", [](Shader& program) {
+        program.BindUniformBlock("Views", MULTIVIEW_UBO_BINDING);
+    });
+
+    FramePacer pacer(pacing);
+    FrameClock clock;
+    ViewBlock viewBlock;
+    LayeredTarget target;
+    GpuTimer gpuTimer;
+    std::vector<CameraView> views;
+    CommandBuffer commands;
+
+    // Impostor sprites are sized for a single viewport, so every visible instance is drawn as a mesh here.
+    model.impostorsEnabled = false;
+
+    float lastReport = 0.0f;
+    unsigned int framesSinceReport = 0;
+    float cpuMsSinceReport = 0.0f;
+    float gpuMsSinceReport = 0.0f;
+    unsigned int gpuSamplesSinceReport = 0;
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+    auto inputTime = std::chrono::steady_clock::now();
+
+    while (!glfwWindowShouldClose(window)) {
+        pacer.BeginFrame();
+
+        auto frameStart = std::chrono::steady_clock::now();
+
+        shaders.Update();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = clock.Tick();
+
+        process_input(window, deltaTime);
+        process_joystick_input(deltaTime);
+
+        const int screenWidth = static_cast<int>(windowWidth);
+        const int screenHeight = static_cast<int>(windowHeight);
+        const unsigned int columns = viewCount > 1 ? 2 : 1;
+        const unsigned int rows = (viewCount + columns - 1) / columns;
+        const int layerWidth = std::max(screenWidth / static_cast<int>(columns), 1);
+        const int layerHeight = std::max(screenHeight / static_cast<int>(rows), 1);
+
+        build_views(views, viewCount, static_cast<float>(layerWidth) / static_cast<float>(layerHeight));
+
+        model.lodEnabled = lodEnabled;
+        model.indirectInstances = indirectInstances;
+        model.Update(views, static_cast<float>(layerHeight));
+
+        target.Resize(layerWidth, layerHeight, viewCount);
+        gpuTimer.Begin();
+
+        GL_CHECK(glPolygonMode(GL_FRONT_AND_BACK, lineMode ? GL_LINE : GL_FILL));
+
+        drawCalls = 0;
+        triangles = 0;
+
+        if (multiviewPasses) {
+            for (unsigned int v = 0; v < viewCount; v++) {
+                target.BindLayer(v);
+                GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+                shader.Use();
+                shader.Set("projection", views[v].projection);
+                shader.Set("view", views[v].view);
+
+                commands.Reset();
+                model.Draw(shader, commands);
+                commands.Execute();
+
+                drawCalls += model.stats.drawCalls;
+                triangles += model.stats.triangles;
+
+                GL_CHECK(glDepthFunc(GL_LEQUAL));
+
+                skyboxShader.Use();
+                skyboxShader.Set("projection", views[v].projection);
+                skyboxShader.Set("view", glm::mat4(glm::mat3(views[v].view)));
+
+                GL_CHECK(glBindVertexArray(skybox));
+                GL_CHECK(glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture));
+                GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 36));
+                GL_CHECK(glBindVertexArray(0));
+
+                GL_CHECK(glDepthFunc(GL_LESS));
+            }
+        } else {
+            viewBlock.Set(views);
+
+            target.Bind();
+            GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+            multiviewShader.Use();
+
+            commands.Reset();
+            model.Draw(multiviewShader, commands);
+            commands.Execute();
+
+            drawCalls = model.stats.drawCalls;
+            triangles = model.stats.triangles;
+
+            GL_CHECK(glDepthFunc(GL_LEQUAL));
+
+            skyboxMultiviewShader.Use();
+
+            GL_CHECK(glBindVertexArray(skybox));
+            GL_CHECK(glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture));
+            GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 36));
+            GL_CHECK(glBindVertexArray(0));
+
+            GL_CHECK(glDepthFunc(GL_LESS));
+        }
+
+        gpuTimer.End();
+
+        // An odd view count leaves one tile empty.
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        GL_CHECK(glViewport(0, 0, screenWidth, screenHeight));
+        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+
+        for (unsigned int v = 0; v < viewCount; v++) {
+            int x = static_cast<int>(v % columns) * layerWidth;
+            int y = static_cast<int>(rows - 1 - v / columns) * layerHeight;
+
+            target.BlitLayer(v, x, y, layerWidth, layerHeight);
+        }
+
+        float gpuMs = 0.0f;
+        while (gpuTimer.Poll(gpuMs)) {
+            gpuMsSinceReport += gpuMs;
+            gpuSamplesSinceReport++;
+        }
+
+        cpuMsSinceReport += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        framesSinceReport++;
+
+        if (currentFrame - lastReport >= 1.0f) {
+            std::cout << "[Multiview] " << viewCount << (multiviewPasses ? " views as separate passes: " : " views in one pass: ")
+                      << 1000.0f * (currentFrame - lastReport) / framesSinceReport << " ms/frame, "
+                      << cpuMsSinceReport / framesSinceReport << " ms CPU, "
+                      << gpuMsSinceReport / std::max(gpuSamplesSinceReport, 1u) << " ms GPU, "
+                      << model.stats.instances << " visible instances, "
+                      << drawCalls << " draw calls, "
+                      << triangles << " triangles submitted\n";
+
+            lastReport = currentFrame;
+            framesSinceReport = 0;
+            cpuMsSinceReport = 0.0f;
+            gpuMsSinceReport = 0.0f;
+            gpuSamplesSinceReport = 0;
+        }
+
+        glfwSwapBuffers(window);
+        pacer.EndFrame(inputTime);
+
+        glfwPollEvents();
+        inputTime = std::chrono::steady_clock::now();
+    }
+}
+
+// Ray and volume query throughput on the lattice. Rays start on a shell around it and aim at random points
+// inside, so most cross it without hitting anything, which is the worst case for the BVH. The linear scan
+// over instance spheres shows what a query cost before; the volume queries are checked against it.
+void run_pick_bench(Model& model, ThreadPool& pool) {
+    constexpr size_t RAYS = 1000000;
+    constexpr size_t SCAN_RAYS = 100;
+    constexpr size_t VOLUME_QUERIES = 100000;
+    constexpr size_t CHECKED_QUERIES = 100;
+
+    auto buildStart = std::chrono::steady_clock::now();
+    model.UpdateBvh();
+    float buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+    const BvhStats& stats = model.GetBvhStats();
+    std::cout << "BVH over " << model.GetInstances().GetCount() << " instances: " << stats.nodes << " nodes, "
+              << stats.leaves << " leaves, depth " << stats.depth << ", SAH cost " << stats.cost
+              << ", built in " << buildMs << " ms" << std::endl;
+
+    const std::vector<glm::vec4>& spheres = model.GetInstanceSpheres();
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for (const glm::vec4& sphere : spheres) {
+        min = glm::min(min, glm::vec3(sphere));
+        max = glm::max(max, glm::vec3(sphere));
+    }
+
+    const glm::vec3 center = (min + max) * 0.5f;
+    const float reach = glm::length(max - min);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    auto inside = [&]() {
+        return min + (max - min) * glm::vec3(unit(rng), unit(rng), unit(rng));
+    };
+
+    std::vector<glm::vec3> origins(RAYS);
+    std::vector<glm::vec3> directions(RAYS);
+    for (size_t i = 0; i < RAYS; i++) {
+        origins[i] = center + glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * reach;
+        directions[i] = glm::normalize(inside() - origins[i]);
+    }
+
+    auto rayStart = std::chrono::steady_clock::now();
+    size_t hits = 0;
+    for (size_t i = 0; i < RAYS; i++) {
+        RayHit hit;
+        hits += model.RaycastInstances(origins[i], directions[i], hit);
+    }
+    float rayMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - rayStart).count();
+
+    // Batches overlap one ray's cache misses with the others' tests, which is where most of the time goes.
+    std::vector<RayHit> rayHits(RAYS);
+    auto batchStart = std::chrono::steady_clock::now();
+    size_t batchHits = model.RaycastInstances(origins.data(), directions.data(), RAYS, rayHits.data());
+    float batchMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - batchStart).count();
+
+    std::atomic<size_t> parallelHits = 0;
+    auto parallelStart = std::chrono::steady_clock::now();
+    pool.ParallelFor(RAYS, 4096, [&](size_t begin, size_t end) {
+        parallelHits += model.RaycastInstances(origins.data() + begin, directions.data() + begin, end - begin, rayHits.data() + begin);
+    });
+    float parallelMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - parallelStart).count();
+
+    // What picking cost before: every instance sphere against the ray.
+    auto scanStart = std::chrono::steady_clock::now();
+    size_t scanHits = 0;
+    for (size_t i = 0; i < SCAN_RAYS; i++) {
+        float nearest = std::numeric_limits<float>::max();
+
+        for (const glm::vec4& sphere : spheres) {
+            const glm::vec3 offset = glm::vec3(sphere) - origins[i];
+            const float along = glm::dot(offset, directions[i]);
+            const glm::vec3 closest = offset - directions[i] * along;
+
+            if (along > 0.0f && glm::dot(closest, closest) <= sphere.w * sphere.w) {
+                nearest = std::min(nearest, along);
+            }
+        }
+
+        scanHits += nearest < std::numeric_limits<float>::max();
+    }
+    float scanMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - scanStart).count();
+
+    std::cout << RAYS << " rays, " << 100.0f * hits / RAYS << "% hit: "
+              << RAYS / rayMs / 1000.0f << " Mrays/s one at a time, "
+              << RAYS / batchMs / 1000.0f << " Mrays/s batched on one thread, "
+              << RAYS / parallelMs / 1000.0f << " Mrays/s batched on " << pool.GetThreadCount() << " threads ("
+              << (batchHits == hits && parallelHits == hits ? "same hits" : "HITS DIFFER") << "); linear scan "
+              << SCAN_RAYS / scanMs * 1000.0f << " rays/s, " << scanHits << " of " << SCAN_RAYS << " hitting a sphere" << std::endl;
+
+    std::vector<glm::vec3> queryCenters(VOLUME_QUERIES);
+    for (glm::vec3& queryCenter : queryCenters) {
+        queryCenter = inside();
+    }
+
+    const glm::vec3 halfExtent(10.0f);
+    const float radius = 10.0f;
+
+    std::vector<InstanceHandle> found;
+    size_t boxResults = 0;
+    auto boxStart = std::chrono::steady_clock::now();
+    for (const glm::vec3& queryCenter : queryCenters) {
+        found.clear();
+        model.QueryAABB(queryCenter - halfExtent, queryCenter + halfExtent, found);
+        boxResults += found.size();
+    }
+    float boxMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - boxStart).count();
+
+    size_t sphereResults = 0;
+    auto sphereStart = std::chrono::steady_clock::now();
+    for (const glm::vec3& queryCenter : queryCenters) {
+        found.clear();
+        model.QuerySphere(queryCenter, radius, found);
+        sphereResults += found.size();
+    }
+    float sphereMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sphereStart).count();
+
+    size_t mismatches = 0;
+    for (size_t q = 0; q < CHECKED_QUERIES; q++) {
+        size_t expectedBox = 0;
+        size_t expectedSphere = 0;
+
+        for (const glm::vec4& sphere : spheres) {
+            const glm::vec3 offset = glm::vec3(sphere) - glm::clamp(glm::vec3(sphere), queryCenters[q] - halfExtent, queryCenters[q] + halfExtent);
+            const float reachSquared = (radius + sphere.w) * (radius + sphere.w);
+            const glm::vec3 fromCenter = glm::vec3(sphere) - queryCenters[q];
+
+            expectedBox += glm::dot(offset, offset) <= sphere.w * sphere.w;
+            expectedSphere += glm::dot(fromCenter, fromCenter) <= reachSquared;
+        }
+
+        found.clear();
+        model.QueryAABB(queryCenters[q] - halfExtent, queryCenters[q] + halfExtent, found);
+        mismatches += found.size() != expectedBox;
+
+        found.clear();
+        model.QuerySphere(queryCenters[q], radius, found);
+        mismatches += found.size() != expectedSphere;
+    }
+
+    std::cout << VOLUME_QUERIES << " box queries in " << boxMs << " ms (" << static_cast<float>(boxResults) / VOLUME_QUERIES
+              << " instances each), " << VOLUME_QUERIES << " sphere queries in " << sphereMs << " ms ("
+              << static_cast<float>(sphereResults) / VOLUME_QUERIES << " each), "
+              << mismatches << " mismatches against a linear scan" << std::endl;
+
+    // Nudge 1% of the instances and let the next update refit the tree around them.
+    const InstanceRegistry& instances = model.GetInstances();
+    std::uniform_int_distribution<size_t> pick(0, instances.GetCount() - 1);
+
+    for (size_t i = 0; i < instances.GetCount() / 100; i++) {
+        size_t index = pick(rng);
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(normal(rng), normal(rng), normal(rng))) * instances.GetMatrices()[index];
+        model.SetInstance(instances.HandleAt(index), matrix);
+    }
+
+    auto refitStart = std::chrono::steady_clock::now();
+    model.UpdateBvh();
+    float refitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - refitStart).count();
+
+    std::cout << "Moving 1% of instances: tree updated in " << refitMs << " ms, SAH cost now " << model.GetBvhStats().cost << std::endl;
 }
\ No newline at end of file
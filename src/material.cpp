@@ -0,0 +1,182 @@
+#include "material.hpp"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+MaterialLibrary::~MaterialLibrary() {
+    for (TextureArray& array : m_Arrays) {
+        ReleaseGpuMemory(GpuResource::Texture, array.texture);
+        GL_CHECK(glDeleteTextures(1, &array.texture));
+    }
+}
+
+unsigned int MaterialLibrary::Add(const std::array<std::string, MATERIAL_SLOT_COUNT>& paths, const std::string& directory) {
+    std::array<int, MATERIAL_SLOT_COUNT> source;
+
+    for (unsigned int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+        source[slot] = -1;
+
+        if (paths[slot].empty()) {
+            continue;
+        }
+
+        const std::string filename = directory + '/' + paths[slot];
+        auto found = m_ImageLookup.find(filename);
+
+        if (found == m_ImageLookup.end()) {
+            found = m_ImageLookup.emplace(filename, static_cast<unsigned int>(m_Images.size())).first;
+            m_Images.push_back(filename);
+        }
+
+        source[slot] = static_cast<int>(found->second);
+    }
+
+    for (unsigned int i = 0; i < m_Sources.size(); i++) {
+        if (m_Sources[i] == source) {
+            return i;
+        }
+    }
+
+    m_Sources.push_back(source);
+
+    return static_cast<unsigned int>(m_Sources.size() - 1);
+}
+
+void MaterialLibrary::Upload() {
+    MemoryScope scope(MemoryCategory::Textures);
+
+    struct Image {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        unsigned char* pixels = nullptr;
+    };
+
+    // Everything is expanded to RGBA8 so size alone decides which images can share an array. Images with an
+    // alpha channel still get their own arrays, since cut-outs are clamped at the edges rather than repeated.
+    std::vector<Image> images(m_Images.size());
+    std::map<std::tuple<int, int, bool>, std::vector<unsigned int>> groups;
+
+    for (unsigned int i = 0; i < images.size(); i++) {
+        Image& image = images[i];
+        image.pixels = stbi_load(m_Images[i].c_str(), &image.width, &image.height, &image.channels, 4);
+
+        if (!image.pixels) {
+            std::cerr << "Texture failed to load at path: " << m_Images[i] << std::endl;
+            continue;
+        }
+
+        groups[{ image.width, image.height, image.channels == 4 }].push_back(i);
+    }
+
+    GLint maxLayers = 0;
+    GL_CHECK(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+
+    std::vector<MaterialLayer> placement(images.size());
+    unsigned int unplaced = 0;
+
+    for (const auto& [key, members] : groups) {
+        const auto [width, height, alpha] = key;
+
+        for (size_t first = 0; first < members.size(); first += static_cast<size_t>(maxLayers)) {
+            const unsigned int layers = static_cast<unsigned int>(std::min(members.size() - first, static_cast<size_t>(maxLayers)));
+
+            if (m_Arrays.size() == MAX_MATERIAL_ARRAYS) {
+                unplaced += layers;
+                continue;
+            }
+
+            TextureArray array;
+            array.width = width;
+            array.height = height;
+            array.layers = layers;
+
+            GL_CHECK(glGenTextures(1, &array.texture));
+            GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture));
+            GL_CHECK(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+
+            for (unsigned int layer = 0; layer < layers; layer++) {
+                const unsigned int image = members[first + layer];
+
+                GL_CHECK(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, images[image].pixels));
+                placement[image] = { static_cast<int>(m_Arrays.size()), static_cast<int>(layer) };
+            }
+
+            GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+
+            const GLint wrap = alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+            const size_t bytes = static_cast<size_t>(width) * height * 4 * layers * 4 / 3;
+            TrackGpuMemory(GpuResource::Texture, array.texture, MemoryCategory::Textures, bytes);
+
+            m_Stats.bytes += bytes;
+            m_Arrays.push_back(array);
+        }
+    }
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    for (Image& image : images) {
+        stbi_image_free(image.pixels);
+    }
+
+    if (unplaced > 0) {
+        std::cerr << "Only " << MAX_MATERIAL_ARRAYS << " texture sizes fit the material arrays; " << unplaced << " textures left out" << std::endl;
+    }
+
+    m_Materials.resize(m_Sources.size());
+
+    for (unsigned int i = 0; i < m_Sources.size(); i++) {
+        for (unsigned int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+            if (m_Sources[i][slot] < 0) {
+                continue;
+            }
+
+            m_Materials[i].layers[slot] = placement[m_Sources[i][slot]];
+            m_Materials[i].textureCount++;
+        }
+    }
+
+    m_Stats.materials = static_cast<unsigned int>(m_Materials.size());
+    m_Stats.textures = static_cast<unsigned int>(m_Images.size()) - unplaced;
+    m_Stats.arrays = static_cast<unsigned int>(m_Arrays.size());
+}
+
+unsigned int MaterialLibrary::Bind(CommandBuffer& commands) const {
+    for (unsigned int i = 0; i < m_Arrays.size(); i++) {
+        commands.BindTexture(MATERIAL_TEXTURE_UNIT + i, GL_TEXTURE_2D_ARRAY, m_Arrays[i].texture);
+    }
+
+    return static_cast<unsigned int>(m_Arrays.size());
+}
+
+void MaterialLibrary::Use(Shader& shader, CommandBuffer& commands, unsigned int material) const {
+    MaterialLayer diffuse;
+
+    if (material < m_Materials.size()) {
+        diffuse = m_Materials[material].layers[MATERIAL_DIFFUSE];
+    }
+
+    // model.frag only shades with the diffuse map. The array is offset by one so that the uniform's default of
+    // zero, as seen by draws that never pick a material, means untextured.
+    commands.SetUniform(shader, "materialDiffuse", glm::vec2(static_cast<float>(diffuse.array + 1), static_cast<float>(diffuse.layer)));
+}
+
+const Material& MaterialLibrary::Get(unsigned int material) const {
+    return m_Materials[material];
+}
+
+size_t MaterialLibrary::GetCount() const {
+    return m_Materials.size();
+}
+
+const MaterialStats& MaterialLibrary::GetStats() const {
+    return m_Stats;
+}
\ No newline at end of file
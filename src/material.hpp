@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "commands.hpp"
+#include "memory.hpp"
+#include "shader.hpp"
+#include "utility.hpp"
+
+// Must match the materialArrays sampler array in model.frag, which can only index it with constants.
+constexpr unsigned int MAX_MATERIAL_ARRAYS = 4;
+// First of the texture units the arrays are bound to, below the shadow and light units.
+constexpr GLuint MATERIAL_TEXTURE_UNIT = 0;
+
+// Texture kinds a material can carry, in the order assimp's diffuse, specular, height and ambient maps are read.
+enum MaterialSlot {
+    MATERIAL_DIFFUSE = 0,
+    MATERIAL_SPECULAR,
+    MATERIAL_NORMAL,
+    MATERIAL_HEIGHT,
+    MATERIAL_SLOT_COUNT
+};
+
+// Where a slot's texture ended up. array is -1 when the slot is empty or its texture could not be placed.
+struct MaterialLayer {
+    int array = -1;
+    int layer = 0;
+};
+
+struct Material {
+    MaterialLayer layers[MATERIAL_SLOT_COUNT];
+    // Textures the material references, which is what binding them one by one per draw would cost.
+    unsigned int textureCount = 0;
+};
+
+struct MaterialStats {
+    unsigned int materials = 0;
+    unsigned int textures = 0;
+    unsigned int arrays = 0;
+    size_t bytes = 0;
+};
+
+// Packs every texture of a model's materials into GL_TEXTURE_2D_ARRAY layers, one array per image size, so
+// all of them are bound once per frame and a material is selected by uniform instead of by rebinding.
+// Materials are added while meshes are loaded and resolved to layers by a single Upload afterwards.
+class MaterialLibrary {
+public:
+    MaterialLibrary() = default;
+    ~MaterialLibrary();
+
+    MaterialLibrary(const MaterialLibrary&) = delete;
+    MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+
+    // Paths are relative to directory, empty for an unused slot. Materials naming the same textures share an
+    // index, so meshes that only differ in name still sort together.
+    unsigned int Add(const std::array<std::string, MATERIAL_SLOT_COUNT>& paths, const std::string& directory);
+
+    // Decodes every referenced image and packs same-sized ones into arrays. Anything beyond
+    // MAX_MATERIAL_ARRAYS sizes is reported on std::cerr and left untextured.
+    void Upload();
+
+    // Binds every array to its unit and returns the number of binds issued. The shader's samplers are assigned
+    // once at startup, so nothing here depends on the shader.
+    unsigned int Bind(CommandBuffer& commands) const;
+    // Points the shader at a material's layers.
+    void Use(Shader& shader, CommandBuffer& commands, unsigned int material) const;
+
+    const Material& Get(unsigned int material) const;
+    size_t GetCount() const;
+    const MaterialStats& GetStats() const;
+
+private:
+    struct TextureArray {
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        unsigned int layers = 0;
+    };
+
+    std::vector<std::string> m_Images;
+    std::map<std::string, unsigned int> m_ImageLookup;
+    // Per material, the image index of each slot or -1.
+    std::vector<std::array<int, MATERIAL_SLOT_COUNT>> m_Sources;
+    std::vector<Material> m_Materials;
+    std::vector<TextureArray> m_Arrays;
+    MaterialStats m_Stats;
+};
\ No newline at end of file
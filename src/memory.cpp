@@ -0,0 +1,238 @@
+#include "memory.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // Every block starts with its size and category. Sixteen bytes keep the caller's pointer as aligned as
+    // malloc's own; over-aligned types go through the aligned forms of new, which are left alone.
+    struct AllocationHeader {
+        size_t size;
+        MemoryCategory category;
+    };
+
+    constexpr size_t HEADER_SIZE = 16;
+    static_assert(sizeof(AllocationHeader) <= HEADER_SIZE);
+
+    std::atomic<unsigned long long> heapAllocations = 0;
+    std::atomic<size_t> cpuBytes[MEMORY_CATEGORY_COUNT] = {};
+
+    thread_local MemoryCategory currentCategory = MemoryCategory::Other;
+
+    struct GpuAllocation {
+        MemoryCategory category;
+        size_t bytes;
+    };
+
+    // Buffers, textures and renderbuffers have separate id spaces, so the type goes in the key's upper half.
+    std::unordered_map<uint64_t, GpuAllocation> gpuAllocations;
+    size_t gpuBytes[MEMORY_CATEGORY_COUNT] = {};
+
+    uint64_t gpuKey(GpuResource type, GLuint id) {
+        return (static_cast<uint64_t>(type) << 32) | id;
+    }
+
+    void* allocate(size_t size) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        void* block = std::malloc(HEADER_SIZE + size);
+
+        if (!block) {
+            return nullptr;
+        }
+
+        AllocationHeader* header = static_cast<AllocationHeader*>(block);
+        header->size = size;
+        header->category = currentCategory;
+
+        cpuBytes[static_cast<size_t>(header->category)].fetch_add(size, std::memory_order_relaxed);
+
+        return static_cast<std::byte*>(block) + HEADER_SIZE;
+    }
+
+    void deallocate(void* pointer) {
+        if (!pointer) {
+            return;
+        }
+
+        void* block = static_cast<std::byte*>(pointer) - HEADER_SIZE;
+        const AllocationHeader* header = static_cast<const AllocationHeader*>(block);
+
+        cpuBytes[static_cast<size_t>(header->category)].fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+// Counts and attributes every allocation. The array forms forward to these; the nothrow forms are replaced
+// too, since a library is free to implement them on malloc directly and they must agree on the header.
+void* operator new(size_t size) {
+    if (void* pointer = allocate(size)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    deallocate(pointer);
+}
+
+size_t MemoryUsage::GpuTotal() const {
+    size_t total = 0;
+
+    for (size_t bytes : gpu) {
+        total += bytes;
+    }
+
+    return total;
+}
+
+size_t MemoryUsage::CpuTotal() const {
+    size_t total = 0;
+
+    for (size_t bytes : cpu) {
+        total += bytes;
+    }
+
+    return total;
+}
+
+MemoryScope::MemoryScope(MemoryCategory category) : m_Previous(currentCategory) {
+    currentCategory = category;
+}
+
+MemoryScope::~MemoryScope() {
+    currentCategory = m_Previous;
+}
+
+void TrackGpuMemory(GpuResource type, GLuint id, MemoryCategory category, size_t bytes) {
+    if (id == 0) {
+        return;
+    }
+
+    GpuAllocation& allocation = gpuAllocations.try_emplace(gpuKey(type, id), GpuAllocation { category, 0 }).first->second;
+
+    gpuBytes[static_cast<size_t>(allocation.category)] -= allocation.bytes;
+    allocation = { category, bytes };
+    gpuBytes[static_cast<size_t>(category)] += bytes;
+}
+
+void ReleaseGpuMemory(GpuResource type, GLuint id) {
+    auto found = gpuAllocations.find(gpuKey(type, id));
+
+    if (found == gpuAllocations.end()) {
+        return;
+    }
+
+    gpuBytes[static_cast<size_t>(found->second.category)] -= found->second.bytes;
+    gpuAllocations.erase(found);
+}
+
+MemoryUsage GetMemoryUsage() {
+    MemoryUsage usage;
+
+    for (size_t i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        usage.gpu[i] = gpuBytes[i];
+        usage.cpu[i] = cpuBytes[i].load(std::memory_order_relaxed);
+    }
+
+    return usage;
+}
+
+const char* MemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+    case MemoryCategory::Geometry: return "geometry";
+    case MemoryCategory::Instances: return "instances";
+    case MemoryCategory::Culling: return "culling";
+    case MemoryCategory::Textures: return "textures";
+    case MemoryCategory::Lighting: return "lighting";
+    case MemoryCategory::Shadows: return "shadows";
+    case MemoryCategory::RenderTargets: return "render targets";
+    case MemoryCategory::Capture: return "capture";
+    default: return "other";
+    }
+}
+
+void PrintMemoryReport(std::ostream& out, const MemoryUsage& usage) {
+    constexpr double MB = 1024.0 * 1024.0;
+
+    for (size_t i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        if (usage.gpu[i] == 0 && usage.cpu[i] == 0) {
+            continue;
+        }
+
+        out << "  " << MemoryCategoryName(static_cast<MemoryCategory>(i)) << ": "
+            << usage.gpu[i] / MB << " MB GPU, " << usage.cpu[i] / MB << " MB CPU\n";
+    }
+
+    out << "  total: " << usage.GpuTotal() / MB << " MB GPU, " << usage.CpuTotal() / MB << " MB CPU, peak RSS "
+        << PeakResidentBytes() / MB << " MB\n";
+}
+
+bool WithinMemoryBudget(const MemoryUsage& usage, const MemoryBudget& budget) {
+    return (budget.gpuBytes == 0 || usage.GpuTotal() <= budget.gpuBytes)
+        && (budget.cpuBytes == 0 || usage.CpuTotal() <= budget.cpuBytes);
+}
+
+unsigned long long HeapAllocationCount() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+
+size_t PeakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+
+    return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    // Linux reports kilobytes.
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
\ No newline at end of file
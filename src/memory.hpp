@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <iostream>
+
+// What a block of memory is for. CPU allocations are charged to whichever category the allocating thread's
+// innermost MemoryScope names, and GL objects to the category they were tracked under.
+enum class MemoryCategory : unsigned char {
+    Other = 0,
+    Geometry,
+    Instances,
+    Culling,
+    Textures,
+    Lighting,
+    Shadows,
+    RenderTargets,
+    Capture,
+    Count
+};
+
+constexpr size_t MEMORY_CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Count);
+
+enum class GpuResource {
+    Buffer,
+    Texture,
+    Renderbuffer
+};
+
+struct MemoryUsage {
+    size_t gpu[MEMORY_CATEGORY_COUNT] = {};
+    size_t cpu[MEMORY_CATEGORY_COUNT] = {};
+
+    size_t GpuTotal() const;
+    size_t CpuTotal() const;
+};
+
+// Zero leaves a side unlimited.
+struct MemoryBudget {
+    size_t gpuBytes = 0;
+    size_t cpuBytes = 0;
+};
+
+// Charges the CPU allocations made on this thread while it lives to a category. Scopes nest, and a block is
+// always credited back to the category it was charged to, whichever thread frees it.
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryCategory category);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryCategory m_Previous;
+};
+
+// Records the storage behind a GL object, replacing what was recorded for it before, so call it again after
+// every glBufferData or glTexImage that respecifies the object. bytes is the driver-side estimate: texels
+// times texel size, with a third on top for a full mip chain. GL thread only, like the calls it shadows.
+void TrackGpuMemory(GpuResource type, GLuint id, MemoryCategory category, size_t bytes);
+// Forgets an object about to be deleted. Unknown or zero ids are ignored.
+void ReleaseGpuMemory(GpuResource type, GLuint id);
+
+MemoryUsage GetMemoryUsage();
+const char* MemoryCategoryName(MemoryCategory category);
+// One line per category with anything charged to it, then the totals.
+void PrintMemoryReport(std::ostream& out, const MemoryUsage& usage);
+// False when either side is over its budget.
+bool WithinMemoryBudget(const MemoryUsage& usage, const MemoryBudget& budget);
+
+// Calls to the global operator new since startup, counted by the replacement in memory.cpp.
+unsigned long long HeapAllocationCount();
+// High-water mark of the process's resident memory, or 0 where the platform doesn't report it.
+size_t PeakResidentBytes();
\ No newline at end of file
@@ -1,44 +1,144 @@
 #include "mesh.hpp"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+#include <algorithm>
+#include <utility>
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, unsigned int material, std::vector<MeshLod> lods, std::vector<Meshlet> meshlets) {
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->material = material;
+    this->lods = std::move(lods);
+    this->meshlets = std::move(meshlets);
+
+    if (this->lods.empty()) {
+        this->lods.push_back({ 0, static_cast<unsigned int>(this->indices.size()) });
+    }
 
     setupMesh();
 }
 
-void Mesh::Draw(Shader& shader, unsigned int amount) {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
-
-    for (unsigned int i = 0; i < textures.size(); i++) {
-        GL_CHECK(glActiveTexture(GL_TEXTURE0 + i));
-
-        std::string number;
-        std::string name = textures[i].type;
-
-        if (name == "texture_diffuse") {
-            number = std::to_string(diffuseNr++);
-        } else if (name == "texture_specular") {
-            number = std::to_string(specularNr++);
-        } else if (name == "texture_normal") {
-            number = std::to_string(normalNr++);
-        } else if (name == "texture_height") {
-            number = std::to_string(heightNr++);
+void Mesh::Draw(CommandBuffer& commands, unsigned int amount, unsigned int baseInstance, unsigned int lod) {
+    const MeshLod& level = lods[lod < lods.size() ? lod : lods.size() - 1];
+    const size_t offset = level.firstIndex * sizeof(unsigned int);
+
+    commands.BindVertexArray(VAO);
+
+    // GL 3.3 has no base instance, so the instance attributes are re-pointed at the start of the range instead.
+    if (GLAD_GL_VERSION_4_2) {
+        commands.DrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, offset, amount, baseInstance);
+    } else {
+        if (baseInstance != instanceOffset) {
+            bindInstanceAttributes(commands, baseInstance);
+        }
+
+        commands.DrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, offset, amount);
+    }
+
+    commands.BindVertexArray(0);
+}
+
+void Mesh::Draw(CommandBuffer& commands, const std::vector<DrawElementsCommand>& ranges) {
+    if (ranges.empty()) {
+        return;
+    }
+
+    commands.BindVertexArray(VAO);
+
+    if (GLAD_GL_VERSION_4_3) {
+        // The buffer is grown now, while recording, so the upload recorded below always fits.
+        if (!indirectBuffer) {
+            GL_CHECK(glGenBuffers(1, &indirectBuffer));
+        }
+
+        if (ranges.size() > indirectCapacity) {
+            indirectCapacity = std::max(ranges.size(), indirectCapacity * 2);
+            GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer));
+            GL_CHECK(glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(DrawElementsCommand), nullptr, GL_STREAM_DRAW));
+            GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+            TrackGpuMemory(GpuResource::Buffer, indirectBuffer, MemoryCategory::Culling, indirectCapacity * sizeof(DrawElementsCommand));
+        }
+
+        commands.BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        commands.BufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, ranges.size() * sizeof(DrawElementsCommand), ranges.data());
+        commands.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(ranges.size()), 0);
+        commands.BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+        // Without base instance a non-instanced draw reads instance attributes at their pointer's start, so
+        // they are re-pointed once per instance and its ranges go out as one multi-draw.
+        size_t first = 0;
+
+        while (first < ranges.size()) {
+            const unsigned int instance = ranges[first].baseInstance;
+
+            rangeCounts.clear();
+            rangeOffsets.clear();
+
+            size_t last = first;
+            for (; last < ranges.size() && ranges[last].baseInstance == instance; last++) {
+                rangeCounts.push_back(static_cast<GLsizei>(ranges[last].count));
+                rangeOffsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(ranges[last].firstIndex) * sizeof(unsigned int)));
+            }
+
+            if (instance != instanceOffset) {
+                bindInstanceAttributes(commands, instance);
+            }
+
+            commands.MultiDrawElements(GL_TRIANGLES, rangeCounts.data(), GL_UNSIGNED_INT, rangeOffsets.data(), static_cast<GLsizei>(rangeCounts.size()));
+            first = last;
         }
 
-        shader.Set(("material." + name + number).c_str(), static_cast<int>(i));
-        GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures[i].id));
+        // The instanced Draw's base instance path expects the pointers at the start of the buffers.
+        if (GLAD_GL_VERSION_4_2 && instanceOffset != 0) {
+            bindInstanceAttributes(commands, 0);
+        }
     }
 
+    commands.BindVertexArray(0);
+}
+
+void Mesh::SetInstanceBuffer(unsigned int buffer) {
+    instanceVBO = buffer;
+
+    GL_CHECK(glBindVertexArray(VAO));
+
+    GL_CHECK(glEnableVertexAttribArray(3));
+    GL_CHECK(glEnableVertexAttribArray(4));
+    GL_CHECK(glEnableVertexAttribArray(5));
+    GL_CHECK(glEnableVertexAttribArray(6));
+
+    CommandBuffer commands;
+    bindInstanceAttributes(commands, 0);
+    commands.Execute();
+
+    GL_CHECK(glVertexAttribDivisor(3, 1));
+    GL_CHECK(glVertexAttribDivisor(4, 1));
+    GL_CHECK(glVertexAttribDivisor(5, 1));
+    GL_CHECK(glVertexAttribDivisor(6, 1));
+
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void Mesh::SetInstanceIdBuffer(unsigned int buffer) {
+    instanceIdVBO = buffer;
+
     GL_CHECK(glBindVertexArray(VAO));
-    GL_CHECK(glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, amount));
+    GL_CHECK(glEnableVertexAttribArray(7));
+
+    CommandBuffer commands;
+    bindInstanceAttributes(commands, instanceOffset);
+    commands.Execute();
+
+    GL_CHECK(glVertexAttribDivisor(7, 1));
     GL_CHECK(glBindVertexArray(0));
+}
 
-    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+void Mesh::ReleaseCpuCopies() {
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
+
+unsigned int Mesh::TriangleCount(unsigned int lod) const {
+    return lods[lod < lods.size() ? lod : lods.size() - 1].indexCount / 3;
 }
 
 void Mesh::setupMesh() {
@@ -48,10 +148,12 @@ void Mesh::setupMesh() {
     GL_CHECK(glGenBuffers(1, &VBO));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
     GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, VBO, MemoryCategory::Geometry, vertices.size() * sizeof(Vertex));
     
     GL_CHECK(glGenBuffers(1, &EBO));
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO));
     GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, EBO, MemoryCategory::Geometry, indices.size() * sizeof(unsigned int));
 
     GL_CHECK(glEnableVertexAttribArray(0));
     GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(0)));
@@ -63,4 +165,23 @@ void Mesh::setupMesh() {
     GL_CHECK(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, TexCoords))));
 
     GL_CHECK(glBindVertexArray(0));
+}
+
+void Mesh::bindInstanceAttributes(CommandBuffer& commands, unsigned int baseInstance) {
+    if (instanceVBO) {
+        size_t base = static_cast<size_t>(baseInstance) * sizeof(glm::mat4);
+
+        commands.BindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        commands.VertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), base);
+        commands.VertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), base + sizeof(glm::vec4));
+        commands.VertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), base + 2 * sizeof(glm::vec4));
+        commands.VertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), base + 3 * sizeof(glm::vec4));
+    }
+
+    if (instanceIdVBO) {
+        commands.BindBuffer(GL_ARRAY_BUFFER, instanceIdVBO);
+        commands.VertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(unsigned int), static_cast<size_t>(baseInstance) * sizeof(unsigned int));
+    }
+
+    instanceOffset = baseInstance;
 }
\ No newline at end of file
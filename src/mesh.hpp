@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 
+#include "commands.hpp"
+#include "memory.hpp"
 #include "shader.hpp"
 #include "utility.hpp"
 
@@ -17,10 +19,34 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
-struct Texture {
-    unsigned int id;
-    std::string type;
-    std::string path;
+// Slice of the element buffer holding one level of detail.
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// Cluster of at most MESHLET_MAX_TRIANGLES triangles over at most MESHLET_MAX_VERTICES vertices, stored as a
+// contiguous slice of the full-detail level so surviving clusters can be drawn as index ranges.
+struct Meshlet {
+    // Object-space bounding sphere, xyz centre and w radius.
+    glm::vec4 sphere;
+    // Normal cone. Every triangle faces away from an eye for which dot(normalize(apex - eye), axis) >= cutoff;
+    // a cutoff of 1 or more never culls.
+    glm::vec3 coneApex;
+    glm::vec3 coneAxis;
+    float coneCutoff;
+    unsigned int firstIndex;
+    unsigned int triangleCount;
+    unsigned int vertexCount;
+};
+
+// Layout of GL's DrawElementsIndirectCommand.
+struct DrawElementsCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
 };
 
 class Mesh {
@@ -28,16 +54,44 @@ public:
     // Mesh data.
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    // Index into the owning model's MaterialLibrary.
+    unsigned int material = 0;
+    std::vector<MeshLod> lods;
+    // Clusters of the first level, empty for meshes too small to be worth splitting.
+    std::vector<Meshlet> meshlets;
     unsigned int VAO;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // Takes the buffers by value so callers can move them in.
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, unsigned int material, std::vector<MeshLod> lods = {}, std::vector<Meshlet> meshlets = {});
+
+    void Draw(CommandBuffer& commands, unsigned int amount, unsigned int baseInstance = 0, unsigned int lod = 0);
+
+    // Draws single-instance index ranges, as produced by meshlet culling. Ranges for the same instance must be
+    // adjacent. Uses one indirect multi-draw where GL 4.3 is available and one multi-draw per instance otherwise.
+    void Draw(CommandBuffer& commands, const std::vector<DrawElementsCommand>& ranges);
+
+    void SetInstanceBuffer(unsigned int buffer);
+
+    // Per-instance uint32 index into the resident transform buffer, bound at location 7.
+    void SetInstanceIdBuffer(unsigned int buffer);
+
+    // Frees vertices and indices once they live in the GL buffers. Levels and meshlets only address ranges of
+    // the element buffer, so drawing, LOD selection and meshlet culling carry on without them.
+    void ReleaseCpuCopies();
 
-    void Draw(Shader& shader, unsigned int amount);
+    unsigned int TriangleCount(unsigned int lod = 0) const;
 
 private:
     // Render data;
     unsigned int VBO, EBO;
+    unsigned int instanceVBO = 0;
+    unsigned int instanceIdVBO = 0;
+    unsigned int instanceOffset = 0;
+    unsigned int indirectBuffer = 0;
+    size_t indirectCapacity = 0;
+    std::vector<GLsizei> rangeCounts;
+    std::vector<const void*> rangeOffsets;
 
     void setupMesh();
+    void bindInstanceAttributes(CommandBuffer& commands, unsigned int baseInstance);
 };
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Cones wider than this (about 84 degrees from the axis) almost never cull, so they are not tested at all.
+    constexpr float MIN_CONE_SPREAD = 0.1f;
+
+    glm::vec3 faceNormal(const std::vector<Vertex>& vertices, const unsigned int* triangle) {
+        const glm::vec3& a = vertices[triangle[0]].Position;
+        const glm::vec3& b = vertices[triangle[1]].Position;
+        const glm::vec3& c = vertices[triangle[2]].Position;
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+
+        return length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    // Fits the sphere and normal cone of the triangles in clustered[first, first + count * 3).
+    void computeBounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clustered, std::pmr::vector<glm::vec3>& points) {
+        const unsigned int* triangles = clustered.data() + meshlet.firstIndex;
+
+        points.clear();
+        for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++) {
+            points.push_back(vertices[triangles[i]].Position);
+        }
+
+        BoundingSphere sphere = ComputeBoundingSphere(points);
+        meshlet.sphere = glm::vec4(sphere.center, sphere.radius);
+
+        glm::vec3 axis(0.0f);
+        for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+            axis += faceNormal(vertices, triangles + t * 3);
+        }
+
+        meshlet.coneAxis = glm::length(axis) > 0.0f ? glm::normalize(axis) : glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneApex = sphere.center;
+        meshlet.coneCutoff = 1.0f;
+
+        float spread = 1.0f;
+        for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+            glm::vec3 normal = faceNormal(vertices, triangles + t * 3);
+
+            if (normal != glm::vec3(0.0f)) {
+                spread = std::min(spread, glm::dot(normal, meshlet.coneAxis));
+            }
+        }
+
+        if (spread <= MIN_CONE_SPREAD) {
+            return;
+        }
+
+        // Slide the apex back along the axis until it is behind every triangle's plane, so an eye inside the
+        // cone's back half sees all of them from behind.
+        float behind = 0.0f;
+        for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+            glm::vec3 normal = faceNormal(vertices, triangles + t * 3);
+
+            if (normal == glm::vec3(0.0f)) {
+                continue;
+            }
+
+            float distance = glm::dot(sphere.center - vertices[triangles[t * 3]].Position, normal);
+            behind = std::max(behind, distance / glm::dot(meshlet.coneAxis, normal));
+        }
+
+        meshlet.coneApex = sphere.center - meshlet.coneAxis * behind;
+        meshlet.coneCutoff = std::sqrt(1.0f - spread * spread);
+    }
+
+    std::vector<std::array<unsigned int, 3>> sortedTriangles(const std::vector<unsigned int>& indices) {
+        std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+
+        for (size_t t = 0; t < triangles.size(); t++) {
+            triangles[t] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::pmr::memory_resource* scratch) {
+    std::vector<Meshlet> meshlets;
+
+    const size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    // Triangles around each vertex, packed so vertex v's are adjacency[offsets[v], offsets[v + 1]).
+    std::pmr::vector<unsigned int> offsets(vertices.size() + 1, 0, scratch);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        offsets[indices[i] + 1]++;
+    }
+
+    for (size_t v = 0; v < vertices.size(); v++) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::pmr::vector<unsigned int> adjacency(triangleCount * 3, scratch);
+    std::pmr::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1, scratch);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::pmr::vector<glm::vec3> centroids(triangleCount, scratch);
+    for (size_t t = 0; t < triangleCount; t++) {
+        centroids[t] = (vertices[indices[t * 3]].Position + vertices[indices[t * 3 + 1]].Position + vertices[indices[t * 3 + 2]].Position) / 3.0f;
+    }
+
+    // Unclustered triangles left around each vertex.
+    std::pmr::vector<unsigned int> live(vertices.size(), scratch);
+    for (size_t v = 0; v < vertices.size(); v++) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+
+    std::pmr::vector<unsigned char> emitted(triangleCount, 0, scratch);
+    // Holds the number of the cluster a vertex was last added to, so membership needs no clearing.
+    std::pmr::vector<unsigned int> stamp(vertices.size(), 0, scratch);
+    std::pmr::vector<unsigned int> candidates(scratch);
+    std::pmr::vector<glm::vec3> points(scratch);
+    // Becomes the mesh's index list, so it stays on the heap.
+    std::vector<unsigned int> clustered;
+
+    clustered.reserve(indices.size());
+    // Room for a full cluster's rim at typical valences, and for clusters at least half full, so none of these
+    // regrow on ordinary meshes.
+    candidates.reserve(MESHLET_MAX_VERTICES * 8);
+    points.reserve(MESHLET_MAX_TRIANGLES * 3);
+    meshlets.reserve(triangleCount / (MESHLET_MAX_TRIANGLES / 2) + 1);
+
+    size_t scan = 0;
+    size_t emittedCount = 0;
+    unsigned int seed = 0;
+
+    while (emittedCount < triangleCount) {
+        Meshlet meshlet = {};
+        meshlet.firstIndex = static_cast<unsigned int>(clustered.size());
+
+        const unsigned int number = static_cast<unsigned int>(meshlets.size()) + 1;
+
+        auto newVertices = [&](unsigned int triangle) {
+            unsigned int count = 0;
+            for (unsigned int k = 0; k < 3; k++) {
+                count += stamp[indices[triangle * 3 + k]] != number;
+            }
+            return count;
+        };
+
+        auto liveNeighbours = [&](unsigned int triangle) {
+            return live[indices[triangle * 3]] + live[indices[triangle * 3 + 1]] + live[indices[triangle * 3 + 2]];
+        };
+
+        glm::vec3 centroidSum(0.0f);
+
+        auto add = [&](unsigned int triangle) {
+            emitted[triangle] = 1;
+            centroidSum += centroids[triangle];
+            emittedCount++;
+            meshlet.triangleCount++;
+
+            for (unsigned int k = 0; k < 3; k++) {
+                unsigned int vertex = indices[triangle * 3 + k];
+                clustered.push_back(vertex);
+                live[vertex]--;
+
+                if (stamp[vertex] == number) {
+                    continue;
+                }
+
+                stamp[vertex] = number;
+                meshlet.vertexCount++;
+
+                for (unsigned int a = offsets[vertex]; a < offsets[vertex + 1]; a++) {
+                    if (!emitted[adjacency[a]]) {
+                        candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+        };
+
+        add(seed);
+
+        while (meshlet.triangleCount < MESHLET_MAX_TRIANGLES) {
+            // Fewest new vertices first, then the triangle with the fewest unclustered neighbours so corners are
+            // not left behind as slivers, then the one closest to the cluster's centre, which keeps clusters round
+            // rather than strips and so fits more triangles under the vertex limit.
+            const glm::vec3 centre = centroidSum / static_cast<float>(meshlet.triangleCount);
+
+            unsigned int best = 0;
+            unsigned int bestCost = 4;
+            unsigned int bestLive = 0;
+            float bestDistance = 0.0f;
+
+            for (size_t c = 0; c < candidates.size();) {
+                if (emitted[candidates[c]]) {
+                    candidates[c] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                const unsigned int cost = newVertices(candidates[c]);
+
+                if (cost <= bestCost && meshlet.vertexCount + cost <= MESHLET_MAX_VERTICES) {
+                    const unsigned int neighbours = liveNeighbours(candidates[c]);
+                    const glm::vec3 offset = centroids[candidates[c]] - centre;
+                    const float distance = glm::dot(offset, offset);
+
+                    if (cost < bestCost || neighbours < bestLive || (neighbours == bestLive && distance < bestDistance)) {
+                        best = candidates[c];
+                        bestCost = cost;
+                        bestLive = neighbours;
+                        bestDistance = distance;
+                    }
+                }
+
+                c++;
+            }
+
+            if (bestCost == 4) {
+                break;
+            }
+
+            add(best);
+        }
+
+        computeBounds(meshlet, vertices, clustered, points);
+        meshlets.push_back(meshlet);
+
+        if (emittedCount == triangleCount) {
+            break;
+        }
+
+        // Carry on from the rim of the cluster just closed where possible, which keeps neighbouring clusters
+        // close in the element buffer; fall back to the next untouched triangle in source order.
+        bool found = false;
+        for (unsigned int candidate : candidates) {
+            if (!emitted[candidate]) {
+                seed = candidate;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            while (emitted[scan]) {
+                scan++;
+            }
+            seed = static_cast<unsigned int>(scan);
+        }
+
+        candidates.clear();
+    }
+
+    indices = std::move(clustered);
+
+    return meshlets;
+}
+
+bool ValidateMeshlets(const std::vector<Meshlet>& meshlets, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& source, const std::vector<unsigned int>& clustered) {
+    bool valid = true;
+
+    if (sortedTriangles(source) != sortedTriangles(clustered)) {
+        std::cerr << "Meshlets do not hold the same triangles as the source mesh" << std::endl;
+        valid = false;
+    }
+
+    unsigned int next = 0;
+    std::vector<unsigned int> local;
+
+    for (size_t m = 0; m < meshlets.size(); m++) {
+        const Meshlet& meshlet = meshlets[m];
+        const unsigned int* triangles = clustered.data() + meshlet.firstIndex;
+
+        if (meshlet.firstIndex != next) {
+            std::cerr << "Meshlet " << m << " starts at index " << meshlet.firstIndex << " instead of " << next << std::endl;
+            valid = false;
+        }
+
+        next = meshlet.firstIndex + meshlet.triangleCount * 3;
+
+        if (next > clustered.size()) {
+            std::cerr << "Meshlet " << m << " runs past the end of the index list" << std::endl;
+            return false;
+        }
+
+        local.assign(triangles, triangles + meshlet.triangleCount * 3);
+        std::sort(local.begin(), local.end());
+        const size_t vertexCount = std::unique(local.begin(), local.end()) - local.begin();
+
+        if (meshlet.triangleCount == 0 || meshlet.triangleCount > MESHLET_MAX_TRIANGLES || vertexCount > MESHLET_MAX_VERTICES || vertexCount != meshlet.vertexCount) {
+            std::cerr << "Meshlet " << m << " has " << meshlet.triangleCount << " triangles and " << vertexCount << " vertices (" << meshlet.vertexCount << " recorded)" << std::endl;
+            valid = false;
+        }
+
+        const glm::vec3 center(meshlet.sphere);
+        const float tolerance = 1e-4f * std::max(meshlet.sphere.w, 1.0f);
+
+        for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++) {
+            if (glm::length(vertices[triangles[i]].Position - center) > meshlet.sphere.w + tolerance) {
+                std::cerr << "Meshlet " << m << " sphere misses vertex " << triangles[i] << std::endl;
+                valid = false;
+                break;
+            }
+        }
+
+        if (meshlet.coneCutoff >= 1.0f) {
+            continue;
+        }
+
+        // The cone is conservative if the apex is behind every triangle and no normal is further from the axis
+        // than the cutoff allows.
+        const float spread = std::sqrt(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+
+        for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+            glm::vec3 normal = faceNormal(vertices, triangles + t * 3);
+
+            if (normal == glm::vec3(0.0f)) {
+                continue;
+            }
+
+            if (glm::dot(normal, meshlet.coneAxis) < spread - 1e-4f || glm::dot(meshlet.coneApex - vertices[triangles[t * 3]].Position, normal) > tolerance) {
+                std::cerr << "Meshlet " << m << " cone does not bound triangle " << t << std::endl;
+                valid = false;
+                break;
+            }
+        }
+    }
+
+    if (next != clustered.size()) {
+        std::cerr << "Meshlets cover " << next << " of " << clustered.size() << " indices" << std::endl;
+        valid = false;
+    }
+
+    return valid;
+}
+
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& matrix, const Frustum& frustum, const glm::vec3& eye, unsigned int baseInstance, std::vector<DrawElementsCommand>& commands, MeshletCullStats& stats) {
+    const float scale = glm::length(glm::vec3(matrix[0]));
+    const glm::vec3 localEye = glm::vec3(glm::inverse(matrix) * glm::vec4(eye, 1.0f));
+
+    bool open = false;
+
+    for (const Meshlet& meshlet : meshlets) {
+        stats.tested++;
+
+        bool visible = true;
+
+        if (meshlet.coneCutoff < 1.0f && glm::dot(glm::normalize(meshlet.coneApex - localEye), meshlet.coneAxis) >= meshlet.coneCutoff) {
+            stats.backfaceCulled++;
+            visible = false;
+        } else if (!frustum.Intersects(glm::vec3(matrix * glm::vec4(glm::vec3(meshlet.sphere), 1.0f)), meshlet.sphere.w * scale)) {
+            stats.frustumCulled++;
+            visible = false;
+        }
+
+        if (!visible) {
+            open = false;
+            continue;
+        }
+
+        stats.triangles += meshlet.triangleCount;
+
+        if (open) {
+            commands.back().count += meshlet.triangleCount * 3;
+        } else {
+            commands.push_back({ meshlet.triangleCount * 3, 1, meshlet.firstIndex, 0, baseInstance });
+            open = true;
+        }
+    }
+}
\ No newline at end of file
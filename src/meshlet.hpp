@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory_resource>
+#include <vector>
+
+#include "frustum.hpp"
+#include "mesh.hpp"
+
+// Cluster limits, sized to what mesh shading hardware favours so the same clusters would carry over.
+constexpr unsigned int MESHLET_MAX_VERTICES = 64;
+constexpr unsigned int MESHLET_MAX_TRIANGLES = 124;
+// Meshes with fewer triangles than this are left whole, since a handful of clusters saves nothing.
+constexpr unsigned int MESHLET_MIN_TRIANGLES = 1024;
+
+struct MeshletCullStats {
+    unsigned long long tested = 0;
+    unsigned long long frustumCulled = 0;
+    unsigned long long backfaceCulled = 0;
+    unsigned long long triangles = 0;
+};
+
+// Splits a triangle list into meshlets, greedily growing each cluster through triangles that share the most
+// vertices with it. indices is reordered so every cluster's triangles are contiguous; firstIndex is relative
+// to its start. Working buffers come from scratch.
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+// Checks that the clusters respect the limits, tile the clustered list with the same triangles as the source,
+// and that every sphere holds its vertices and every cone its triangles. Problems are reported on std::cerr.
+bool ValidateMeshlets(const std::vector<Meshlet>& meshlets, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& source, const std::vector<unsigned int>& clustered);
+
+// Culls one instance's clusters against a world-space frustum and eye, and appends a command for every run of
+// adjacent survivors so a mesh that is wholly visible still goes out as a single range. Instances are assumed
+// to be uniformly scaled, which keeps the normal cones valid in object space.
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& matrix, const Frustum& frustum, const glm::vec3& eye, unsigned int baseInstance, std::vector<DrawElementsCommand>& commands, MeshletCullStats& stats);
\ No newline at end of file
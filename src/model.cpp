@@ -1,196 +1,1056 @@
 #include "model.hpp"
 
-Model::Model(std::string const& path, std::vector<glm::mat4> matrices, bool gamma) : gammaCorrection(gamma) {
-    this->matrices = matrices;
+namespace {
+    // A mesh as a node places it: which of the scene's meshes, and the node's transform relative to the root.
+    struct PlacedMesh {
+        unsigned int mesh;
+        glm::mat4 transform;
+    };
 
-    loadModel(path);
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex changed; update the import flags to match what it reads");
+
+    // Post-processing for what Vertex reads and nothing more: triangles for the element buffers, normals for
+    // lighting (generated only where the file has none) and the first UV set flipped for GL. Tangents, vertex
+    // colours, bones, animations, lights, cameras and the other UV sets are never read, so they are dropped as
+    // the file is read, and point and line primitives are dropped with them as the index buffers can't hold them.
+    unsigned int importFlags(Assimp::Importer& importer) {
+        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
+            aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS | aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS |
+            aiComponent_LIGHTS | aiComponent_CAMERAS |
+            aiComponent_TEXCOORDSn(1) | aiComponent_TEXCOORDSn(2) | aiComponent_TEXCOORDSn(3) | aiComponent_TEXCOORDSn(4) |
+            aiComponent_TEXCOORDSn(5) | aiComponent_TEXCOORDSn(6) | aiComponent_TEXCOORDSn(7));
+        importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+
+        return aiProcess_RemoveComponent | aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+    }
+
+    // Assimp matrices are row-major.
+    glm::mat4 toGlm(const aiMatrix4x4& matrix) {
+        return glm::transpose(glm::make_mat4(&matrix.a1));
+    }
+
+    // Walks the node graph depth first, children in order, and lists every mesh reference with its node's
+    // accumulated transform. A mesh several nodes reference is listed once per node.
+    std::vector<PlacedMesh> flattenNodes(const aiNode* root) {
+        std::vector<PlacedMesh> placed;
+        std::vector<std::pair<const aiNode*, glm::mat4>> stack { { root, toGlm(root->mTransformation) } };
+
+        while (!stack.empty()) {
+            const auto [node, transform] = stack.back();
+            stack.pop_back();
+
+            for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+                placed.push_back({ node->mMeshes[i], transform });
+            }
+
+            for (unsigned int i = node->mNumChildren; i-- > 0;) {
+                const aiNode* child = node->mChildren[i];
+                stack.emplace_back(child, transform * toGlm(child->mTransformation));
+            }
+        }
+
+        return placed;
+    }
+}
+
+Model::Model(std::string const& path, bool gamma, LodSettings lodSettings, ThreadPool* pool) : gammaCorrection(gamma), lodSettings(lodSettings) {
+    loadModel(path, pool);
+}
+
+Model::Model(std::string const& path, std::vector<glm::mat4> matrices, bool gamma, LodSettings lodSettings, ThreadPool* pool) : gammaCorrection(gamma), lodSettings(lodSettings) {
+    registry.Assign(std::move(matrices));
+
+    loadModel(path, pool);
     loadInstances();
 }
 
-void Model::Draw(Shader& shader) {
+Model::Model(std::string const& path, const LatticeDesc& lattice, bool gamma, LodSettings lodSettings, ThreadPool* pool) : gammaCorrection(gamma), lodSettings(lodSettings) {
+    loadModel(path, pool);
+
+    procedural = std::make_unique<ProceduralLattice>(lattice);
+}
+
+void Model::BakeImpostors(Shader& bakeShader, const ImpostorSettings& settings) {
+    impostors.Bake(meshes, bounds, bakeShader, settings);
+
+    if (instanceBuffer) {
+        impostors.SetInstanceBuffer(instanceBuffer);
+        impostors.SetInstanceIdBuffer(instanceIdBuffer);
+    }
+}
+
+InstanceHandle Model::AddInstance(const glm::mat4& matrix) {
+    if (procedural) {
+        std::cerr << "Procedural models have no stored instances to add to" << std::endl;
+        return InstanceHandle();
+    }
+
+    if (registry.IsReleased()) {
+        std::cerr << "Instance matrices were released after upload; instances can no longer be edited" << std::endl;
+        return InstanceHandle();
+    }
+
+    MemoryScope scope(MemoryCategory::Instances);
+
+    instancesSynced = false;
+    return registry.Add(matrix);
+}
+
+bool Model::RemoveInstance(InstanceHandle handle) {
+    if (!registry.Remove(handle)) {
+        return false;
+    }
+
+    instancesSynced = false;
+    return true;
+}
+
+bool Model::SetInstance(InstanceHandle handle, const glm::mat4& matrix) {
+    if (!registry.Set(handle, matrix)) {
+        return false;
+    }
+
+    instancesSynced = false;
+    return true;
+}
+
+const InstanceRegistry& Model::GetInstances() const {
+    return registry;
+}
+
+size_t Model::ReleaseCpuCopies(bool keepForPicking) {
+    size_t freed = 0;
+
+    for (Mesh& mesh : meshes) {
+        freed += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(unsigned int);
+        mesh.ReleaseCpuCopies();
+    }
+
+    if (procedural || registry.IsReleased() || keepForPicking) {
+        return freed;
+    }
+
+    // Pending edits have to reach the GPU first, and the draws must be able to read every transform from it.
+    flushInstances();
+
+    if (!indirectInstances || !ensureTransformTexture()) {
+        return freed;
+    }
+
+    freed += registry.ReleaseMatrices() + uploadScratch.capacity() * sizeof(glm::mat4);
+    std::vector<glm::mat4>().swap(uploadScratch);
+
+    return freed;
+}
+
+void Model::Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight) {
+    if (procedural) {
+        procedural->Cull(projection * view, bounds);
+        return;
+    }
+
+    MemoryScope scope(MemoryCategory::Culling);
+
+    syncInstances();
+
+    if (lodSelector.Update(view, projection, viewportHeight, lodCount, lodSettings, lodEnabled, impostorsEnabled && impostors.IsBaked())) {
+        uploadPending = true;
+    }
+
+    cullMeshlets(view, projection);
+}
+
+void Model::Update(const std::vector<CameraView>& views, float viewportHeight) {
+    if (views.empty()) {
+        return;
+    }
+
+    if (procedural) {
+        procedural->Cull(views.front().projection * views.front().view, bounds);
+        return;
+    }
+
+    MemoryScope scope(MemoryCategory::Culling);
+
+    syncInstances();
+
+    // A cluster would have to be culled against every view, so multi-view draws full-detail meshes whole.
+    meshletsCulled = false;
+
+    if (lodSelector.Update(views, viewportHeight, lodCount, lodSettings, lodEnabled, impostorsEnabled && impostors.IsBaked())) {
+        uploadPending = true;
+    }
+}
+
+bool Model::Cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, VisibleSet& visible) {
+    if (procedural) {
+        return false;
+    }
+
+    if (!lodSelector.Update(view, projection, viewportHeight, lodCount, lodSettings, lodEnabled, impostorsEnabled && impostors.IsBaked())) {
+        return false;
+    }
+
+    visible = lodSelector.GetResult();
+    return true;
+}
+
+void Model::Draw(Shader& shader, CommandBuffer& commands) {
+    if (procedural) {
+        drawProcedural(shader, commands);
+        return;
+    }
+
+    stats = DrawStats();
+
+    flushInstances();
+    drawVisible(shader, commands, lodSelector.GetResult(), meshletsCulled);
+}
+
+void Model::Draw(Shader& shader, CommandBuffer& commands, const VisibleSet& visible, bool changed) {
+    stats = DrawStats();
+
+    if (changed) {
+        uploadPending = true;
+    }
+
+    drawVisible(shader, commands, visible, false);
+}
+
+void Model::DrawImpostors(Shader& shader, CommandBuffer& commands) {
+    drawImpostors(shader, commands, lodSelector.GetResult());
+}
+
+void Model::DrawImpostors(Shader& shader, CommandBuffer& commands, const VisibleSet& visible) {
+    drawImpostors(shader, commands, visible);
+}
+
+bool Model::DrawDepth(Shader& shader, CommandBuffer& commands, unsigned int count, unsigned int lod) {
+    if (procedural) {
+        return false;
+    }
+
+    flushInstances();
+
+    if (!ensureTransformTexture()) {
+        return false;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    bindTransforms(shader, commands);
+
     for (unsigned int i = 0; i < meshes.size(); i++) {
-        meshes[i].Draw(shader, matrices.size());
+        meshes[i].Draw(commands, count, 0, lod);
     }
+
+    return true;
 }
 
-void Model::loadModel(std::string const& path) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+const std::vector<glm::vec4>& Model::GetInstanceSpheres() const {
+    return lodSelector.GetSpheres();
+}
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+unsigned long long Model::GetInstanceVersion() const {
+    return instanceVersion;
+}
+
+// The ray is taken into the instance's space unnormalized, so distances along it stay in world units.
+// Without the matrices the sphere hit has to do.
+float Model::confirmHit(unsigned int index, const glm::vec3& origin, const glm::vec3& ray, float sphereDistance) const {
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
+
+    if (matrices.empty()) {
+        return sphereDistance;
+    }
+
+    const glm::mat4 inverse = glm::inverse(matrices[index]);
+    const glm::vec3 localOrigin = glm::vec3(inverse * glm::vec4(origin, 1.0f));
+    const glm::vec3 localRay = glm::vec3(inverse * glm::vec4(ray, 0.0f));
+
+    const glm::vec3 t0 = (boxMin - localOrigin) / localRay;
+    const glm::vec3 t1 = (boxMax - localOrigin) / localRay;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+
+    const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    const float exit = std::min(std::min(far.x, far.y), far.z);
+
+    return entry <= exit ? entry : -1.0f;
+}
+
+// Culls the clusters of every full-detail instance, ready for the next Draw. Runs on the CPU against the
+// registry's matrices, so it works whether instances reach the GPU as IDs or as attributes.
+void Model::cullMeshlets(const glm::mat4& view, const glm::mat4& projection) {
+    meshletsCulled = false;
+
+    const VisibleSet& visible = lodSelector.GetResult();
+
+    if (!meshletCulling || visible.ranges.empty() || visible.meshLevels == 0) {
+        return;
+    }
+
+    const InstanceRange& level = visible.ranges[0];
+
+    if (level.count == 0 || level.count > meshletInstanceLimit || registry.IsReleased()) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
+    const Frustum frustum(projection * view);
+    const glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+
+    meshletCommands.resize(meshes.size());
+    meshletStats = MeshletCullStats();
+
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        meshletCommands[i].clear();
+
+        if (meshes[i].meshlets.empty()) {
+            continue;
+        }
+
+        for (unsigned int j = 0; j < level.count; j++) {
+            CullMeshlets(meshes[i].meshlets, matrices[visible.visible[level.first + j]], frustum, eye, level.first + j, meshletCommands[i], meshletStats);
+        }
+    }
+
+    meshletCullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    meshletsCulled = meshletStats.tested > 0;
+}
+
+bool Model::RaycastInstances(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit, float maxDistance) {
+    UpdateBvh();
+
+    const glm::vec3 ray = glm::normalize(direction);
+
+    auto exact = [&](unsigned int index, float sphereDistance) {
+        return confirmHit(index, origin, ray, sphereDistance);
+    };
+
+    float distance = 0.0f;
+    long long index = bvh.Raycast(origin, ray, maxDistance, exact, distance);
+
+    if (index < 0) {
+        return false;
+    }
+
+    hit.instance = registry.HandleAt(static_cast<size_t>(index));
+    hit.distance = distance;
+    hit.point = origin + ray * distance;
+
+    return true;
+}
+
+size_t Model::RaycastInstances(const glm::vec3* origins, const glm::vec3* directions, size_t count, RayHit* hits, float maxDistance) {
+    UpdateBvh();
+
+    std::vector<glm::vec3> rays(count);
+    for (size_t i = 0; i < count; i++) {
+        rays[i] = glm::normalize(directions[i]);
+    }
+
+    auto exact = [&](size_t ray, unsigned int index, float sphereDistance) {
+        return confirmHit(index, origins[ray], rays[ray], sphereDistance);
+    };
+
+    std::vector<long long> indices(count);
+    std::vector<float> distances(count);
+    bvh.RaycastBatch(origins, rays.data(), count, maxDistance, exact, indices.data(), distances.data());
+
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        hits[i] = RayHit();
+
+        if (indices[i] < 0) {
+            continue;
+        }
+
+        hits[i].instance = registry.HandleAt(static_cast<size_t>(indices[i]));
+        hits[i].distance = distances[i];
+        hits[i].point = origins[i] + rays[i] * distances[i];
+        found++;
+    }
+
+    return found;
+}
+
+void Model::QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<InstanceHandle>& result) {
+    UpdateBvh();
+
+    std::vector<unsigned int> indices;
+    bvh.QueryBox(min, max, indices);
+
+    for (unsigned int index : indices) {
+        result.push_back(registry.HandleAt(index));
+    }
+}
+
+void Model::QuerySphere(const glm::vec3& center, float radius, std::vector<InstanceHandle>& result) {
+    UpdateBvh();
+
+    std::vector<unsigned int> indices;
+    bvh.QuerySphere(center, radius, indices);
+
+    for (unsigned int index : indices) {
+        result.push_back(registry.HandleAt(index));
+    }
+}
+
+void Model::UpdateBvh() {
+    // A refit tree this much costlier than when it was built is rebuilt rather than refitted again.
+    constexpr float REBUILD_COST_RATIO = 1.5f;
+
+    if (procedural) {
+        return;
+    }
+
+    MemoryScope scope(MemoryCategory::Culling);
+    syncInstances();
+
+    if (bvhVersion == instanceVersion) {
+        return;
+    }
+
+    const std::vector<glm::vec4>& spheres = lodSelector.GetSpheres();
+
+    if (bvh.GetCount() == spheres.size()) {
+        bvh.Refit(spheres);
+    }
+
+    if (bvh.GetCount() != spheres.size() || bvh.GetStats().cost > bvhBuildCost * REBUILD_COST_RATIO) {
+        bvh.Build(spheres);
+        bvhBuildCost = bvh.GetStats().cost;
+    }
+
+    bvhVersion = instanceVersion;
+}
+
+const BvhStats& Model::GetBvhStats() const {
+    return bvh.GetStats();
+}
+
+void Model::drawVisible(Shader& shader, CommandBuffer& commands, const VisibleSet& visible, bool clustered) {
+    if (indirectInstances != indirectActive && indirectSupported) {
+        uploadPending = true;
+    }
+
+    if (uploadPending) {
+        uploadVisible(commands, visible);
+    }
+
+    const std::vector<InstanceRange>& ranges = visible.ranges;
+
+    // Until the first Update the buffer still holds every instance in its original order.
+    if (ranges.empty()) {
+        const size_t count = registry.GetCount();
+
+        commands.SetUniform(shader, "indirectInstances", false);
+        bindMaterials(commands);
+
+        for (unsigned int i : drawOrder) {
+            useMaterial(shader, commands, meshes[i]);
+            meshes[i].Draw(commands, count);
+
+            stats.drawCalls++;
+            stats.triangles += static_cast<unsigned long long>(meshes[i].TriangleCount()) * count;
+            stats.vertices += static_cast<unsigned long long>(meshes[i].TriangleCount()) * 3 * count;
+        }
+
+        stats.instances = static_cast<unsigned int>(count);
+        stats.fullDetailTriangles = stats.triangles;
+        return;
+    }
+
+    const unsigned int meshLevels = std::min(visible.meshLevels, static_cast<unsigned int>(ranges.size()));
+
+    bindInstanceSource(shader, commands);
+    bindMaterials(commands);
+
+    for (unsigned int i : drawOrder) {
+        for (unsigned int lod = 0; lod < meshLevels; lod++) {
+            if (ranges[lod].count == 0) {
+                continue;
+            }
+
+            if (lod == 0 && clustered && !meshes[i].meshlets.empty()) {
+                unsigned long long triangles = 0;
+                for (const DrawElementsCommand& command : meshletCommands[i]) {
+                    triangles += command.count / 3;
+                }
+
+                if (!meshletCommands[i].empty()) {
+                    useMaterial(shader, commands, meshes[i]);
+                }
+
+                meshes[i].Draw(commands, meshletCommands[i]);
+
+                stats.drawCalls += meshletCommands[i].empty() ? 0 : 1;
+                stats.triangles += triangles;
+                stats.vertices += triangles * 3;
+                continue;
+            }
+
+            useMaterial(shader, commands, meshes[i]);
+            meshes[i].Draw(commands, ranges[lod].count, ranges[lod].first, lod);
+
+            stats.drawCalls++;
+            stats.triangles += static_cast<unsigned long long>(meshes[i].TriangleCount(lod)) * ranges[lod].count;
+            stats.vertices += static_cast<unsigned long long>(meshes[i].TriangleCount(lod)) * 3 * ranges[lod].count;
+        }
+    }
+
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        stats.fullDetailTriangles += static_cast<unsigned long long>(meshes[i].TriangleCount()) * visible.visible.size();
+    }
+
+    stats.instances = static_cast<unsigned int>(visible.visible.size());
+
+    if (clustered) {
+        stats.meshlets = static_cast<unsigned int>(meshletStats.tested - meshletStats.frustumCulled - meshletStats.backfaceCulled);
+        stats.meshletsCulled = static_cast<unsigned int>(meshletStats.frustumCulled + meshletStats.backfaceCulled);
+        stats.meshletCullMs = meshletCullMs;
+    }
+}
+
+void Model::drawImpostors(Shader& shader, CommandBuffer& commands, const VisibleSet& visible) {
+    const std::vector<InstanceRange>& ranges = visible.ranges;
+    const unsigned int level = visible.meshLevels;
+
+    if (level >= ranges.size() || ranges[level].count == 0) {
+        return;
+    }
+
+    if (uploadPending) {
+        uploadVisible(commands, visible);
+    }
+
+    bindInstanceSource(shader, commands);
+    impostors.Draw(shader, commands, ranges[level].first, ranges[level].count);
+
+    stats.drawCalls++;
+    stats.impostors = ranges[level].count;
+    stats.vertices += ranges[level].count;
+}
+
+void Model::drawProcedural(Shader& shader, CommandBuffer& commands) {
+    stats = DrawStats();
+
+    procedural->Bind(commands);
+    bindMaterials(commands);
+
+    for (const InstanceRange& range : procedural->GetRanges()) {
+        commands.SetUniform(shader, "instanceBase", static_cast<int>(range.first));
+
+        for (unsigned int i : drawOrder) {
+            useMaterial(shader, commands, meshes[i]);
+            meshes[i].Draw(commands, range.count);
+
+            stats.drawCalls++;
+            stats.triangles += static_cast<unsigned long long>(meshes[i].TriangleCount()) * range.count;
+            stats.vertices += static_cast<unsigned long long>(meshes[i].TriangleCount()) * 3 * range.count;
+        }
+
+        stats.instances += range.count;
+    }
+
+    stats.fullDetailTriangles = stats.triangles;
+}
+
+// Binds every material array once for the pass and forgets the current material, since another model may have
+// set the uniforms since.
+void Model::bindMaterials(CommandBuffer& commands) {
+    stats.textureBinds += materials.Bind(commands);
+    currentMaterial = std::numeric_limits<unsigned int>::max();
+}
+
+// Selects the mesh's material unless the previous draw already did, and counts what binding its textures
+// for this draw would have cost.
+void Model::useMaterial(Shader& shader, CommandBuffer& commands, const Mesh& mesh) {
+    if (mesh.material != currentMaterial) {
+        materials.Use(shader, commands, mesh.material);
+        currentMaterial = mesh.material;
+        stats.materialSwitches++;
+    }
+
+    stats.unbatchedTextureBinds += materials.Get(mesh.material).textureCount;
+}
+
+void Model::loadModel(std::string const& path, ThreadPool* pool) {
+    MemoryScope scope(MemoryCategory::Geometry);
+
+    ImportedScene scene;
+
+    if (!ImportScene(path, lodSettings, pool, scene)) {
         return;
     }
 
     directory = path.substr(0, path.find_last_of('/'));
-    processNode(scene->mRootNode, scene);
+
+    auto uploadStart = std::chrono::steady_clock::now();
+
+    // Only materials some mesh uses are added, in the order meshes first use them, so unused ones cost no
+    // texture memory.
+    std::vector<int> materialIds(scene.materials.size(), -1);
+
+    meshes.reserve(scene.geometry.size());
+
+    for (size_t i = 0; i < scene.geometry.size(); i++) {
+        int& material = materialIds[scene.materialIndices[i]];
+
+        if (material < 0) {
+            material = static_cast<int>(materials.Add(scene.materials[scene.materialIndices[i]], directory));
+        }
+
+        MeshGeometry& geometry = scene.geometry[i];
+        meshes.emplace_back(std::move(geometry.vertices), std::move(geometry.indices), static_cast<unsigned int>(material), std::move(geometry.lods), std::move(geometry.meshlets));
+    }
+
+    materials.Upload();
+
+    importStats = scene.stats;
+    importStats.uploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+
+    drawOrder.resize(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        drawOrder[i] = i;
+    }
+
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [&](unsigned int lhs, unsigned int rhs) {
+        return meshes[lhs].material < meshes[rhs].material;
+    });
+
+    size_t vertexCount = 0;
+    for (const Mesh& mesh : meshes) {
+        vertexCount += mesh.vertices.size();
+    }
+
+    ScratchArena arena;
+    std::pmr::vector<glm::vec3> points(&arena);
+    points.reserve(vertexCount);
+
+    for (const Mesh& mesh : meshes) {
+        for (const Vertex& vertex : mesh.vertices) {
+            points.push_back(vertex.Position);
+        }
+
+        lodCount = std::max(lodCount, static_cast<unsigned int>(mesh.lods.size()));
+    }
+
+    bounds = ComputeBoundingSphere(points);
+
+    if (!points.empty()) {
+        boxMin = points[0];
+        boxMax = points[0];
+
+        for (const glm::vec3& point : points) {
+            boxMin = glm::min(boxMin, point);
+            boxMax = glm::max(boxMax, point);
+        }
+    }
 }
 
-void Model::processNode(aiNode *node, const aiScene *scene) {
-    for(unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+bool Model::ImportScene(const std::string& path, const LodSettings& lodSettings, ThreadPool* pool, ImportedScene& scene) {
+    auto readStart = std::chrono::steady_clock::now();
+
+    Assimp::Importer importer;
+    const aiScene* source = importer.ReadFile(path, importFlags(importer));
+
+    if (!source || source->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !source->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return false;
     }
 
-    for(unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+    auto buildStart = std::chrono::steady_clock::now();
+
+    // Only the first texture of each kind is packed.
+    const aiTextureType types[MATERIAL_SLOT_COUNT] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT };
+
+    scene.materials.resize(source->mNumMaterials);
+
+    for (unsigned int i = 0; i < source->mNumMaterials; i++) {
+        for (unsigned int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+            if (source->mMaterials[i]->GetTextureCount(types[slot]) > 0) {
+                aiString texture;
+                source->mMaterials[i]->GetTexture(types[slot], 0, &texture);
+                scene.materials[i][slot] = texture.C_Str();
+            }
+        }
     }
+
+    const std::vector<PlacedMesh> placed = flattenNodes(source->mRootNode);
+
+    scene.geometry.resize(placed.size());
+    scene.materialIndices.resize(placed.size());
+
+    // Meshes vary too much in size for fixed chunks to balance, so each one is its own chunk. Each thread
+    // keeps one arena for every mesh it converts, which BuildGeometry rewinds as it goes, so after the first
+    // few meshes the arenas stop growing.
+    std::vector<std::unique_ptr<ScratchArena>> arenas(pool ? pool->GetThreadCount() : 1);
+
+    for (std::unique_ptr<ScratchArena>& arena : arenas) {
+        arena = std::make_unique<ScratchArena>();
+    }
+
+    auto build = [&](size_t begin, size_t end, unsigned int thread) {
+        MemoryScope scope(MemoryCategory::Geometry);
+        ScratchArena& arena = *arenas[thread];
+
+        for (size_t i = begin; i < end; i++) {
+            const aiMesh& mesh = *source->mMeshes[placed[i].mesh];
+
+            scene.geometry[i] = BuildGeometry(mesh, lodSettings, arena, placed[i].transform);
+            scene.materialIndices[i] = mesh.mMaterialIndex;
+            arena.Reset();
+        }
+    };
+
+    if (pool) {
+        pool->ParallelFor(placed.size(), 1, build);
+    } else {
+        build(0, placed.size(), 0);
+    }
+
+    auto buildEnd = std::chrono::steady_clock::now();
+
+    scene.stats.meshes = static_cast<unsigned int>(placed.size());
+    scene.stats.threads = pool ? pool->GetThreadCount() : 1;
+    scene.stats.readMs = std::chrono::duration<float, std::milli>(buildStart - readStart).count();
+    scene.stats.buildMs = std::chrono::duration<float, std::milli>(buildEnd - buildStart).count();
+
+    return true;
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
+MeshGeometry Model::BuildGeometry(const aiMesh& mesh, const LodSettings& lodSettings, ScratchArena& arena, const glm::mat4& transform) {
+    // Normals go through the inverse transpose so non-uniform scales keep them perpendicular. A mirroring
+    // transform turns the triangles inside out, so their winding is flipped back.
+    const bool transformed = transform != glm::mat4(1.0f);
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
 
-    for(unsigned int i = 0; i < mesh->mNumVertices; i++) {
+    vertices.reserve(mesh.mNumVertices);
+    indices.reserve(static_cast<size_t>(mesh.mNumFaces) * 3);
+
+    for(unsigned int i = 0; i < mesh.mNumVertices; i++) {
         Vertex vertex;
         glm::vec3 vector;
 
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
+        vector.x = mesh.mVertices[i].x;
+        vector.y = mesh.mVertices[i].y;
+        vector.z = mesh.mVertices[i].z;
         vertex.Position = vector;
 
-        if (mesh->HasNormals()) {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
+        if (mesh.HasNormals()) {
+            vector.x = mesh.mNormals[i].x;
+            vector.y = mesh.mNormals[i].y;
+            vector.z = mesh.mNormals[i].z;
             vertex.Normal = vector;
         }
 
-        if(mesh->mTextureCoords[0]) {
+        if(mesh.mTextureCoords[0]) {
             glm::vec2 vec;
 
-            vec.x = mesh->mTextureCoords[0][i].x; 
-            vec.y = mesh->mTextureCoords[0][i].y;
+            vec.x = mesh.mTextureCoords[0][i].x; 
+            vec.y = mesh.mTextureCoords[0][i].y;
             vertex.TexCoords = vec;
         } else {
             vertex.TexCoords = glm::vec2(0.0f, 0.0f);
         }
 
+        if (transformed) {
+            vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+            vertex.Normal = mesh.HasNormals() ? glm::normalize(normalMatrix * vertex.Normal) : vertex.Normal;
+        }
+
         vertices.push_back(vertex);
     }
 
-    for(unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
+    for(unsigned int i = 0; i < mesh.mNumFaces; i++) {
+        const aiFace& face = mesh.mFaces[i];
         for(unsigned int j = 0; j < face.mNumIndices; j++) {
             indices.push_back(face.mIndices[j]);        
         }
     }
 
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
+    if (mirrored) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::swap(indices[i + 1], indices[i + 2]);
+        }
+    }
+
+    // Each level is simplified from the previous one and appended to the same element buffer.
+    // The full-detail triangles of heavy meshes are regrouped into clusters before the levels are built from them.
+    std::vector<Meshlet> meshlets;
 
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    if (indices.size() / 3 >= MESHLET_MIN_TRIANGLES) {
+        meshlets = BuildMeshlets(vertices, indices, &arena);
+        arena.Reset();
+    }
 
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+    // Room for every level if each one meets its target, so appending them rarely moves the buffer. Each
+    // level's working buffers are rewound as soon as its indices have been appended.
+    std::vector<MeshLod> lods { { 0, static_cast<unsigned int>(indices.size()) } };
+    lods.reserve(lodSettings.levels + 1);
 
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+    if (lodSettings.reduction < 1.0f) {
+        indices.reserve(static_cast<size_t>(indices.size() / (1.0f - lodSettings.reduction)) + 3);
+    }
 
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-    textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
-    return Mesh(vertices, indices, textures);
-}
+    for (unsigned int level = 0; level < lodSettings.levels; level++) {
+        const MeshLod previous = lods.back();
+        const std::span<const unsigned int> source(indices.data() + previous.firstIndex, previous.indexCount);
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
-    std::vector<Texture> textures;
+        size_t target = static_cast<size_t>(source.size() * lodSettings.reduction) / 3 * 3;
+        bool reduced = false;
 
-    for(unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-        bool skip = false;
+        {
+            std::pmr::vector<unsigned int> simplified = SimplifyMesh(vertices, source, target, lodSettings.maxError, nullptr, &arena);
 
-        for(unsigned int j = 0; j < textures_loaded.size(); j++) {
-            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
+            if (!simplified.empty() && simplified.size() < source.size()) {
+                lods.push_back({ static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(simplified.size()) });
+                indices.insert(indices.end(), simplified.begin(), simplified.end());
+                reduced = true;
             }
         }
 
-        if(!skip) {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
+        arena.Reset();
+
+        if (!reduced) {
+            break;
         }
     }
 
-    return textures;
+    return { std::move(vertices), std::move(indices), std::move(lods), std::move(meshlets) };
 }
 
 void Model::loadInstances() {
-    GLuint instanceBuffer;
-    GL_CHECK(glGenBuffers(1, &instanceBuffer));
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
+
+    reserveInstances(matrices.size());
+
+    if (!matrices.empty()) {
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer));
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data()));
+    }
+
+    registry.ClearDirty();
+
+    MemoryScope scope(MemoryCategory::Culling);
+    lodSelector.SetInstances(matrices, bounds);
+}
+
+// Grows the instance buffers to hold count instances, doubling so a stream of adds reallocates rarely.
+// Returns true when the buffers were reallocated and their contents have to be uploaded again.
+bool Model::reserveInstances(size_t count) {
+    if (instanceBuffer && count <= instanceCapacity) {
+        return false;
+    }
+
+    const size_t capacity = std::max<size_t>({ count, instanceCapacity * 2, 1 });
+
+    if (!instanceBuffer) {
+        GL_CHECK(glGenBuffers(1, &instanceBuffer));
+        GL_CHECK(glGenBuffers(1, &instanceIdBuffer));
+
+        for (unsigned int i = 0; i < meshes.size(); i++) {
+            meshes[i].SetInstanceBuffer(instanceBuffer);
+            meshes[i].SetInstanceIdBuffer(instanceIdBuffer);
+        }
+
+        if (impostors.IsBaked()) {
+            impostors.SetInstanceBuffer(instanceBuffer);
+            impostors.SetInstanceIdBuffer(instanceIdBuffer);
+        }
+    }
+
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), &matrices.data()[0], GL_STATIC_DRAW));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, instanceBuffer, MemoryCategory::Instances, capacity * sizeof(glm::mat4));
 
-    for (unsigned int i = 0; i < meshes.size(); i++) {
-        unsigned int VAO = meshes[i].VAO;
-        GL_CHECK(glBindVertexArray(VAO));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceIdBuffer));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(unsigned int), nullptr, GL_STREAM_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, instanceIdBuffer, MemoryCategory::Instances, capacity * sizeof(unsigned int));
+
+    if (transformBuffer) {
+        GLint maxTexels = 0;
+        GL_CHECK(glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels));
 
-        GL_CHECK(glEnableVertexAttribArray(3));
-        GL_CHECK(glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(0)));
-        GL_CHECK(glEnableVertexAttribArray(4));
-        GL_CHECK(glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(sizeof(glm::vec4))));
-        GL_CHECK(glEnableVertexAttribArray(5));
-        GL_CHECK(glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(2 * sizeof(glm::vec4))));
-        GL_CHECK(glEnableVertexAttribArray(6));
-        GL_CHECK(glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(3 * sizeof(glm::vec4))));
+        if (capacity * 4 > static_cast<size_t>(maxTexels)) {
+            std::cerr << "Buffer textures hold " << maxTexels << " texels, too few for " << capacity << " instances; using instanced attributes" << std::endl;
 
-        GL_CHECK(glVertexAttribDivisor(3, 1));
-        GL_CHECK(glVertexAttribDivisor(4, 1));
-        GL_CHECK(glVertexAttribDivisor(5, 1));
-        GL_CHECK(glVertexAttribDivisor(6, 1));
+            ReleaseGpuMemory(GpuResource::Buffer, transformBuffer);
 
-        GL_CHECK(glBindVertexArray(0));
+            GL_CHECK(glDeleteTextures(1, &transformTexture));
+            GL_CHECK(glDeleteBuffers(1, &transformBuffer));
+            transformTexture = 0;
+            transformBuffer = 0;
+            indirectSupported = false;
+        } else {
+            GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer));
+            GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW));
+            GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+            TrackGpuMemory(GpuResource::Buffer, transformBuffer, MemoryCategory::Instances, capacity * sizeof(glm::mat4));
+        }
     }
+
+    instanceCapacity = capacity;
+
+    return true;
 }
 
-unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma) {
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
+// Mirrors registry changes into the LOD selector. Only the dirty spans are re-bounded.
+void Model::syncInstances() {
+    if (instancesSynced || !registry.IsDirty()) {
+        return;
+    }
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1) {
-            format = GL_RED;
-        } else if (nrComponents == 3) {
-            format = GL_RGB;
-        } else if (nrComponents == 4) {
-            format = GL_RGBA;
+    lodSelector.Resize(matrices.size());
+
+    for (const InstanceRange& range : registry.GetDirtyRanges()) {
+        for (unsigned int i = range.first; i < range.first + range.count; i++) {
+            lodSelector.SetInstance(i, matrices[i], bounds);
         }
+    }
 
-        GL_CHECK(glBindTexture(GL_TEXTURE_2D, textureID));
-        GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data));
-        GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+    instancesSynced = true;
+    uploadPending = true;
+    instanceVersion++;
+}
 
-        if (format == GL_RGBA) {
-            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));	
-            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        } else {
-            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+void Model::flushInstances() {
+    if (!registry.IsDirty()) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    syncInstances();
+
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
+    // Before the first Update the attribute buffer still holds every instance in dense order.
+    const bool attributesDense = lodSelector.GetRanges().empty();
+
+    if (reserveInstances(matrices.size())) {
+        if (!matrices.empty() && transformBuffer) {
+            GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer));
+            GL_CHECK(glBufferSubData(GL_TEXTURE_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data()));
+            GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+            stats.uploadBytes += matrices.size() * sizeof(glm::mat4);
+        }
+
+        if (!matrices.empty() && attributesDense) {
+            GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer));
+            GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data()));
+            stats.uploadBytes += matrices.size() * sizeof(glm::mat4);
         }
+    } else {
+        if (transformBuffer) {
+            stats.uploadBytes += registry.Upload(GL_TEXTURE_BUFFER, transformBuffer);
+        }
+
+        if (attributesDense) {
+            stats.uploadBytes += registry.Upload(GL_ARRAY_BUFFER, instanceBuffer);
+        }
+    }
+
+    registry.ClearDirty();
+    instancesSynced = false;
 
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    stats.uploadMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Model::uploadVisible(CommandBuffer& commands, const VisibleSet& visibleSet) {
+    auto start = std::chrono::steady_clock::now();
+
+    const std::vector<unsigned int>& visible = visibleSet.visible;
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
 
-        stbi_image_free(data);
+    // Released matrices leave the resident transforms as the only copy, whatever indirectInstances says.
+    if ((indirectInstances || registry.IsReleased()) && ensureTransformTexture()) {
+        if (!visible.empty()) {
+            commands.BindBuffer(GL_ARRAY_BUFFER, instanceIdBuffer);
+            commands.BufferSubData(GL_ARRAY_BUFFER, 0, visible.size() * sizeof(unsigned int), visible.data());
+        }
+
+        stats.uploadBytes += visible.size() * sizeof(unsigned int);
+        indirectActive = true;
     } else {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        uploadScratch.resize(visible.size());
+        for (size_t i = 0; i < visible.size(); i++) {
+            uploadScratch[i] = matrices[visible[i]];
+        }
+
+        if (!uploadScratch.empty()) {
+            commands.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            commands.BufferSubData(GL_ARRAY_BUFFER, 0, uploadScratch.size() * sizeof(glm::mat4), uploadScratch.data());
+        }
+
+        stats.uploadBytes += uploadScratch.size() * sizeof(glm::mat4);
+        indirectActive = false;
+    }
+
+    stats.uploadMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    uploadPending = false;
+}
+
+bool Model::ensureTransformTexture() {
+    if (transformTexture) {
+        return true;
+    }
+
+    if (!indirectSupported) {
+        return false;
+    }
+
+    GLint maxTexels = 0;
+    GL_CHECK(glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels));
+
+    // Four RGBA32F texels per matrix, sized to the instance buffers' capacity so adds don't reallocate it.
+    if (instanceCapacity * 4 > static_cast<size_t>(maxTexels)) {
+        std::cerr << "Buffer textures hold " << maxTexels << " texels, too few for " << instanceCapacity << " instances; using instanced attributes" << std::endl;
+        indirectSupported = false;
+        return false;
     }
 
-    return textureID;
+    const std::vector<glm::mat4>& matrices = registry.GetMatrices();
+
+    GL_CHECK(glGenBuffers(1, &transformBuffer));
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer));
+    GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, transformBuffer, MemoryCategory::Instances, instanceCapacity * sizeof(glm::mat4));
+
+    if (!matrices.empty()) {
+        GL_CHECK(glBufferSubData(GL_TEXTURE_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data()));
+    }
+
+    GL_CHECK(glGenTextures(1, &transformTexture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, transformTexture));
+    GL_CHECK(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer));
+    GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, 0));
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+
+    return true;
+}
+
+void Model::bindInstanceSource(Shader& shader, CommandBuffer& commands) {
+    commands.SetUniform(shader, "indirectInstances", indirectActive);
+
+    if (indirectActive) {
+        bindTransforms(shader, commands);
+    }
+}
+
+void Model::bindTransforms(Shader& shader, CommandBuffer& commands) {
+    commands.BindTexture(TRANSFORM_TEXTURE_UNIT, GL_TEXTURE_BUFFER, transformTexture);
+    commands.SetUniform(shader, "transforms", static_cast<int>(TRANSFORM_TEXTURE_UNIT));
 }
\ No newline at end of file
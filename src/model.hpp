@@ -2,12 +2,12 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-
-#include <stb_image/stb_image.h>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/config.h>
 
 #include <string>
 #include <fstream>
@@ -15,30 +15,233 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <limits>
 
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "arena.hpp"
+#include "bvh.hpp"
+#include "commands.hpp"
+#include "lod.hpp"
+#include "impostor.hpp"
+#include "lattice.hpp"
+#include "material.hpp"
+#include "memory.hpp"
+#include "meshlet.hpp"
+#include "parallel.hpp"
+#include "registry.hpp"
+#include "simplify.hpp"
 #include "utility.hpp"
 
-unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+// Texture unit holding the resident transform buffer, kept clear of the material array units.
+constexpr GLuint TRANSFORM_TEXTURE_UNIT = 15;
+
+struct DrawStats {
+    unsigned int drawCalls = 0;
+    unsigned int instances = 0;
+    unsigned int impostors = 0;
+    unsigned long long triangles = 0;
+    // Upper bound on vertex shader invocations: indices submitted for meshes plus one per impostor sprite.
+    unsigned long long vertices = 0;
+    // What the same visible instances would have cost at full detail.
+    unsigned long long fullDetailTriangles = 0;
+    // Instance data sent to the GPU this frame and the CPU time spent gathering and uploading it.
+    size_t uploadBytes = 0;
+    float uploadMs = 0.0f;
+    // Full-detail clusters drawn and dropped by meshlet culling, and the CPU time it took.
+    unsigned int meshlets = 0;
+    unsigned int meshletsCulled = 0;
+    float meshletCullMs = 0.0f;
+    // Texture binds issued, what binding every mesh's textures before each of its draws would have issued, and
+    // how often the material uniforms changed between draws.
+    unsigned int textureBinds = 0;
+    unsigned int unbatchedTextureBinds = 0;
+    unsigned int materialSwitches = 0;
+};
+
+// An imported mesh before upload: its buffers with every level of detail appended, and the clusters of the
+// full-detail level.
+struct MeshGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+};
+
+// Where the time importing a model went: assimp reading and post-processing the file, converting the meshes
+// on the pool's threads, and creating their buffers on the GL thread.
+struct ImportStats {
+    unsigned int meshes = 0;
+    unsigned int threads = 1;
+    float readMs = 0.0f;
+    float buildMs = 0.0f;
+    float uploadMs = 0.0f;
+};
+
+// A scene file converted up to the point where GL takes over: one entry per mesh the node graph places, in
+// depth-first node order with the node's transform applied, and the texture paths of every assimp material.
+struct ImportedScene {
+    std::vector<MeshGeometry> geometry;
+    std::vector<unsigned int> materialIndices;
+    std::vector<std::array<std::string, MATERIAL_SLOT_COUNT>> materials;
+    ImportStats stats;
+};
+
+struct RayHit {
+    InstanceHandle instance;
+    glm::vec3 point = glm::vec3(0.0f);
+    float distance = 0.0f;
+};
 
 class Model {
 public:
-    std::vector<Texture> textures_loaded;
+    MaterialLibrary materials;
     std::vector<Mesh> meshes;
-    std::vector<glm::mat4> matrices;
 
     std::string directory;
     bool gammaCorrection;
 
-    Model(std::string const& path, std::vector<glm::mat4> matrices, bool gamma = false);
+    LodSettings lodSettings;
+    bool lodEnabled = true;
+    bool impostorsEnabled = true;
+    // Keep every transform resident in a buffer texture and upload only visible instance IDs each frame.
+    // Falls back to uploading matrices as instanced attributes when buffer textures are too small.
+    bool indirectInstances = true;
+    // Cull the clusters of full-detail instances against the camera and draw only the surviving index ranges.
+    // Each instance is culled on its own, so past meshletInstanceLimit the level is drawn whole instead.
+    bool meshletCulling = true;
+    unsigned int meshletInstanceLimit = 256;
+    BoundingSphere bounds;
+    DrawStats stats;
+    ImportStats importStats;
+
+    // Geometry only; instances are supplied by whoever shares the meshes, such as a Scene. Given a pool, the
+    // meshes are converted on its threads.
+    explicit Model(std::string const& path, bool gamma = false, LodSettings lodSettings = LodSettings(), ThreadPool* pool = nullptr);
+
+    // Takes the matrices by value so a caller that moves them in hands its buffer straight to the registry.
+    Model(std::string const& path, std::vector<glm::mat4> matrices, bool gamma = false, LodSettings lodSettings = LodSettings(), ThreadPool* pool = nullptr);
+
+    // Procedural source: transforms are decoded from gl_InstanceID by lattice.vert and nothing is stored per instance.
+    Model(std::string const& path, const LatticeDesc& lattice, bool gamma = false, LodSettings lodSettings = LodSettings(), ThreadPool* pool = nullptr);
+
+    void BakeImpostors(Shader& bakeShader, const ImpostorSettings& settings = ImpostorSettings());
 
-    void Draw(Shader& shader);
+    // Matrix-sourced models only. Changes are flushed by the next Draw, which uploads just the modified spans;
+    // call Update in between so culling and LOD selection see them.
+    InstanceHandle AddInstance(const glm::mat4& matrix);
+    bool RemoveInstance(InstanceHandle handle);
+    bool SetInstance(InstanceHandle handle, const glm::mat4& matrix);
+    const InstanceRegistry& GetInstances() const;
+
+    // Frees CPU copies of what the GPU already holds and returns the bytes freed. Mesh vertices and indices
+    // always go. The instance matrices go too unless exact picking still reads them, or there is no resident
+    // transform buffer to draw from; once they are gone instances can't be edited, rays are answered by
+    // bounding sphere and meshlet culling is skipped, leaving full-detail instances drawn whole.
+    size_t ReleaseCpuCopies(bool keepForPicking = false);
+
+    void Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+    // Culls against the union of several views for multi-view rendering. A procedural lattice only culls
+    // against the first.
+    void Update(const std::vector<CameraView>& views, float viewportHeight);
+    // Record into commands; culling state and uploads the draws depend on are settled while recording.
+    void Draw(Shader& shader, CommandBuffer& commands);
+    void DrawImpostors(Shader& shader, CommandBuffer& commands);
+
+    // Split form of Update and Draw for a render thread. Cull touches no GL state and copies the visible set
+    // out only when it changed, returning whether it did. Draw then takes that copy, or the last one it was
+    // given when changed is false. Instances must not be edited while a render thread is drawing.
+    bool Cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, VisibleSet& visible);
+    void Draw(Shader& shader, CommandBuffer& commands, const VisibleSet& visible, bool changed);
+    void DrawImpostors(Shader& shader, CommandBuffer& commands, const VisibleSet& visible);
+
+    // Depth-only draw of count instances for shadow casting. The shader picks its own instances out of a buffer
+    // texture, so the visible set's upload is left alone. Returns false when there is no resident transform
+    // buffer to read from, as for procedural lattices.
+    bool DrawDepth(Shader& shader, CommandBuffer& commands, unsigned int count, unsigned int lod);
+
+    // Instance bounds as of the last Update, and a counter bumped whenever instances were added, removed or
+    // moved, for anything caching work derived from them.
+    const std::vector<glm::vec4>& GetInstanceSpheres() const;
+    unsigned long long GetInstanceVersion() const;
+
+    // Spatial queries over the stored instances, answered from a BVH over their bounding spheres. The ray is
+    // tested exactly against each candidate's oriented mesh bounds; the volume queries go by bounding sphere.
+    // Procedural lattices store no instances and never report anything.
+    bool RaycastInstances(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit, float maxDistance = std::numeric_limits<float>::max());
+    // The same for count rays at once, several times faster per ray when the BVH doesn't fit in cache. hits[i]
+    // answers ray i and keeps an invalid handle where it missed. Returns the number of rays that hit.
+    size_t RaycastInstances(const glm::vec3* origins, const glm::vec3* directions, size_t count, RayHit* hits, float maxDistance = std::numeric_limits<float>::max());
+    void QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<InstanceHandle>& result);
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<InstanceHandle>& result);
+
+    // Brings the BVH up to date: built on first use, refitted when instances moved and rebuilt when the count
+    // changed or refitting has degraded it too far. The queries call this themselves; calling it first makes
+    // them read-only, so several threads can then query at once until instances are edited again.
+    void UpdateBvh();
+    const BvhStats& GetBvhStats() const;
+
+    // CPU half of importing one mesh: reads its vertices and faces, moved by transform, clusters heavy meshes
+    // and simplifies the LOD chain. Touches no GL state, so it can run and be measured without a context, and
+    // several meshes can be built at once with an arena each.
+    static MeshGeometry BuildGeometry(const aiMesh& mesh, const LodSettings& lodSettings, ScratchArena& arena, const glm::mat4& transform = glm::mat4(1.0f));
+
+    // CPU half of importing a whole file: reads it with only the post-processing the vertex format needs,
+    // flattens the node graph and builds every placed mesh, spread over pool when one is given. Returns false,
+    // having reported why, when the file can't be read.
+    static bool ImportScene(const std::string& path, const LodSettings& lodSettings, ThreadPool* pool, ImportedScene& scene);
 
 private:
-    void loadModel(std::string const& path);
-    void processNode(aiNode *node, const aiScene *scene);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+    LodSelector lodSelector;
+    ImpostorAtlas impostors;
+    std::unique_ptr<ProceduralLattice> procedural;
+    InstanceRegistry registry;
+    unsigned int instanceBuffer = 0;
+    unsigned int instanceIdBuffer = 0;
+    unsigned int transformBuffer = 0;
+    unsigned int transformTexture = 0;
+    size_t instanceCapacity = 0;
+    unsigned int lodCount = 1;
+    bool uploadPending = false;
+    bool instancesSynced = false;
+    bool indirectActive = false;
+    bool indirectSupported = true;
+    unsigned long long instanceVersion = 0;
+    InstanceBvh bvh;
+    unsigned long long bvhVersion = ~0ull;
+    float bvhBuildCost = 0.0f;
+    // Object-space box around every mesh, for the exact ray test.
+    glm::vec3 boxMin = glm::vec3(0.0f);
+    glm::vec3 boxMax = glm::vec3(0.0f);
+    std::vector<glm::mat4> uploadScratch;
+    // Per mesh, the ranges that survived meshlet culling in the last single-view Update.
+    std::vector<std::vector<DrawElementsCommand>> meshletCommands;
+    MeshletCullStats meshletStats;
+    float meshletCullMs = 0.0f;
+    bool meshletsCulled = false;
+    // Mesh indices sorted by material, then mesh, so each material's uniforms are set once per pass.
+    std::vector<unsigned int> drawOrder;
+    unsigned int currentMaterial = 0;
+
+    void loadModel(std::string const& path, ThreadPool* pool);
     void loadInstances();
+    bool reserveInstances(size_t count);
+    void syncInstances();
+    void flushInstances();
+    void cullMeshlets(const glm::mat4& view, const glm::mat4& projection);
+    // Distance at which a ray that entered an instance's sphere at sphereDistance meets its oriented mesh
+    // bounds, or a negative value if it misses them.
+    float confirmHit(unsigned int index, const glm::vec3& origin, const glm::vec3& ray, float sphereDistance) const;
+    void drawVisible(Shader& shader, CommandBuffer& commands, const VisibleSet& visible, bool clustered);
+    void drawImpostors(Shader& shader, CommandBuffer& commands, const VisibleSet& visible);
+    void bindMaterials(CommandBuffer& commands);
+    void useMaterial(Shader& shader, CommandBuffer& commands, const Mesh& mesh);
+    void uploadVisible(CommandBuffer& commands, const VisibleSet& visibleSet);
+    bool ensureTransformTexture();
+    void bindInstanceSource(Shader& shader, CommandBuffer& commands);
+    void bindTransforms(Shader& shader, CommandBuffer& commands);
+    void drawProcedural(Shader& shader, CommandBuffer& commands);
 };
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "multiview.hpp"
+
+#include <algorithm>
+
+namespace {
+    // std140 layout of the Views block.
+    struct ViewsBlock {
+        glm::mat4 views[MAX_VIEWS];
+        glm::mat4 projections[MAX_VIEWS];
+        glm::ivec4 viewCount;
+    };
+}
+
+ViewBlock::ViewBlock() {
+    GL_CHECK(glGenBuffers(1, &m_UBO));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_UBO));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewsBlock), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+
+    TrackGpuMemory(GpuResource::Buffer, m_UBO, MemoryCategory::RenderTargets, sizeof(ViewsBlock));
+}
+
+ViewBlock::~ViewBlock() {
+    ReleaseGpuMemory(GpuResource::Buffer, m_UBO);
+    GL_CHECK(glDeleteBuffers(1, &m_UBO));
+}
+
+void ViewBlock::Set(const std::vector<CameraView>& views) {
+    ViewsBlock block = {};
+
+    unsigned int count = static_cast<unsigned int>(std::min(views.size(), static_cast<size_t>(MAX_VIEWS)));
+
+    for (unsigned int i = 0; i < count; i++) {
+        block.views[i] = views[i].view;
+        block.projections[i] = views[i].projection;
+    }
+
+    block.viewCount = glm::ivec4(static_cast<int>(count), 0, 0, 0);
+
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_UBO));
+    GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewsBlock), &block));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+
+    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, MULTIVIEW_UBO_BINDING, m_UBO));
+}
+
+LayeredTarget::~LayeredTarget() {
+    release();
+}
+
+bool LayeredTarget::Resize(int width, int height, unsigned int layers) {
+    if (m_LayeredFBO && width == m_Width && height == m_Height && layers == m_Layers) {
+        return true;
+    }
+
+    release();
+
+    m_Width = width;
+    m_Height = height;
+    m_Layers = layers;
+
+    GL_CHECK(glGenTextures(1, &m_Color));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, m_Color));
+    GL_CHECK(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    TrackGpuMemory(GpuResource::Texture, m_Color, MemoryCategory::RenderTargets, static_cast<size_t>(width) * height * layers * 4);
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    GL_CHECK(glGenTextures(1, &m_Depth));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, m_Depth));
+    GL_CHECK(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr));
+    TrackGpuMemory(GpuResource::Texture, m_Depth, MemoryCategory::RenderTargets, static_cast<size_t>(width) * height * layers * 4);
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    // Whole arrays attached, so the geometry shader's gl_Layer picks where each triangle lands.
+    GL_CHECK(glGenFramebuffers(1, &m_LayeredFBO));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_LayeredFBO));
+    GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_Color, 0));
+    GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_Depth, 0));
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    GL_CHECK(glGenFramebuffers(1, &m_LayerFBO));
+    attachLayer(0);
+
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    if (!complete) {
+        std::cerr << "Layered render target is incomplete at " << width << "x" << height << "x" << layers << std::endl;
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+void LayeredTarget::Bind() const {
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_LayeredFBO));
+    GL_CHECK(glViewport(0, 0, m_Width, m_Height));
+}
+
+void LayeredTarget::BindLayer(unsigned int layer) const {
+    attachLayer(layer);
+    GL_CHECK(glViewport(0, 0, m_Width, m_Height));
+}
+
+void LayeredTarget::BlitLayer(unsigned int layer, int x, int y, int width, int height) const {
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_LayerFBO));
+    GL_CHECK(glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_Color, 0, layer));
+    GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    GL_CHECK(glBlitFramebuffer(0, 0, m_Width, m_Height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+int LayeredTarget::GetWidth() const {
+    return m_Width;
+}
+
+int LayeredTarget::GetHeight() const {
+    return m_Height;
+}
+
+unsigned int LayeredTarget::GetLayers() const {
+    return m_Layers;
+}
+
+void LayeredTarget::attachLayer(unsigned int layer) const {
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_LayerFBO));
+    GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_Color, 0, layer));
+    GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_Depth, 0, layer));
+}
+
+void LayeredTarget::release() {
+    if (m_LayeredFBO) {
+        ReleaseGpuMemory(GpuResource::Texture, m_Color);
+        ReleaseGpuMemory(GpuResource::Texture, m_Depth);
+
+        GL_CHECK(glDeleteFramebuffers(1, &m_LayeredFBO));
+        GL_CHECK(glDeleteFramebuffers(1, &m_LayerFBO));
+        GL_CHECK(glDeleteTextures(1, &m_Color));
+        GL_CHECK(glDeleteTextures(1, &m_Depth));
+    }
+
+    m_LayeredFBO = 0;
+    m_LayerFBO = 0;
+    m_Color = 0;
+    m_Depth = 0;
+    m_Layers = 0;
+}
\ No newline at end of file
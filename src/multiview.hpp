@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "frustum.hpp"
+#include "memory.hpp"
+#include "utility.hpp"
+
+constexpr GLuint MULTIVIEW_UBO_BINDING = 1;
+
+// Must match the array sizes of the Views block in the multi-view geometry shaders.
+constexpr unsigned int MAX_VIEWS = 4;
+
+// Per-view matrices for the multi-view geometry shaders, which replicate every triangle once per view and
+// route each copy to its own layer.
+class ViewBlock {
+public:
+    ViewBlock();
+    ~ViewBlock();
+
+    ViewBlock(const ViewBlock&) = delete;
+    ViewBlock& operator=(const ViewBlock&) = delete;
+
+    // Uploads up to MAX_VIEWS views and binds the block.
+    void Set(const std::vector<CameraView>& views);
+
+private:
+    GLuint m_UBO = 0;
+};
+
+// Color and depth texture arrays with one layer per view. Bind attaches every layer at once for layered
+// rendering; BindLayer attaches just one for drawing the views as separate passes.
+class LayeredTarget {
+public:
+    LayeredTarget() = default;
+    ~LayeredTarget();
+
+    LayeredTarget(const LayeredTarget&) = delete;
+    LayeredTarget& operator=(const LayeredTarget&) = delete;
+
+    // Reallocates only when the size or layer count changed. Returns false if a framebuffer is incomplete.
+    bool Resize(int width, int height, unsigned int layers);
+
+    void Bind() const;
+    void BindLayer(unsigned int layer) const;
+
+    // Copies one layer into a rectangle of the default framebuffer and leaves the default framebuffer bound.
+    void BlitLayer(unsigned int layer, int x, int y, int width, int height) const;
+
+    int GetWidth() const;
+    int GetHeight() const;
+    unsigned int GetLayers() const;
+
+private:
+    GLuint m_LayeredFBO = 0;
+    GLuint m_LayerFBO = 0;
+    GLuint m_Color = 0;
+    GLuint m_Depth = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+    unsigned int m_Layers = 0;
+
+    void attachLayer(unsigned int layer) const;
+    void release();
+};
\ No newline at end of file
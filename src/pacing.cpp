@@ -0,0 +1,141 @@
+#include "pacing.hpp"
+
+#include <algorithm>
+#include <thread>
+
+FramePacer::FramePacer(const PacingSettings& settings) : m_Settings(settings) {
+    m_Settings.maxFramesInFlight = std::max(m_Settings.maxFramesInFlight, 1u);
+    m_Frames.resize(m_Settings.maxFramesInFlight);
+
+    for (InFlight& frame : m_Frames) {
+        GL_CHECK(glGenQueries(1, &frame.query));
+    }
+
+    glfwSwapInterval(m_Settings.swapInterval);
+
+    m_LastBegin = Clock::now();
+}
+
+FramePacer::~FramePacer() {
+    for (InFlight& frame : m_Frames) {
+        if (frame.fence) {
+            GL_CHECK(glDeleteSync(frame.fence));
+        }
+
+        GL_CHECK(glDeleteQueries(1, &frame.query));
+    }
+}
+
+void FramePacer::BeginFrame() {
+    m_Stats.fenceWaitMs = 0.0f;
+    m_Stats.limiterSleepMs = 0.0f;
+
+    InFlight& frame = m_Frames[m_Next];
+
+    if (frame.fence) {
+        auto waitStart = Clock::now();
+
+        while (true) {
+            GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+                break;
+            }
+
+            if (result == GL_WAIT_FAILED) {
+                std::cerr << "Waiting on a frame fence failed" << std::endl;
+                break;
+            }
+        }
+
+        m_Stats.fenceWaitMs = std::chrono::duration<float, std::milli>(Clock::now() - waitStart).count();
+        retire(frame);
+    }
+
+    if (m_Settings.frameLimit > 0.0f) {
+        auto target = m_LastBegin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / m_Settings.frameLimit));
+        auto now = Clock::now();
+
+        if (now < target) {
+            std::this_thread::sleep_until(target);
+            m_Stats.limiterSleepMs = std::chrono::duration<float, std::milli>(Clock::now() - now).count();
+        }
+    }
+
+    m_LastBegin = Clock::now();
+}
+
+void FramePacer::EndFrame(Clock::time_point inputTime) {
+    InFlight& frame = m_Frames[m_Next];
+
+    // The GPU clock as of submission, compared later with a timestamp written once the GPU reaches this point.
+    GL_CHECK(glGetInteger64v(GL_TIMESTAMP, &frame.submitTime));
+    GL_CHECK(glQueryCounter(frame.query, GL_TIMESTAMP));
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_Stats.inputToSubmitMs = std::chrono::duration<float, std::milli>(Clock::now() - inputTime).count();
+    m_Next = (m_Next + 1) % m_Frames.size();
+
+    // Retire anything that already finished so the GPU latency doesn't wait for the slot to come round again.
+    m_Stats.framesInFlight = 0;
+
+    for (InFlight& pending : m_Frames) {
+        if (!pending.fence) {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(pending.fence, 0, 0);
+
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            retire(pending);
+        } else {
+            m_Stats.framesInFlight++;
+        }
+    }
+}
+
+const PacingSettings& FramePacer::GetSettings() const {
+    return m_Settings;
+}
+
+const PacingStats& FramePacer::GetStats() const {
+    return m_Stats;
+}
+
+void FramePacer::retire(InFlight& frame) {
+    GLuint64 completeTime = 0;
+    GL_CHECK(glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &completeTime));
+
+    m_Stats.submitToGpuMs = static_cast<float>(static_cast<GLint64>(completeTime) - frame.submitTime) / 1.0e6f;
+
+    GL_CHECK(glDeleteSync(frame.fence));
+    frame.fence = nullptr;
+}
+
+FrameClock::FrameClock(float smoothing, float maxDelta) : m_Smoothing(smoothing), m_MaxDelta(maxDelta) {
+}
+
+float FrameClock::Tick() {
+    auto now = std::chrono::steady_clock::now();
+    m_Raw = std::chrono::duration<float>(now - m_Last).count();
+    m_Last = now;
+
+    float clamped = std::min(m_Raw, m_MaxDelta);
+
+    if (m_First) {
+        m_Smoothed = clamped;
+        m_First = false;
+    } else {
+        m_Smoothed = m_Smoothed * m_Smoothing + clamped * (1.0f - m_Smoothing);
+    }
+
+    return m_Smoothed;
+}
+
+float FrameClock::GetRawDelta() const {
+    return m_Raw;
+}
+
+float FrameClock::GetSmoothedDelta() const {
+    return m_Smoothed;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <vector>
+
+#include "utility.hpp"
+
+struct PacingSettings {
+    // Passed to glfwSwapInterval: 0 presents immediately, 1 waits for vsync.
+    int swapInterval = 1;
+    // Frames the CPU may run ahead of the GPU before BeginFrame blocks on the oldest one's fence.
+    unsigned int maxFramesInFlight = 2;
+    // Frames per second the loop is held to by sleeping. 0 leaves the rate to vsync and the GPU.
+    float frameLimit = 0.0f;
+};
+
+struct PacingStats {
+    // Time BeginFrame spent blocked on a fence and sleeping in the frame limiter.
+    float fenceWaitMs = 0.0f;
+    float limiterSleepMs = 0.0f;
+    // From input being sampled to the frame's commands being submitted, and from submission until the GPU
+    // finished them. The GPU figure lags behind and belongs to the most recently retired frame.
+    float inputToSubmitMs = 0.0f;
+    float submitToGpuMs = 0.0f;
+    unsigned int framesInFlight = 0;
+};
+
+// Bounds how far the CPU runs ahead of the GPU. Every frame ends with a fence and a GPU timestamp, and a
+// new frame only starts once the frame maxFramesInFlight back has retired. Needs a current GL context.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FramePacer(const PacingSettings& settings = PacingSettings());
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void BeginFrame();
+    // Call after swapping buffers, with the time the frame's input was sampled.
+    void EndFrame(Clock::time_point inputTime);
+
+    const PacingSettings& GetSettings() const;
+    const PacingStats& GetStats() const;
+
+private:
+    struct InFlight {
+        GLsync fence = nullptr;
+        GLuint query = 0;
+        GLint64 submitTime = 0;
+    };
+
+    PacingSettings m_Settings;
+    PacingStats m_Stats;
+    std::vector<InFlight> m_Frames;
+    unsigned int m_Next = 0;
+    Clock::time_point m_LastBegin;
+
+    void retire(InFlight& frame);
+};
+
+// Wall-clock delta time with spikes clamped and an exponential moving average on top, so one long frame
+// doesn't throw the camera across the lattice.
+class FrameClock {
+public:
+    // smoothing is the weight kept from the previous average each tick; 0 disables smoothing.
+    explicit FrameClock(float smoothing = 0.8f, float maxDelta = 0.1f);
+
+    // Returns the smoothed delta in seconds.
+    float Tick();
+
+    float GetRawDelta() const;
+    float GetSmoothedDelta() const;
+
+private:
+    float m_Smoothing;
+    float m_MaxDelta;
+    float m_Raw = 0.0f;
+    float m_Smoothed = 0.0f;
+    std::chrono::steady_clock::time_point m_Last = std::chrono::steady_clock::now();
+    bool m_First = true;
+};
\ No newline at end of file
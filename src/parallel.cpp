@@ -0,0 +1,101 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int workers) {
+    m_Workers.reserve(workers);
+
+    for (unsigned int i = 0; i < workers; i++) {
+        m_Workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+
+    m_Wake.notify_all();
+
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    ParallelFor(count, grain, [&body](size_t begin, size_t end, unsigned int) {
+        body(begin, end);
+    });
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, unsigned int)>& body) {
+    grain = std::max<size_t>(grain, 1);
+
+    if (m_Workers.empty() || count <= grain) {
+        if (count > 0) {
+            body(0, count, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Body = &body;
+        m_Count = count;
+        m_Grain = grain;
+        m_Next = 0;
+        m_Busy = static_cast<unsigned int>(m_Workers.size());
+        m_Generation++;
+    }
+
+    m_Wake.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Done.wait(lock, [this] { return m_Busy == 0; });
+    m_Body = nullptr;
+}
+
+unsigned int ThreadPool::GetThreadCount() const {
+    return static_cast<unsigned int>(m_Workers.size()) + 1;
+}
+
+void ThreadPool::workerLoop(unsigned int thread) {
+    unsigned long long seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [&] { return m_Stop || m_Generation != seen; });
+
+            if (m_Stop) {
+                return;
+            }
+
+            seen = m_Generation;
+        }
+
+        runChunks(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Busy == 0) {
+                m_Done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runChunks(unsigned int thread) {
+    while (true) {
+        size_t begin = m_Next.fetch_add(m_Grain);
+
+        if (begin >= m_Count) {
+            return;
+        }
+
+        (*m_Body)(begin, std::min(begin + m_Grain, m_Count), thread);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data-parallel loops. The calling thread takes part in every loop, so a
+// pool of N workers runs N + 1 chunks at once.
+class ThreadPool {
+public:
+    // Defaults to one worker per hardware thread besides the caller's.
+    explicit ThreadPool(unsigned int workers = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs body(begin, end) over [0, count) in chunks of grain items and returns once every chunk is done.
+    // Small loops run inline on the caller.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+    // Same, also passing the index of the thread running the chunk, 0 for the caller and below GetThreadCount()
+    // for the rest, so each thread can keep its own scratch.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, unsigned int)>& body);
+
+    unsigned int GetThreadCount() const;
+
+private:
+    std::vector<std::thread> m_Workers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+
+    const std::function<void(size_t, size_t, unsigned int)>* m_Body = nullptr;
+    size_t m_Count = 0;
+    size_t m_Grain = 1;
+    std::atomic<size_t> m_Next = 0;
+    unsigned int m_Busy = 0;
+    unsigned long long m_Generation = 0;
+    bool m_Stop = false;
+
+    void workerLoop(unsigned int thread);
+    void runChunks(unsigned int thread);
+};
\ No newline at end of file
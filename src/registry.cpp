@@ -0,0 +1,247 @@
+#include "registry.hpp"
+
+#include <algorithm>
+
+void InstanceRegistry::Reserve(size_t count) {
+    m_Matrices.reserve(count);
+    m_DenseToSlot.reserve(count);
+    m_Slots.reserve(count);
+    m_DirtyFlags.reserve(count);
+}
+
+void InstanceRegistry::Assign(std::vector<glm::mat4>&& matrices) {
+    for (Slot& slot : m_Slots) {
+        if (slot.dense != InstanceHandle::INVALID) {
+            slot.dense = InstanceHandle::INVALID;
+            slot.generation++;
+        }
+    }
+
+    m_Matrices = std::move(matrices);
+    m_Released = false;
+
+    const unsigned int count = static_cast<unsigned int>(m_Matrices.size());
+
+    m_Slots.resize(std::max<size_t>(m_Slots.size(), count));
+    m_DenseToSlot.resize(count);
+    m_FreeSlots.clear();
+
+    for (unsigned int i = 0; i < count; i++) {
+        m_DenseToSlot[i] = i;
+        m_Slots[i].dense = i;
+    }
+
+    for (unsigned int slot = static_cast<unsigned int>(m_Slots.size()); slot > count; slot--) {
+        m_FreeSlots.push_back(slot - 1);
+    }
+
+    // Marked in bulk rather than through markDirty, which would grow the index list one push at a time.
+    m_DirtyFlags.assign(count, 1);
+    m_DirtyIndices.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        m_DirtyIndices[i] = i;
+    }
+
+    m_DirtyRanges.clear();
+    m_RangesStale = true;
+    m_Changed = true;
+}
+
+InstanceHandle InstanceRegistry::Add(const glm::mat4& matrix) {
+    if (m_Released) {
+        return InstanceHandle();
+    }
+
+    unsigned int slot;
+
+    if (!m_FreeSlots.empty()) {
+        slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    } else {
+        slot = static_cast<unsigned int>(m_Slots.size());
+        m_Slots.push_back(Slot());
+    }
+
+    unsigned int dense = static_cast<unsigned int>(m_Matrices.size());
+
+    m_Matrices.push_back(matrix);
+    m_DenseToSlot.push_back(slot);
+    m_DirtyFlags.push_back(0);
+    m_Slots[slot].dense = dense;
+
+    markDirty(dense);
+
+    return { slot, m_Slots[slot].generation };
+}
+
+bool InstanceRegistry::Remove(InstanceHandle handle) {
+    if (m_Released || !Contains(handle)) {
+        return false;
+    }
+
+    Slot& removed = m_Slots[handle.slot];
+    unsigned int dense = removed.dense;
+    unsigned int last = static_cast<unsigned int>(m_Matrices.size() - 1);
+
+    if (dense != last) {
+        m_Matrices[dense] = m_Matrices[last];
+        m_DenseToSlot[dense] = m_DenseToSlot[last];
+        m_Slots[m_DenseToSlot[dense]].dense = dense;
+
+        markDirty(dense);
+    }
+
+    m_Matrices.pop_back();
+    m_DenseToSlot.pop_back();
+    m_DirtyFlags.pop_back();
+
+    removed.dense = InstanceHandle::INVALID;
+    removed.generation++;
+    m_FreeSlots.push_back(handle.slot);
+
+    // Shrinking needs no upload, but anyone mirroring the array still has to notice the new count.
+    m_Changed = true;
+
+    return true;
+}
+
+bool InstanceRegistry::Set(InstanceHandle handle, const glm::mat4& matrix) {
+    if (m_Released || !Contains(handle)) {
+        return false;
+    }
+
+    unsigned int dense = m_Slots[handle.slot].dense;
+    m_Matrices[dense] = matrix;
+    markDirty(dense);
+
+    return true;
+}
+
+bool InstanceRegistry::Contains(InstanceHandle handle) const {
+    return handle.slot < m_Slots.size()
+        && m_Slots[handle.slot].generation == handle.generation
+        && m_Slots[handle.slot].dense != InstanceHandle::INVALID;
+}
+
+InstanceHandle InstanceRegistry::HandleAt(size_t index) const {
+    if (index >= m_DenseToSlot.size()) {
+        return InstanceHandle();
+    }
+
+    unsigned int slot = m_DenseToSlot[index];
+    return { slot, m_Slots[slot].generation };
+}
+
+size_t InstanceRegistry::ReleaseMatrices() {
+    const size_t bytes = m_Matrices.capacity() * sizeof(glm::mat4) + m_DirtyFlags.capacity() + m_DirtyIndices.capacity() * sizeof(unsigned int);
+
+    std::vector<glm::mat4>().swap(m_Matrices);
+    std::vector<unsigned char>().swap(m_DirtyFlags);
+    std::vector<unsigned int>().swap(m_DirtyIndices);
+    m_DirtyRanges.clear();
+    m_RangesStale = false;
+    m_Changed = false;
+    m_Released = true;
+
+    return bytes;
+}
+
+bool InstanceRegistry::IsReleased() const {
+    return m_Released;
+}
+
+const std::vector<glm::mat4>& InstanceRegistry::GetMatrices() const {
+    return m_Matrices;
+}
+
+size_t InstanceRegistry::GetCount() const {
+    return m_DenseToSlot.size();
+}
+
+bool InstanceRegistry::IsDirty() const {
+    return m_Changed;
+}
+
+const std::vector<InstanceRange>& InstanceRegistry::GetDirtyRanges() {
+    if (!m_RangesStale) {
+        return m_DirtyRanges;
+    }
+
+    // Indices past the end belong to instances that were removed after being written.
+    std::sort(m_DirtyIndices.begin(), m_DirtyIndices.end());
+
+    m_DirtyRanges.clear();
+
+    for (unsigned int index : m_DirtyIndices) {
+        if (index >= m_Matrices.size()) {
+            break;
+        }
+
+        if (!m_DirtyRanges.empty()) {
+            InstanceRange& range = m_DirtyRanges.back();
+            unsigned int end = range.first + range.count;
+
+            if (index < end) {
+                continue;
+            }
+
+            if (index - end <= MERGE_GAP) {
+                range.count = index - range.first + 1;
+                continue;
+            }
+        }
+
+        m_DirtyRanges.push_back({ index, 1 });
+    }
+
+    m_RangesStale = false;
+
+    return m_DirtyRanges;
+}
+
+size_t InstanceRegistry::Upload(GLenum target, GLuint buffer) {
+    const std::vector<InstanceRange>& ranges = GetDirtyRanges();
+
+    if (ranges.empty()) {
+        return 0;
+    }
+
+    size_t bytes = 0;
+
+    GL_CHECK(glBindBuffer(target, buffer));
+
+    for (const InstanceRange& range : ranges) {
+        GL_CHECK(glBufferSubData(target, range.first * sizeof(glm::mat4), range.count * sizeof(glm::mat4), &m_Matrices[range.first]));
+        bytes += range.count * sizeof(glm::mat4);
+    }
+
+    GL_CHECK(glBindBuffer(target, 0));
+
+    return bytes;
+}
+
+void InstanceRegistry::ClearDirty() {
+    for (unsigned int index : m_DirtyIndices) {
+        if (index < m_DirtyFlags.size()) {
+            m_DirtyFlags[index] = 0;
+        }
+    }
+
+    m_DirtyIndices.clear();
+    m_DirtyRanges.clear();
+    m_RangesStale = false;
+    m_Changed = false;
+}
+
+void InstanceRegistry::markDirty(unsigned int index) {
+    m_RangesStale = true;
+    m_Changed = true;
+
+    if (m_DirtyFlags[index]) {
+        return;
+    }
+
+    m_DirtyFlags[index] = 1;
+    m_DirtyIndices.push_back(index);
+}
\ No newline at end of file
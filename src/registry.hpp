@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "lod.hpp"
+#include "utility.hpp"
+
+// Stable reference to an instance. The generation changes whenever the slot is freed, so a handle to a
+// removed instance stays invalid even after its slot is reused.
+struct InstanceHandle {
+    static constexpr unsigned int INVALID = 0xFFFFFFFF;
+
+    unsigned int slot = INVALID;
+    unsigned int generation = 0;
+};
+
+// Generational slot map over a dense array of instance matrices. Removal swaps the last instance into
+// the hole so the array uploaded to the GPU never has gaps. Every write marks its dense index dirty, and
+// the dirty indices are coalesced into a few contiguous spans for the once-per-frame upload.
+class InstanceRegistry {
+public:
+    // Dirty spans separated by at most this many clean instances are merged into one upload.
+    static constexpr unsigned int MERGE_GAP = 4;
+
+    void Reserve(size_t count);
+
+    // Replaces every instance at once, taking over the matrices without copying them. Earlier handles go
+    // stale and every instance is marked dirty; the new handles are those of HandleAt(0) onwards.
+    void Assign(std::vector<glm::mat4>&& matrices);
+
+    InstanceHandle Add(const glm::mat4& matrix);
+    bool Remove(InstanceHandle handle);
+    bool Set(InstanceHandle handle, const glm::mat4& matrix);
+
+    bool Contains(InstanceHandle handle) const;
+    // Handle of whichever instance currently sits at a dense index.
+    InstanceHandle HandleAt(size_t index) const;
+
+    // Frees the matrices once the GPU holds them and returns the bytes freed. Handles and HandleAt keep working,
+    // but GetMatrices is empty and Add, Remove and Set fail from then on.
+    size_t ReleaseMatrices();
+    bool IsReleased() const;
+
+    const std::vector<glm::mat4>& GetMatrices() const;
+    size_t GetCount() const;
+
+    // True after any add, remove or write since the last ClearDirty(), including removals that need no upload.
+    bool IsDirty() const;
+    // Sorted, merged spans of dense indices written since the last ClearDirty().
+    const std::vector<InstanceRange>& GetDirtyRanges();
+    // Writes the dirty spans into a buffer already sized for GetCount() matrices. Returns the bytes uploaded.
+    size_t Upload(GLenum target, GLuint buffer);
+    void ClearDirty();
+
+private:
+    struct Slot {
+        unsigned int dense = InstanceHandle::INVALID;
+        unsigned int generation = 0;
+    };
+
+    std::vector<glm::mat4> m_Matrices;
+    std::vector<unsigned int> m_DenseToSlot;
+    std::vector<Slot> m_Slots;
+    std::vector<unsigned int> m_FreeSlots;
+
+    std::vector<unsigned char> m_DirtyFlags;
+    std::vector<unsigned int> m_DirtyIndices;
+    std::vector<InstanceRange> m_DirtyRanges;
+    bool m_RangesStale = false;
+    bool m_Changed = false;
+    bool m_Released = false;
+
+    void markDirty(unsigned int index);
+};
\ No newline at end of file
@@ -0,0 +1,1375 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+
+namespace {
+    const char FRAME_MAGIC[8] = { 'H', 'I', 'R', 'F', 'R', 'A', 'M', 'E' };
+    constexpr uint32_t FRAME_VERSION = 1;
+
+    // Texture units and uniform buffer bindings past these are assumed unused by the pass.
+    constexpr GLint SAVED_TEXTURE_UNITS = 32;
+    constexpr GLint SAVED_UNIFORM_BINDINGS = 16;
+    constexpr GLint SAVED_ATTRIBUTES = 16;
+    constexpr GLint SAVED_COLOR_ATTACHMENTS = 8;
+    constexpr GLint MAX_TEXTURE_LEVELS = 16;
+
+    const GLenum TEXTURE_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER };
+    const GLenum SAVED_CAPABILITIES[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_PROGRAM_POINT_SIZE, GL_POLYGON_OFFSET_FILL };
+    const GLenum TEXTURE_PARAMETERS[] = {
+        GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T, GL_TEXTURE_WRAP_R,
+        GL_TEXTURE_COMPARE_MODE, GL_TEXTURE_COMPARE_FUNC, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL
+    };
+
+    struct SavedAttribute {
+        GLuint index;
+        GLint size;
+        GLenum type;
+        GLint normalized;
+        GLint integer;
+        GLint stride;
+        GLuint buffer;
+        size_t offset;
+        GLuint divisor;
+    };
+
+    struct SavedVertexArray {
+        GLuint id;
+        GLuint elementBuffer;
+        std::vector<SavedAttribute> attributes;
+    };
+
+    struct SavedAttachment {
+        GLenum attachment;
+        GLenum objectType;
+        GLuint object;
+        GLint level;
+        GLint layer;
+        GLint layered;
+    };
+
+    // Pixel transfer format a texture is read back and re-uploaded in.
+    struct PixelFormat {
+        GLenum format;
+        GLenum type;
+        size_t bytesPerTexel;
+    };
+
+    enum class UniformKind : uint32_t {
+        Float,
+        Int,
+        Unsigned
+    };
+
+    struct UniformLayout {
+        UniformKind kind;
+        unsigned int words;
+    };
+
+    class Writer {
+    public:
+        void U32(uint32_t value) {
+            Bytes(&value, sizeof(value));
+        }
+
+        void I32(int32_t value) {
+            Bytes(&value, sizeof(value));
+        }
+
+        void Bytes(const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            m_Bytes.insert(m_Bytes.end(), bytes, bytes + size);
+        }
+
+        void Blob(const std::vector<unsigned char>& bytes) {
+            U32(static_cast<uint32_t>(bytes.size()));
+            Bytes(bytes.data(), bytes.size());
+        }
+
+        void String(const std::string& text) {
+            U32(static_cast<uint32_t>(text.size()));
+            Bytes(text.data(), text.size());
+        }
+
+        const std::vector<unsigned char>& Get() const {
+            return m_Bytes;
+        }
+
+    private:
+        std::vector<unsigned char> m_Bytes;
+    };
+
+    // Reads fail soft: past the end every read returns zeroes and Ok turns false, so loaders check once at the end
+    // of each object rather than after every field.
+    class Reader {
+    public:
+        explicit Reader(const std::vector<unsigned char>& bytes) : m_Bytes(bytes) {}
+
+        uint32_t U32() {
+            uint32_t value = 0;
+            Bytes(&value, sizeof(value));
+            return value;
+        }
+
+        int32_t I32() {
+            int32_t value = 0;
+            Bytes(&value, sizeof(value));
+            return value;
+        }
+
+        bool Bytes(void* data, size_t size) {
+            if (!m_Ok || size > m_Bytes.size() - m_Offset) {
+                m_Ok = false;
+                std::memset(data, 0, size);
+                return false;
+            }
+
+            std::memcpy(data, m_Bytes.data() + m_Offset, size);
+            m_Offset += size;
+            return true;
+        }
+
+        std::vector<unsigned char> Blob() {
+            const uint32_t size = U32();
+
+            if (!m_Ok || size > m_Bytes.size() - m_Offset) {
+                m_Ok = false;
+                return {};
+            }
+
+            std::vector<unsigned char> bytes(m_Bytes.begin() + m_Offset, m_Bytes.begin() + m_Offset + size);
+            m_Offset += size;
+            return bytes;
+        }
+
+        std::string String() {
+            const std::vector<unsigned char> bytes = Blob();
+            return std::string(bytes.begin(), bytes.end());
+        }
+
+        bool Ok() const {
+            return m_Ok;
+        }
+
+    private:
+        const std::vector<unsigned char>& m_Bytes;
+        size_t m_Offset = 0;
+        bool m_Ok = true;
+    };
+
+    GLenum textureBinding(GLenum target) {
+        switch (target) {
+        case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+        case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+        case GL_TEXTURE_BUFFER: return GL_TEXTURE_BINDING_BUFFER;
+        default: return GL_TEXTURE_BINDING_2D;
+        }
+    }
+
+    PixelFormat pixelFormat(GLint internalFormat) {
+        switch (internalFormat) {
+        case GL_DEPTH_COMPONENT:
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32:
+        case GL_DEPTH_COMPONENT32F:
+            return { GL_DEPTH_COMPONENT, GL_FLOAT, 4 };
+        case GL_DEPTH_STENCIL:
+        case GL_DEPTH24_STENCIL8:
+            return { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4 };
+        case GL_DEPTH32F_STENCIL8:
+            return { GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8 };
+        case GL_R16F:
+        case GL_RG16F:
+        case GL_RGB16F:
+        case GL_RGBA16F:
+        case GL_R32F:
+        case GL_RG32F:
+        case GL_RGB32F:
+        case GL_RGBA32F:
+        case GL_R11F_G11F_B10F:
+            return { GL_RGBA, GL_FLOAT, 4 * sizeof(float) };
+        case GL_R8UI:
+        case GL_R16UI:
+        case GL_R32UI:
+        case GL_RG32UI:
+        case GL_RGBA32UI:
+            return { GL_RGBA_INTEGER, GL_UNSIGNED_INT, 4 * sizeof(GLuint) };
+        default:
+            return { GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+        }
+    }
+
+    bool uniformLayout(GLenum type, UniformLayout& layout) {
+        switch (type) {
+        case GL_FLOAT: layout = { UniformKind::Float, 1 }; return true;
+        case GL_FLOAT_VEC2: layout = { UniformKind::Float, 2 }; return true;
+        case GL_FLOAT_VEC3: layout = { UniformKind::Float, 3 }; return true;
+        case GL_FLOAT_VEC4: layout = { UniformKind::Float, 4 }; return true;
+        case GL_FLOAT_MAT2: layout = { UniformKind::Float, 4 }; return true;
+        case GL_FLOAT_MAT3: layout = { UniformKind::Float, 9 }; return true;
+        case GL_FLOAT_MAT4: layout = { UniformKind::Float, 16 }; return true;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2: layout = { UniformKind::Int, 2 }; return true;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3: layout = { UniformKind::Int, 3 }; return true;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4: layout = { UniformKind::Int, 4 }; return true;
+        case GL_UNSIGNED_INT: layout = { UniformKind::Unsigned, 1 }; return true;
+        case GL_UNSIGNED_INT_VEC2: layout = { UniformKind::Unsigned, 2 }; return true;
+        case GL_UNSIGNED_INT_VEC3: layout = { UniformKind::Unsigned, 3 }; return true;
+        case GL_UNSIGNED_INT_VEC4: layout = { UniformKind::Unsigned, 4 }; return true;
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            layout = { UniformKind::Int, 1 };
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void setUniform(GLint location, GLenum type, const std::vector<uint32_t>& words) {
+        UniformLayout layout;
+
+        if (!uniformLayout(type, layout) || words.size() != layout.words) {
+            return;
+        }
+
+        if (layout.kind == UniformKind::Float) {
+            float values[16];
+            std::memcpy(values, words.data(), words.size() * sizeof(float));
+
+            switch (type) {
+            case GL_FLOAT: GL_CHECK(glUniform1fv(location, 1, values)); break;
+            case GL_FLOAT_VEC2: GL_CHECK(glUniform2fv(location, 1, values)); break;
+            case GL_FLOAT_VEC3: GL_CHECK(glUniform3fv(location, 1, values)); break;
+            case GL_FLOAT_VEC4: GL_CHECK(glUniform4fv(location, 1, values)); break;
+            case GL_FLOAT_MAT2: GL_CHECK(glUniformMatrix2fv(location, 1, GL_FALSE, values)); break;
+            case GL_FLOAT_MAT3: GL_CHECK(glUniformMatrix3fv(location, 1, GL_FALSE, values)); break;
+            case GL_FLOAT_MAT4: GL_CHECK(glUniformMatrix4fv(location, 1, GL_FALSE, values)); break;
+            }
+        } else if (layout.kind == UniformKind::Int) {
+            GLint values[4];
+            std::memcpy(values, words.data(), words.size() * sizeof(GLint));
+
+            switch (layout.words) {
+            case 1: GL_CHECK(glUniform1iv(location, 1, values)); break;
+            case 2: GL_CHECK(glUniform2iv(location, 1, values)); break;
+            case 3: GL_CHECK(glUniform3iv(location, 1, values)); break;
+            case 4: GL_CHECK(glUniform4iv(location, 1, values)); break;
+            }
+        } else {
+            GLuint values[4];
+            std::memcpy(values, words.data(), words.size() * sizeof(GLuint));
+
+            switch (layout.words) {
+            case 1: GL_CHECK(glUniform1uiv(location, 1, values)); break;
+            case 2: GL_CHECK(glUniform2uiv(location, 1, values)); break;
+            case 3: GL_CHECK(glUniform3uiv(location, 1, values)); break;
+            case 4: GL_CHECK(glUniform4uiv(location, 1, values)); break;
+            }
+        }
+    }
+
+    // GL 3.3 can't ask a texture for its target, so a texture only seen as an attachment is bound to each
+    // candidate in turn until one doesn't raise GL_INVALID_OPERATION.
+    GLenum probeTextureTarget(GLuint texture) {
+        while (glGetError() != GL_NO_ERROR) {}
+
+        for (GLenum target : { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP }) {
+            GLint previous = 0;
+            glGetIntegerv(textureBinding(target), &previous);
+
+            glBindTexture(target, texture);
+            const bool bound = glGetError() == GL_NO_ERROR;
+            glBindTexture(target, static_cast<GLuint>(previous));
+
+            if (bound) {
+                return target;
+            }
+        }
+
+        return GL_NONE;
+    }
+
+    SavedVertexArray snapshotVertexArray(GLuint vertexArray) {
+        SavedVertexArray saved { vertexArray, 0, {} };
+
+        GL_CHECK(glBindVertexArray(vertexArray));
+
+        GLint elementBuffer = 0;
+        GL_CHECK(glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer));
+        saved.elementBuffer = static_cast<GLuint>(elementBuffer);
+
+        GLint attributeCount = 0;
+        GL_CHECK(glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attributeCount));
+
+        for (GLint i = 0; i < std::min(attributeCount, SAVED_ATTRIBUTES); i++) {
+            GLint enabled = 0;
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled));
+
+            if (!enabled) {
+                continue;
+            }
+
+            SavedAttribute attribute {};
+            GLint type = 0;
+            GLint buffer = 0;
+            GLint divisor = 0;
+            void* pointer = nullptr;
+
+            attribute.index = static_cast<GLuint>(i);
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute.size));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribute.normalized));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attribute.integer));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute.stride));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer));
+            GL_CHECK(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor));
+            GL_CHECK(glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer));
+
+            attribute.type = static_cast<GLenum>(type);
+            attribute.buffer = static_cast<GLuint>(buffer);
+            attribute.divisor = static_cast<GLuint>(divisor);
+            attribute.offset = reinterpret_cast<size_t>(pointer);
+            saved.attributes.push_back(attribute);
+        }
+
+        return saved;
+    }
+
+    std::vector<SavedAttachment> snapshotFramebuffer(GLuint framebuffer) {
+        std::vector<SavedAttachment> attachments;
+
+        GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+
+        GLint colorCount = 0;
+        GL_CHECK(glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &colorCount));
+
+        std::vector<GLenum> points = { GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+        for (GLint i = 0; i < std::min(colorCount, SAVED_COLOR_ATTACHMENTS); i++) {
+            points.push_back(GL_COLOR_ATTACHMENT0 + i);
+        }
+
+        for (GLenum point : points) {
+            GLint objectType = GL_NONE;
+            GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, point, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &objectType));
+
+            if (objectType != GL_TEXTURE && objectType != GL_RENDERBUFFER) {
+                continue;
+            }
+
+            SavedAttachment attachment { point, static_cast<GLenum>(objectType), 0, 0, 0, 0 };
+            GLint object = 0;
+            GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, point, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &object));
+            attachment.object = static_cast<GLuint>(object);
+
+            if (objectType == GL_TEXTURE) {
+                GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, point, GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LEVEL, &attachment.level));
+                GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, point, GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LAYER, &attachment.layer));
+                GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, point, GL_FRAMEBUFFER_ATTACHMENT_LAYERED, &attachment.layered));
+            }
+
+            attachments.push_back(attachment);
+        }
+
+        return attachments;
+    }
+
+    void writeBuffer(Writer& out, GLuint buffer) {
+        GLint size = 0;
+        GLint usage = GL_STATIC_DRAW;
+
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        GL_CHECK(glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size));
+        GL_CHECK(glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage));
+
+        std::vector<unsigned char> bytes(static_cast<size_t>(std::max(size, 0)));
+        if (!bytes.empty()) {
+            GL_CHECK(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, bytes.size(), bytes.data()));
+        }
+
+        out.U32(buffer);
+        out.U32(static_cast<uint32_t>(usage));
+        out.Blob(bytes);
+    }
+
+    bool writeTexture(Writer& out, GLuint texture, GLenum target) {
+        out.U32(texture);
+        out.U32(target);
+
+        GLint previous = 0;
+        GL_CHECK(glGetIntegerv(textureBinding(target), &previous));
+        GL_CHECK(glBindTexture(target, texture));
+
+        if (target == GL_TEXTURE_BUFFER) {
+            // Level parameters of buffer textures arrived with GL 4.3.
+            if (!GLAD_GL_VERSION_4_3) {
+                GL_CHECK(glBindTexture(target, static_cast<GLuint>(previous)));
+                std::cerr << "Saving buffer textures needs GL 4.3 to read back their format" << std::endl;
+                return false;
+            }
+
+            GLint format = 0;
+            GLint buffer = 0;
+            GL_CHECK(glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_INTERNAL_FORMAT, &format));
+            GL_CHECK(glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_BUFFER_DATA_STORE_BINDING, &buffer));
+
+            out.U32(static_cast<uint32_t>(format));
+            out.U32(static_cast<uint32_t>(buffer));
+
+            GL_CHECK(glBindTexture(target, static_cast<GLuint>(previous)));
+            return true;
+        }
+
+        const GLenum levelTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+        const unsigned int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+        GLint internalFormat = GL_RGBA8;
+        GL_CHECK(glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat));
+        const PixelFormat pixels = pixelFormat(internalFormat);
+
+        out.U32(static_cast<uint32_t>(internalFormat));
+        out.U32(pixels.format);
+        out.U32(pixels.type);
+
+        out.U32(static_cast<uint32_t>(std::size(TEXTURE_PARAMETERS)));
+        for (GLenum parameter : TEXTURE_PARAMETERS) {
+            GLint value = 0;
+            GL_CHECK(glGetTexParameteriv(target, parameter, &value));
+
+            out.U32(parameter);
+            out.I32(value);
+        }
+
+        GLint levels = 0;
+        while (levels < MAX_TEXTURE_LEVELS) {
+            GLint width = 0;
+            GL_CHECK(glGetTexLevelParameteriv(levelTarget, levels, GL_TEXTURE_WIDTH, &width));
+
+            if (width == 0) {
+                break;
+            }
+
+            levels++;
+        }
+
+        out.U32(static_cast<uint32_t>(levels));
+
+        for (GLint level = 0; level < levels; level++) {
+            GLint width = 0;
+            GLint height = 0;
+            GLint depth = 0;
+            GL_CHECK(glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width));
+            GL_CHECK(glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height));
+            GL_CHECK(glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_DEPTH, &depth));
+
+            out.I32(width);
+            out.I32(height);
+            out.I32(depth);
+
+            std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * std::max(depth, 1) * pixels.bytesPerTexel);
+
+            for (unsigned int face = 0; face < faces; face++) {
+                GL_CHECK(glGetTexImage(levelTarget + face, level, pixels.format, pixels.type, bytes.data()));
+                out.Blob(bytes);
+            }
+        }
+
+        GL_CHECK(glBindTexture(target, static_cast<GLuint>(previous)));
+        return true;
+    }
+
+    void writeProgram(Writer& out, GLuint program) {
+        out.U32(program);
+
+        GLuint shaders[8];
+        GLsizei shaderCount = 0;
+        GL_CHECK(glGetAttachedShaders(program, 8, &shaderCount, shaders));
+
+        out.U32(static_cast<uint32_t>(shaderCount));
+
+        for (GLsizei i = 0; i < shaderCount; i++) {
+            GLint type = 0;
+            GLint length = 0;
+            GL_CHECK(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+            GL_CHECK(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+
+            std::string source(static_cast<size_t>(std::max(length, 1)), '\0');
+            GLsizei written = 0;
+            GL_CHECK(glGetShaderSource(shaders[i], static_cast<GLsizei>(source.size()), &written, source.data()));
+            source.resize(static_cast<size_t>(written));
+
+            out.U32(static_cast<uint32_t>(type));
+            out.String(source);
+        }
+
+        // Default-block uniforms, one entry per array element, with the values the program holds now.
+        GLint uniformCount = 0;
+        GLint maxLength = 0;
+        GL_CHECK(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount));
+        GL_CHECK(glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+
+        Writer uniforms;
+        uint32_t savedUniforms = 0;
+        std::vector<char> name(static_cast<size_t>(std::max(maxLength, 1)));
+
+        for (GLint i = 0; i < uniformCount; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = GL_NONE;
+            GL_CHECK(glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data()));
+
+            UniformLayout layout;
+            if (!uniformLayout(type, layout)) {
+                continue;
+            }
+
+            std::string base(name.data(), static_cast<size_t>(length));
+            const bool array = base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0;
+
+            if (array) {
+                base.resize(base.size() - 3);
+            }
+
+            for (GLint element = 0; element < size; element++) {
+                const std::string elementName = array ? base + "[" + std::to_string(element) + "]" : base;
+                const GLint location = glGetUniformLocation(program, elementName.c_str());
+
+                if (location == -1) {
+                    continue;
+                }
+
+                uint32_t words[16];
+
+                if (layout.kind == UniformKind::Float) {
+                    float values[16];
+                    GL_CHECK(glGetUniformfv(program, location, values));
+                    std::memcpy(words, values, layout.words * sizeof(float));
+                } else if (layout.kind == UniformKind::Int) {
+                    GLint values[4];
+                    GL_CHECK(glGetUniformiv(program, location, values));
+                    std::memcpy(words, values, layout.words * sizeof(GLint));
+                } else {
+                    GLuint values[4];
+                    GL_CHECK(glGetUniformuiv(program, location, values));
+                    std::memcpy(words, values, layout.words * sizeof(GLuint));
+                }
+
+                uniforms.String(elementName);
+                uniforms.I32(location);
+                uniforms.U32(type);
+                uniforms.U32(layout.words);
+                uniforms.Bytes(words, layout.words * sizeof(uint32_t));
+                savedUniforms++;
+            }
+        }
+
+        out.U32(savedUniforms);
+        out.Bytes(uniforms.Get().data(), uniforms.Get().size());
+
+        GLint blockCount = 0;
+        GL_CHECK(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount));
+
+        out.U32(static_cast<uint32_t>(blockCount));
+
+        for (GLint i = 0; i < blockCount; i++) {
+            GLint length = 0;
+            GLint binding = 0;
+            GL_CHECK(glGetActiveUniformBlockiv(program, static_cast<GLuint>(i), GL_UNIFORM_BLOCK_NAME_LENGTH, &length));
+            GL_CHECK(glGetActiveUniformBlockiv(program, static_cast<GLuint>(i), GL_UNIFORM_BLOCK_BINDING, &binding));
+
+            std::vector<char> blockName(static_cast<size_t>(std::max(length, 1)));
+            GL_CHECK(glGetActiveUniformBlockName(program, static_cast<GLuint>(i), static_cast<GLsizei>(blockName.size()), nullptr, blockName.data()));
+
+            out.String(blockName.data());
+            out.U32(static_cast<uint32_t>(binding));
+        }
+    }
+
+    GLuint compileShader(GLenum type, const std::string& source) {
+        GLuint shader = glCreateShader(type);
+        const char* text = source.c_str();
+
+        GL_CHECK(glShaderSource(shader, 1, &text, nullptr));
+        GL_CHECK(glCompileShader(shader));
+
+        GLint success = 0;
+        GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &success));
+
+        if (!success) {
+            char infoLog[INFOLOG_SIZE];
+            GL_CHECK(glGetShaderInfoLog(shader, INFOLOG_SIZE, nullptr, infoLog));
+            std::cerr << "Recorded shader failed to compile:\n" << infoLog << std::endl;
+
+            GL_CHECK(glDeleteShader(shader));
+            return 0;
+        }
+
+        return shader;
+    }
+
+    GLuint lookup(const std::unordered_map<GLuint, GLuint>& names, GLuint name, bool& complete) {
+        if (name == 0) {
+            return 0;
+        }
+
+        auto found = names.find(name);
+        if (found == names.end()) {
+            complete = false;
+            return 0;
+        }
+
+        return found->second;
+    }
+}
+
+bool SaveFrame(const std::string& path, const CommandBuffer& commands, int width, int height) {
+    // Everything the pass and the prologue refer to, gathered before any of it is written.
+    std::set<GLuint> programs;
+    std::set<GLuint> buffers;
+    std::set<GLuint> vertexArrays;
+    std::set<GLuint> framebuffers;
+    std::set<GLuint> renderbuffers;
+    std::map<GLuint, GLenum> textures;
+
+    CommandBuffer frame = commands;
+    frame.ForEach([&](CommandView& command) {
+        const CommandInfo& info = GetCommandInfo(command.type);
+
+        for (unsigned int i = 0; i < command.argCount; i++) {
+            const GLuint name = command.GetArg(i);
+
+            if (name == 0) {
+                continue;
+            }
+
+            switch (info.args[i]) {
+            case CommandArg::Program: programs.insert(name); break;
+            case CommandArg::VertexArray: vertexArrays.insert(name); break;
+            case CommandArg::Buffer: buffers.insert(name); break;
+            case CommandArg::Framebuffer: framebuffers.insert(name); break;
+            // BindTexture is the only command naming a texture, with its target just before it.
+            case CommandArg::Texture: textures[name] = command.GetArg(i - 1); break;
+            default: break;
+            }
+        }
+    });
+
+    GLint activeTexture = GL_TEXTURE0;
+    GLint currentProgram = 0;
+    GLint currentVertexArray = 0;
+    GLint currentArrayBuffer = 0;
+    GLint currentTextureBuffer = 0;
+    GLint currentIndirectBuffer = 0;
+    GLint currentCopyBuffer = 0;
+    GLint drawFramebuffer = 0;
+    GLint readFramebuffer = 0;
+    GLint packAlignment = 4;
+    GLint viewport[4];
+
+    GL_CHECK(glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture));
+    GL_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram));
+    GL_CHECK(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentVertexArray));
+    GL_CHECK(glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &currentArrayBuffer));
+    // The buffer bound to the GL_TEXTURE_BUFFER binding point, which is queried by the target's own name;
+    // GL_TEXTURE_BINDING_BUFFER would give the bound buffer texture instead.
+    GL_CHECK(glGetIntegerv(GL_TEXTURE_BUFFER, &currentTextureBuffer));
+    GL_CHECK(glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &currentCopyBuffer));
+    GL_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer));
+    GL_CHECK(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer));
+    GL_CHECK(glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment));
+    GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+
+    if (GLAD_GL_VERSION_4_0) {
+        GL_CHECK(glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &currentIndirectBuffer));
+    }
+
+    // The prologue: fixed-function state and bindings as they stand before the pass.
+    CommandBuffer prologue;
+
+    for (GLenum capability : SAVED_CAPABILITIES) {
+        if (glIsEnabled(capability)) {
+            prologue.Enable(capability);
+        } else {
+            prologue.Disable(capability);
+        }
+    }
+
+    GLint depthFunc = GL_LESS;
+    GLint cullMode = GL_BACK;
+    GLint polygonMode[2] = { GL_FILL, GL_FILL };
+    GLint blend[4];
+    glm::vec4 clearColor;
+
+    GL_CHECK(glGetIntegerv(GL_DEPTH_FUNC, &depthFunc));
+    GL_CHECK(glGetIntegerv(GL_CULL_FACE_MODE, &cullMode));
+    GL_CHECK(glGetIntegerv(GL_POLYGON_MODE, polygonMode));
+    GL_CHECK(glGetIntegerv(GL_BLEND_SRC_RGB, &blend[0]));
+    GL_CHECK(glGetIntegerv(GL_BLEND_DST_RGB, &blend[1]));
+    GL_CHECK(glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend[2]));
+    GL_CHECK(glGetIntegerv(GL_BLEND_DST_ALPHA, &blend[3]));
+    GL_CHECK(glGetFloatv(GL_COLOR_CLEAR_VALUE, &clearColor[0]));
+
+    prologue.DepthFunc(depthFunc);
+    prologue.CullFace(cullMode);
+    prologue.PolygonMode(polygonMode[0]);
+    prologue.BlendFunc(blend[0], blend[1], blend[2], blend[3]);
+    prologue.ClearColor(clearColor);
+
+    GLint unitCount = 0;
+    GL_CHECK(glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &unitCount));
+
+    for (GLint unit = 0; unit < std::min(unitCount, SAVED_TEXTURE_UNITS); unit++) {
+        GL_CHECK(glActiveTexture(GL_TEXTURE0 + unit));
+
+        for (GLenum target : TEXTURE_TARGETS) {
+            GLint texture = 0;
+            GL_CHECK(glGetIntegerv(textureBinding(target), &texture));
+
+            if (texture != 0) {
+                textures[static_cast<GLuint>(texture)] = target;
+                prologue.BindTexture(static_cast<GLuint>(unit), target, static_cast<GLuint>(texture));
+            }
+        }
+    }
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+
+    GLint bindingCount = 0;
+    GL_CHECK(glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &bindingCount));
+
+    for (GLint binding = 0; binding < std::min(bindingCount, SAVED_UNIFORM_BINDINGS); binding++) {
+        GLint buffer = 0;
+        GL_CHECK(glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, static_cast<GLuint>(binding), &buffer));
+
+        if (buffer != 0) {
+            buffers.insert(static_cast<GLuint>(buffer));
+            prologue.BindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(binding), static_cast<GLuint>(buffer));
+        }
+    }
+
+    if (currentProgram != 0) {
+        programs.insert(static_cast<GLuint>(currentProgram));
+    }
+
+    for (GLint name : { currentArrayBuffer, currentTextureBuffer, currentIndirectBuffer }) {
+        if (name != 0) {
+            buffers.insert(static_cast<GLuint>(name));
+        }
+    }
+
+    if (currentVertexArray != 0) {
+        vertexArrays.insert(static_cast<GLuint>(currentVertexArray));
+    }
+
+    if (drawFramebuffer != 0) {
+        framebuffers.insert(static_cast<GLuint>(drawFramebuffer));
+    }
+
+    // Objects that the ones already found depend on.
+    std::vector<SavedVertexArray> savedVertexArrays;
+    for (GLuint vertexArray : vertexArrays) {
+        savedVertexArrays.push_back(snapshotVertexArray(vertexArray));
+
+        if (savedVertexArrays.back().elementBuffer) {
+            buffers.insert(savedVertexArrays.back().elementBuffer);
+        }
+
+        for (const SavedAttribute& attribute : savedVertexArrays.back().attributes) {
+            if (attribute.buffer) {
+                buffers.insert(attribute.buffer);
+            }
+        }
+    }
+
+    GL_CHECK(glBindVertexArray(static_cast<GLuint>(currentVertexArray)));
+
+    std::map<GLuint, std::vector<SavedAttachment>> savedFramebuffers;
+    for (GLuint framebuffer : framebuffers) {
+        savedFramebuffers[framebuffer] = snapshotFramebuffer(framebuffer);
+
+        for (const SavedAttachment& attachment : savedFramebuffers[framebuffer]) {
+            if (attachment.objectType == GL_RENDERBUFFER) {
+                renderbuffers.insert(attachment.object);
+            } else if (!textures.count(attachment.object)) {
+                const GLenum target = probeTextureTarget(attachment.object);
+
+                if (target == GL_NONE) {
+                    std::cerr << "Could not tell the target of texture " << attachment.object << " attached to framebuffer " << framebuffer << std::endl;
+                    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer)));
+                    return false;
+                }
+
+                textures[attachment.object] = target;
+            }
+        }
+    }
+
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer)));
+
+    if (GLAD_GL_VERSION_4_3) {
+        for (const auto& [texture, target] : textures) {
+            if (target != GL_TEXTURE_BUFFER) {
+                continue;
+            }
+
+            GLint previous = 0;
+            GLint buffer = 0;
+            GL_CHECK(glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &previous));
+            GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, texture));
+            GL_CHECK(glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_BUFFER_DATA_STORE_BINDING, &buffer));
+            GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, static_cast<GLuint>(previous)));
+
+            if (buffer != 0) {
+                buffers.insert(static_cast<GLuint>(buffer));
+            }
+        }
+    }
+
+    // Attribute pointers are vertex array state that the pass itself re-points, so the prologue puts them back
+    // before every replay rather than only at load.
+    for (const SavedVertexArray& vertexArray : savedVertexArrays) {
+        prologue.BindVertexArray(vertexArray.id);
+
+        for (const SavedAttribute& attribute : vertexArray.attributes) {
+            prologue.BindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+
+            if (attribute.integer) {
+                prologue.VertexAttribIPointer(attribute.index, attribute.size, attribute.type, attribute.stride, attribute.offset);
+            } else {
+                prologue.VertexAttribPointer(attribute.index, attribute.size, attribute.type, static_cast<GLboolean>(attribute.normalized), attribute.stride, attribute.offset);
+            }
+        }
+    }
+
+    prologue.BindVertexArray(static_cast<GLuint>(currentVertexArray));
+    prologue.BindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(currentArrayBuffer));
+    prologue.BindBuffer(GL_TEXTURE_BUFFER, static_cast<GLuint>(currentTextureBuffer));
+
+    if (GLAD_GL_VERSION_4_0) {
+        prologue.BindBuffer(GL_DRAW_INDIRECT_BUFFER, static_cast<GLuint>(currentIndirectBuffer));
+    }
+
+    prologue.UseProgram(static_cast<GLuint>(currentProgram));
+    prologue.BindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+    prologue.Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // Object contents, in the order Load recreates them.
+    Writer out;
+    bool saved = true;
+
+    GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+
+    out.U32(static_cast<uint32_t>(buffers.size()));
+    for (GLuint buffer : buffers) {
+        writeBuffer(out, buffer);
+    }
+
+    GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, static_cast<GLuint>(currentCopyBuffer)));
+
+    out.U32(static_cast<uint32_t>(textures.size()));
+    for (const auto& [texture, target] : textures) {
+        saved = saved && writeTexture(out, texture, target);
+    }
+
+    GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, packAlignment));
+    GL_CHECK(glActiveTexture(static_cast<GLenum>(activeTexture)));
+
+    if (!saved) {
+        return false;
+    }
+
+    GLint currentRenderbuffer = 0;
+    GL_CHECK(glGetIntegerv(GL_RENDERBUFFER_BINDING, &currentRenderbuffer));
+
+    out.U32(static_cast<uint32_t>(renderbuffers.size()));
+    for (GLuint renderbuffer : renderbuffers) {
+        GLint format = 0;
+        GLint renderbufferWidth = 0;
+        GLint renderbufferHeight = 0;
+        GLint samples = 0;
+
+        GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer));
+        GL_CHECK(glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &format));
+        GL_CHECK(glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &renderbufferWidth));
+        GL_CHECK(glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &renderbufferHeight));
+        GL_CHECK(glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &samples));
+
+        out.U32(renderbuffer);
+        out.U32(static_cast<uint32_t>(format));
+        out.I32(renderbufferWidth);
+        out.I32(renderbufferHeight);
+        out.I32(samples);
+    }
+
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, static_cast<GLuint>(currentRenderbuffer)));
+
+    out.U32(static_cast<uint32_t>(savedVertexArrays.size()));
+    for (const SavedVertexArray& vertexArray : savedVertexArrays) {
+        out.U32(vertexArray.id);
+        out.U32(vertexArray.elementBuffer);
+        out.U32(static_cast<uint32_t>(vertexArray.attributes.size()));
+
+        for (const SavedAttribute& attribute : vertexArray.attributes) {
+            out.U32(attribute.index);
+            out.I32(attribute.size);
+            out.U32(attribute.type);
+            out.I32(attribute.normalized);
+            out.I32(attribute.integer);
+            out.I32(attribute.stride);
+            out.U32(attribute.buffer);
+            out.U32(static_cast<uint32_t>(attribute.offset));
+            out.U32(attribute.divisor);
+        }
+    }
+
+    out.U32(static_cast<uint32_t>(savedFramebuffers.size()));
+    for (const auto& [framebuffer, attachments] : savedFramebuffers) {
+        out.U32(framebuffer);
+        out.U32(static_cast<uint32_t>(attachments.size()));
+
+        for (const SavedAttachment& attachment : attachments) {
+            out.U32(attachment.attachment);
+            out.U32(attachment.objectType);
+            out.U32(attachment.object);
+            out.I32(attachment.level);
+            out.I32(attachment.layer);
+            out.I32(attachment.layered);
+        }
+    }
+
+    out.U32(static_cast<uint32_t>(programs.size()));
+    for (GLuint program : programs) {
+        writeProgram(out, program);
+    }
+
+    out.Blob(prologue.GetBytes());
+    out.Blob(commands.GetBytes());
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file) {
+        std::cerr << "Could not open " << path << " to record the frame" << std::endl;
+        return false;
+    }
+
+    file.write(FRAME_MAGIC, sizeof(FRAME_MAGIC));
+    file.write(reinterpret_cast<const char*>(&FRAME_VERSION), sizeof(FRAME_VERSION));
+    file.write(reinterpret_cast<const char*>(&width), sizeof(width));
+    file.write(reinterpret_cast<const char*>(&height), sizeof(height));
+    file.write(reinterpret_cast<const char*>(out.Get().data()), static_cast<std::streamsize>(out.Get().size()));
+
+    if (!file) {
+        std::cerr << "Failed writing the recorded frame to " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+RecordedFrame::~RecordedFrame() {
+    release();
+}
+
+bool RecordedFrame::Load(const std::string& path) {
+    release();
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+        std::cerr << "Could not open recorded frame " << path << std::endl;
+        return false;
+    }
+
+    const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Reader in(bytes);
+
+    char magic[sizeof(FRAME_MAGIC)];
+    in.Bytes(magic, sizeof(magic));
+    const uint32_t version = in.U32();
+
+    if (!in.Ok() || std::memcmp(magic, FRAME_MAGIC, sizeof(magic)) != 0 || version != FRAME_VERSION) {
+        std::cerr << path << " is not a recorded frame this build can read" << std::endl;
+        return false;
+    }
+
+    m_Width = in.I32();
+    m_Height = in.I32();
+
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    const uint32_t bufferCount = in.U32();
+    for (uint32_t i = 0; i < bufferCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+        const GLenum usage = in.U32();
+        const std::vector<unsigned char> data = in.Blob();
+
+        GLuint buffer = 0;
+        GL_CHECK(glGenBuffers(1, &buffer));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+        GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, data.size(), data.empty() ? nullptr : data.data(), usage));
+        m_Buffers[saved] = buffer;
+    }
+
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    bool complete = true;
+    std::unordered_map<GLuint, GLenum> targets;
+
+    const uint32_t textureCount = in.U32();
+    for (uint32_t i = 0; i < textureCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+        const GLenum target = in.U32();
+
+        GLuint texture = 0;
+        GL_CHECK(glGenTextures(1, &texture));
+        GL_CHECK(glBindTexture(target, texture));
+        m_Textures[saved] = texture;
+        targets[saved] = target;
+
+        if (target == GL_TEXTURE_BUFFER) {
+            const GLenum format = in.U32();
+            const GLuint buffer = lookup(m_Buffers, in.U32(), complete);
+
+            GL_CHECK(glTexBuffer(GL_TEXTURE_BUFFER, format, buffer));
+            GL_CHECK(glBindTexture(target, 0));
+            continue;
+        }
+
+        const GLint internalFormat = in.I32();
+        const GLenum format = in.U32();
+        const GLenum type = in.U32();
+
+        const uint32_t parameterCount = in.U32();
+        for (uint32_t p = 0; p < parameterCount && in.Ok(); p++) {
+            const GLenum parameter = in.U32();
+            const GLint value = in.I32();
+            GL_CHECK(glTexParameteri(target, parameter, value));
+        }
+
+        const uint32_t levels = in.U32();
+        for (uint32_t level = 0; level < levels && in.Ok(); level++) {
+            const GLint width = in.I32();
+            const GLint height = in.I32();
+            const GLint depth = in.I32();
+
+            if (target == GL_TEXTURE_CUBE_MAP) {
+                for (unsigned int face = 0; face < 6; face++) {
+                    const std::vector<unsigned char> data = in.Blob();
+                    GL_CHECK(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, width, height, 0, format, type, data.data()));
+                }
+            } else if (target == GL_TEXTURE_2D_ARRAY) {
+                const std::vector<unsigned char> data = in.Blob();
+                GL_CHECK(glTexImage3D(target, level, internalFormat, width, height, depth, 0, format, type, data.data()));
+            } else {
+                const std::vector<unsigned char> data = in.Blob();
+                GL_CHECK(glTexImage2D(target, level, internalFormat, width, height, 0, format, type, data.data()));
+            }
+        }
+
+        GL_CHECK(glBindTexture(target, 0));
+    }
+
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+    const uint32_t renderbufferCount = in.U32();
+    for (uint32_t i = 0; i < renderbufferCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+        const GLenum format = in.U32();
+        const GLint width = in.I32();
+        const GLint height = in.I32();
+        const GLint samples = in.I32();
+
+        GLuint renderbuffer = 0;
+        GL_CHECK(glGenRenderbuffers(1, &renderbuffer));
+        GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer));
+        GL_CHECK(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height));
+        m_Renderbuffers[saved] = renderbuffer;
+    }
+
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    const uint32_t vertexArrayCount = in.U32();
+    for (uint32_t i = 0; i < vertexArrayCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+        const GLuint elementBuffer = lookup(m_Buffers, in.U32(), complete);
+
+        GLuint vertexArray = 0;
+        GL_CHECK(glGenVertexArrays(1, &vertexArray));
+        GL_CHECK(glBindVertexArray(vertexArray));
+        GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer));
+        m_VertexArrays[saved] = vertexArray;
+
+        const uint32_t attributeCount = in.U32();
+        for (uint32_t a = 0; a < attributeCount && in.Ok(); a++) {
+            const GLuint index = in.U32();
+            const GLint size = in.I32();
+            const GLenum type = in.U32();
+            const GLint normalized = in.I32();
+            const GLint integer = in.I32();
+            const GLint stride = in.I32();
+            const GLuint buffer = lookup(m_Buffers, in.U32(), complete);
+            const size_t offset = in.U32();
+            const GLuint divisor = in.U32();
+
+            GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+            GL_CHECK(glEnableVertexAttribArray(index));
+
+            if (integer) {
+                GL_CHECK(glVertexAttribIPointer(index, size, type, stride, reinterpret_cast<const void*>(offset)));
+            } else {
+                GL_CHECK(glVertexAttribPointer(index, size, type, static_cast<GLboolean>(normalized), stride, reinterpret_cast<const void*>(offset)));
+            }
+
+            GL_CHECK(glVertexAttribDivisor(index, divisor));
+        }
+    }
+
+    GL_CHECK(glBindVertexArray(0));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    const uint32_t framebufferCount = in.U32();
+    for (uint32_t i = 0; i < framebufferCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+
+        GLuint framebuffer = 0;
+        GL_CHECK(glGenFramebuffers(1, &framebuffer));
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+        m_Framebuffers[saved] = framebuffer;
+
+        const uint32_t attachmentCount = in.U32();
+        for (uint32_t a = 0; a < attachmentCount && in.Ok(); a++) {
+            const GLenum attachment = in.U32();
+            const GLenum objectType = in.U32();
+            const GLuint object = in.U32();
+            const GLint level = in.I32();
+            const GLint layer = in.I32();
+            const GLint layered = in.I32();
+
+            // Single cube faces aren't told apart from 2D attachments; nothing renders to one.
+            if (objectType == GL_RENDERBUFFER) {
+                GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, lookup(m_Renderbuffers, object, complete)));
+            } else if (layered) {
+                GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, attachment, lookup(m_Textures, object, complete), level));
+            } else if (targets[object] == GL_TEXTURE_2D_ARRAY) {
+                GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, lookup(m_Textures, object, complete), level, layer));
+            } else {
+                GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, lookup(m_Textures, object, complete), level));
+            }
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Recorded framebuffer " << saved << " is incomplete" << std::endl;
+        }
+    }
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    const uint32_t programCount = in.U32();
+    for (uint32_t i = 0; i < programCount && in.Ok(); i++) {
+        const GLuint saved = in.U32();
+        const GLuint program = glCreateProgram();
+        m_Programs[saved] = program;
+
+        std::vector<GLuint> shaders;
+        const uint32_t shaderCount = in.U32();
+        for (uint32_t s = 0; s < shaderCount && in.Ok(); s++) {
+            const GLenum type = in.U32();
+            const GLuint shader = compileShader(type, in.String());
+
+            if (shader) {
+                GL_CHECK(glAttachShader(program, shader));
+                shaders.push_back(shader);
+            }
+        }
+
+        GL_CHECK(glLinkProgram(program));
+
+        for (GLuint shader : shaders) {
+            GL_CHECK(glDeleteShader(shader));
+        }
+
+        GLint linked = 0;
+        GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+
+        if (!linked) {
+            char infoLog[INFOLOG_SIZE];
+            GL_CHECK(glGetProgramInfoLog(program, INFOLOG_SIZE, nullptr, infoLog));
+            std::cerr << "Recorded program " << saved << " failed to link:\n" << infoLog << std::endl;
+        }
+
+        GL_CHECK(glUseProgram(program));
+
+        std::unordered_map<GLint, GLint>& locations = m_Locations[saved];
+        const uint32_t uniformCount = in.U32();
+
+        for (uint32_t u = 0; u < uniformCount && in.Ok(); u++) {
+            const std::string name = in.String();
+            const GLint savedLocation = in.I32();
+            const GLenum type = in.U32();
+            std::vector<uint32_t> words(std::min<uint32_t>(in.U32(), 16));
+            in.Bytes(words.data(), words.size() * sizeof(uint32_t));
+
+            const GLint location = linked ? glGetUniformLocation(program, name.c_str()) : -1;
+            locations[savedLocation] = location;
+
+            if (location != -1) {
+                setUniform(location, type, words);
+            } else if (linked) {
+                std::cerr << "Failed to find \"" << name << "\" in the rebuilt program; commands setting it are skipped" << std::endl;
+            }
+        }
+
+        const uint32_t blockCount = in.U32();
+        for (uint32_t b = 0; b < blockCount && in.Ok(); b++) {
+            const std::string name = in.String();
+            const GLuint binding = in.U32();
+            const GLuint index = linked ? glGetUniformBlockIndex(program, name.c_str()) : GL_INVALID_INDEX;
+
+            if (index != GL_INVALID_INDEX) {
+                GL_CHECK(glUniformBlockBinding(program, index, binding));
+            }
+        }
+    }
+
+    GL_CHECK(glUseProgram(0));
+
+    std::vector<unsigned char> prologue = in.Blob();
+    std::vector<unsigned char> commands = in.Blob();
+
+    if (!in.Ok() || !m_Prologue.Assign(std::move(prologue)) || !m_Commands.Assign(std::move(commands))) {
+        std::cerr << path << " is truncated or corrupt" << std::endl;
+        release();
+        return false;
+    }
+
+    // The prologue leaves the frame's program bound, so the commands pick up tracking where it stops.
+    GLuint program = 0;
+    complete = remap(m_Prologue, program) && complete;
+    complete = remap(m_Commands, program) && complete;
+
+    if (!complete) {
+        std::cerr << "The recorded frame refers to objects that were not saved with it; they are left unbound" << std::endl;
+    }
+
+    return true;
+}
+
+const CommandBuffer& RecordedFrame::GetPrologue() const {
+    return m_Prologue;
+}
+
+const CommandBuffer& RecordedFrame::GetCommands() const {
+    return m_Commands;
+}
+
+int RecordedFrame::GetWidth() const {
+    return m_Width;
+}
+
+int RecordedFrame::GetHeight() const {
+    return m_Height;
+}
+
+void RecordedFrame::release() {
+    for (const auto& [saved, program] : m_Programs) {
+        GL_CHECK(glDeleteProgram(program));
+    }
+
+    for (const auto& [saved, framebuffer] : m_Framebuffers) {
+        GL_CHECK(glDeleteFramebuffers(1, &framebuffer));
+    }
+
+    for (const auto& [saved, vertexArray] : m_VertexArrays) {
+        GL_CHECK(glDeleteVertexArrays(1, &vertexArray));
+    }
+
+    for (const auto& [saved, renderbuffer] : m_Renderbuffers) {
+        GL_CHECK(glDeleteRenderbuffers(1, &renderbuffer));
+    }
+
+    for (const auto& [saved, texture] : m_Textures) {
+        GL_CHECK(glDeleteTextures(1, &texture));
+    }
+
+    for (const auto& [saved, buffer] : m_Buffers) {
+        GL_CHECK(glDeleteBuffers(1, &buffer));
+    }
+
+    m_Programs.clear();
+    m_Framebuffers.clear();
+    m_VertexArrays.clear();
+    m_Renderbuffers.clear();
+    m_Textures.clear();
+    m_Buffers.clear();
+    m_Locations.clear();
+    m_Prologue.Reset();
+    m_Commands.Reset();
+}
+
+bool RecordedFrame::remap(CommandBuffer& commands, GLuint& program) {
+    bool complete = true;
+
+    commands.ForEach([&](CommandView& command) {
+        const CommandInfo& info = GetCommandInfo(command.type);
+
+        for (unsigned int i = 0; i < command.argCount; i++) {
+            const GLuint saved = command.GetArg(i);
+
+            switch (info.args[i]) {
+            case CommandArg::Program:
+                program = saved;
+                command.SetArg(i, lookup(m_Programs, saved, complete));
+                break;
+            case CommandArg::VertexArray:
+                command.SetArg(i, lookup(m_VertexArrays, saved, complete));
+                break;
+            case CommandArg::Texture:
+                command.SetArg(i, lookup(m_Textures, saved, complete));
+                break;
+            case CommandArg::Buffer:
+                command.SetArg(i, lookup(m_Buffers, saved, complete));
+                break;
+            case CommandArg::Framebuffer:
+                command.SetArg(i, lookup(m_Framebuffers, saved, complete));
+                break;
+            case CommandArg::UniformLocation: {
+                // Locations the rebuilt program doesn't have become -1, which GL ignores.
+                GLint location = -1;
+                auto locations = m_Locations.find(program);
+
+                if (locations != m_Locations.end()) {
+                    auto found = locations->second.find(static_cast<GLint>(saved));
+
+                    if (found != locations->second.end()) {
+                        location = found->second;
+                    }
+                }
+
+                command.SetArg(i, static_cast<uint32_t>(location));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    });
+
+    return complete;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "commands.hpp"
+#include "utility.hpp"
+
+// Writes a recorded pass to path with everything needed to run it in another context: the contents of every
+// buffer, texture, vertex array, framebuffer and program it references, and a prologue of commands that puts
+// the fixed-function state and bindings back the way they were when the pass began. Call it after recording
+// and before executing the pass, with the context that recorded it current. width and height are the size
+// the pass renders at. Buffer textures need GL 4.3 to read their format back; without it the save fails.
+bool SaveFrame(const std::string& path, const CommandBuffer& commands, int width, int height);
+
+// A frame saved by SaveFrame, recreated in the current context. Every object is rebuilt and the recorded
+// streams are renumbered to the new names, uniform locations included, so Execute on the prologue and then the
+// commands renders the frame again. Objects are deleted with the RecordedFrame.
+class RecordedFrame {
+public:
+    RecordedFrame() = default;
+    ~RecordedFrame();
+
+    RecordedFrame(const RecordedFrame&) = delete;
+    RecordedFrame& operator=(const RecordedFrame&) = delete;
+
+    bool Load(const std::string& path);
+
+    // Restores the state the frame started from; run it before every replay of the commands.
+    const CommandBuffer& GetPrologue() const;
+    const CommandBuffer& GetCommands() const;
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+private:
+    CommandBuffer m_Prologue;
+    CommandBuffer m_Commands;
+    int m_Width = 0;
+    int m_Height = 0;
+
+    // Saved name to the name in this context, per object kind.
+    std::unordered_map<GLuint, GLuint> m_Buffers;
+    std::unordered_map<GLuint, GLuint> m_Textures;
+    std::unordered_map<GLuint, GLuint> m_Renderbuffers;
+    std::unordered_map<GLuint, GLuint> m_VertexArrays;
+    std::unordered_map<GLuint, GLuint> m_Framebuffers;
+    std::unordered_map<GLuint, GLuint> m_Programs;
+    // Per saved program, saved uniform location to the location in the rebuilt program.
+    std::unordered_map<GLuint, std::unordered_map<GLint, GLint>> m_Locations;
+
+    void release();
+    bool remap(CommandBuffer& commands, GLuint& program);
+};
\ No newline at end of file
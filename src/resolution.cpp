@@ -0,0 +1,168 @@
+#include "resolution.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+RenderTarget::~RenderTarget() {
+    release();
+}
+
+bool RenderTarget::Resize(int width, int height) {
+    if (m_FBO && width == m_Width && height == m_Height) {
+        return true;
+    }
+
+    release();
+
+    m_Width = width;
+    m_Height = height;
+
+    GL_CHECK(glGenTextures(1, &m_Color));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_Color));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    TrackGpuMemory(GpuResource::Texture, m_Color, MemoryCategory::RenderTargets, static_cast<size_t>(width) * height * 4);
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GL_CHECK(glGenRenderbuffers(1, &m_Depth));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, m_Depth));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height));
+    TrackGpuMemory(GpuResource::Renderbuffer, m_Depth, MemoryCategory::RenderTargets, static_cast<size_t>(width) * height * 4);
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GL_CHECK(glGenFramebuffers(1, &m_FBO));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_FBO));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Color, 0));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Depth));
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    if (!complete) {
+        std::cerr << "Render target framebuffer is incomplete at " << width << "x" << height << std::endl;
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+void RenderTarget::Bind(CommandBuffer& commands, int width, int height) const {
+    commands.BindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    commands.Viewport(0, 0, width, height);
+}
+
+void RenderTarget::BlitToScreen(int width, int height, int screenWidth, int screenHeight) const {
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO));
+    GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    GL_CHECK(glBlitFramebuffer(0, 0, width, height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GL_CHECK(glViewport(0, 0, screenWidth, screenHeight));
+}
+
+int RenderTarget::GetWidth() const {
+    return m_Width;
+}
+
+int RenderTarget::GetHeight() const {
+    return m_Height;
+}
+
+void RenderTarget::release() {
+    if (m_FBO) {
+        ReleaseGpuMemory(GpuResource::Texture, m_Color);
+        ReleaseGpuMemory(GpuResource::Renderbuffer, m_Depth);
+
+        GL_CHECK(glDeleteFramebuffers(1, &m_FBO));
+        GL_CHECK(glDeleteTextures(1, &m_Color));
+        GL_CHECK(glDeleteRenderbuffers(1, &m_Depth));
+    }
+
+    m_FBO = 0;
+    m_Color = 0;
+    m_Depth = 0;
+}
+
+GpuTimer::GpuTimer() {
+    GL_CHECK(glGenQueries(LATENCY, m_Queries.data()));
+}
+
+GpuTimer::~GpuTimer() {
+    GL_CHECK(glDeleteQueries(LATENCY, m_Queries.data()));
+}
+
+void GpuTimer::Begin() {
+    // With every query still pending, drop the oldest result rather than stall on it.
+    if (m_Issued - m_Collected == LATENCY) {
+        m_Collected++;
+    }
+
+    GL_CHECK(glBeginQuery(GL_TIME_ELAPSED, m_Queries[m_Issued % LATENCY]));
+}
+
+void GpuTimer::End() {
+    GL_CHECK(glEndQuery(GL_TIME_ELAPSED));
+    m_Issued++;
+}
+
+bool GpuTimer::Poll(float& milliseconds) {
+    if (m_Collected == m_Issued) {
+        return false;
+    }
+
+    GLuint query = m_Queries[m_Collected % LATENCY];
+
+    GLint available = 0;
+    GL_CHECK(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+
+    if (!available) {
+        return false;
+    }
+
+    GLuint64 elapsed = 0;
+    GL_CHECK(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed));
+
+    milliseconds = static_cast<float>(elapsed) / 1.0e6f;
+    m_Collected++;
+
+    return true;
+}
+
+ResolutionController::ResolutionController(const ResolutionSettings& settings) : m_Settings(settings), m_Scale(settings.maxScale) {
+}
+
+float ResolutionController::Update(float gpuMs) {
+    m_Filtered = m_Filtered < 0.0f ? gpuMs : m_Filtered * 0.7f + gpuMs * 0.3f;
+
+    if (m_Cooldown > 0) {
+        m_Cooldown--;
+        return m_Scale;
+    }
+
+    const float target = m_Settings.targetMs;
+
+    if (m_Filtered > target * (1.0f - m_Settings.hysteresis) && m_Filtered < target * (1.0f + m_Settings.hysteresis)) {
+        return m_Scale;
+    }
+
+    float desired = m_Scale * std::sqrt(target / glm::max(m_Filtered, 0.01f));
+    desired = glm::clamp(desired, m_Scale - m_Settings.maxStep, m_Scale + m_Settings.maxStep);
+    desired = glm::clamp(desired, m_Settings.minScale, m_Settings.maxScale);
+
+    if (desired != m_Scale) {
+        m_Scale = desired;
+        m_Cooldown = m_Settings.cooldownFrames;
+    }
+
+    return m_Scale;
+}
+
+float ResolutionController::GetScale() const {
+    return m_Scale;
+}
+
+const ResolutionSettings& ResolutionController::GetSettings() const {
+    return m_Settings;
+}
\ No newline at end of file
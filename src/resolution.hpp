@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+
+#include "commands.hpp"
+#include "memory.hpp"
+#include "utility.hpp"
+
+// Offscreen color and depth target the scene renders into before being scaled to the window. It is sized
+// for the largest scale, and lower scales render into its bottom-left corner, so changing the scale never
+// reallocates anything.
+class RenderTarget {
+public:
+    RenderTarget() = default;
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // Reallocates only when the size changed. Returns false if the framebuffer is incomplete.
+    bool Resize(int width, int height);
+
+    // Binds the target and sets the viewport to the region being rendered this frame.
+    void Bind(CommandBuffer& commands, int width, int height) const;
+
+    // Scales the rendered region onto the default framebuffer with bilinear filtering and leaves it bound.
+    void BlitToScreen(int width, int height, int screenWidth, int screenHeight) const;
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+private:
+    GLuint m_FBO = 0;
+    GLuint m_Color = 0;
+    GLuint m_Depth = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+
+    void release();
+};
+
+// GL_TIME_ELAPSED queries kept in a small ring, so a result is read a few frames after it was issued
+// instead of stalling on the frame that just ended.
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void Begin();
+    void End();
+
+    // Collects the oldest finished measurement. Returns false when none is ready yet.
+    bool Poll(float& milliseconds);
+
+private:
+    static constexpr unsigned int LATENCY = 4;
+
+    std::array<GLuint, LATENCY> m_Queries = {};
+    unsigned int m_Issued = 0;
+    unsigned int m_Collected = 0;
+};
+
+struct ResolutionSettings {
+    // GPU time the scene pass should fit in.
+    float targetMs = 12.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // Fraction of the budget the filtered GPU time has to miss by before the scale moves.
+    float hysteresis = 0.1f;
+    // Largest change of scale in one adjustment.
+    float maxStep = 0.1f;
+    // Frames to leave alone after an adjustment, long enough for the new scale to show up in the timings.
+    unsigned int cooldownFrames = 8;
+};
+
+// Picks the internal resolution scale from measured GPU time. Cost is taken to follow the pixel count,
+// so the scale moves by the square root of the budget ratio.
+class ResolutionController {
+public:
+    explicit ResolutionController(const ResolutionSettings& settings = ResolutionSettings());
+
+    // Feeds one GPU time measurement and returns the scale to render at.
+    float Update(float gpuMs);
+
+    float GetScale() const;
+    const ResolutionSettings& GetSettings() const;
+
+private:
+    ResolutionSettings m_Settings;
+    float m_Scale;
+    float m_Filtered = -1.0f;
+    unsigned int m_Cooldown = 0;
+};
\ No newline at end of file
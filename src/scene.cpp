@@ -0,0 +1,125 @@
+#include "scene.hpp"
+
+Scene::~Scene() {
+    if (m_InstanceBuffer) {
+        ReleaseGpuMemory(GpuResource::Buffer, m_InstanceBuffer);
+        GL_CHECK(glDeleteBuffers(1, &m_InstanceBuffer));
+    }
+}
+
+PrototypeId Scene::AddPrototype(const std::string& path) {
+    Prototype prototype;
+    prototype.model = std::make_unique<Model>(path);
+
+    m_Prototypes.push_back(std::move(prototype));
+
+    return static_cast<PrototypeId>(m_Prototypes.size() - 1);
+}
+
+void Scene::AddInstance(PrototypeId prototype, const glm::mat4& matrix) {
+    m_Prototypes[prototype].instances.push_back(matrix);
+    m_Dirty = true;
+}
+
+void Scene::AddInstances(PrototypeId prototype, const std::vector<glm::mat4>& matrices) {
+    std::vector<glm::mat4>& instances = m_Prototypes[prototype].instances;
+    instances.insert(instances.end(), matrices.begin(), matrices.end());
+    m_Dirty = true;
+}
+
+void Scene::Build() {
+    m_InstanceCount = 0;
+    for (Prototype& prototype : m_Prototypes) {
+        prototype.range = { static_cast<unsigned int>(m_InstanceCount), static_cast<unsigned int>(prototype.instances.size()) };
+        m_InstanceCount += prototype.instances.size();
+    }
+
+    if (!m_InstanceBuffer) {
+        GL_CHECK(glGenBuffers(1, &m_InstanceBuffer));
+    }
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, m_InstanceCount * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW));
+    TrackGpuMemory(GpuResource::Buffer, m_InstanceBuffer, MemoryCategory::Instances, m_InstanceCount * sizeof(glm::mat4));
+
+    m_DrawList.clear();
+
+    for (PrototypeId id = 0; id < m_Prototypes.size(); id++) {
+        Prototype& prototype = m_Prototypes[id];
+
+        if (!prototype.instances.empty()) {
+            GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, prototype.range.first * sizeof(glm::mat4), prototype.instances.size() * sizeof(glm::mat4), prototype.instances.data()));
+        }
+
+        for (unsigned int i = 0; i < prototype.model->meshes.size(); i++) {
+            Mesh& mesh = prototype.model->meshes[i];
+            mesh.SetInstanceBuffer(m_InstanceBuffer);
+
+            if (prototype.range.count == 0) {
+                continue;
+            }
+
+            m_DrawList.push_back({ id, i, mesh.material, prototype.range });
+        }
+    }
+
+    std::sort(m_DrawList.begin(), m_DrawList.end(), [](const DrawItem& lhs, const DrawItem& rhs) {
+        if (lhs.prototype != rhs.prototype) {
+            return lhs.prototype < rhs.prototype;
+        }
+
+        if (lhs.material != rhs.material) {
+            return lhs.material < rhs.material;
+        }
+
+        return lhs.mesh < rhs.mesh;
+    });
+
+    m_Dirty = false;
+}
+
+void Scene::Draw(Shader& shader, CommandBuffer& commands) {
+    if (m_Dirty) {
+        Build();
+    }
+
+    stats = DrawStats();
+
+    commands.SetUniform(shader, "indirectInstances", false);
+
+    // Material indices are only unique within a prototype, whose library also owns the arrays, so the arrays
+    // are bound when the prototype changes and the material uniforms when either does.
+    const DrawItem* previous = nullptr;
+
+    for (const DrawItem& item : m_DrawList) {
+        const MaterialLibrary& materials = m_Prototypes[item.prototype].model->materials;
+        Mesh& mesh = m_Prototypes[item.prototype].model->meshes[item.mesh];
+
+        if (!previous || previous->prototype != item.prototype) {
+            stats.textureBinds += materials.Bind(commands);
+        }
+
+        if (!previous || previous->prototype != item.prototype || previous->material != item.material) {
+            materials.Use(shader, commands, item.material);
+            stats.materialSwitches++;
+        }
+
+        mesh.Draw(commands, item.range.count, item.range.first);
+        previous = &item;
+        stats.unbatchedTextureBinds += materials.Get(item.material).textureCount;
+
+        stats.drawCalls++;
+        stats.triangles += static_cast<unsigned long long>(mesh.TriangleCount()) * item.range.count;
+    }
+
+    stats.instances = static_cast<unsigned int>(m_InstanceCount);
+    stats.fullDetailTriangles = stats.triangles;
+}
+
+size_t Scene::GetPrototypeCount() const {
+    return m_Prototypes.size();
+}
+
+size_t Scene::GetInstanceCount() const {
+    return m_InstanceCount;
+}
\ No newline at end of file
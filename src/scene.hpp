@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memory.hpp"
+#include "model.hpp"
+#include "shader.hpp"
+#include "utility.hpp"
+
+using PrototypeId = unsigned int;
+
+// Owns a single instance buffer shared by many prototypes. Every prototype's instances occupy one contiguous
+// range of that buffer, so each mesh is submitted with one base-instance draw regardless of how many
+// prototypes the scene holds.
+class Scene {
+public:
+    Scene() = default;
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    PrototypeId AddPrototype(const std::string& path);
+
+    void AddInstance(PrototypeId prototype, const glm::mat4& matrix);
+    void AddInstances(PrototypeId prototype, const std::vector<glm::mat4>& matrices);
+
+    // Packs every prototype's instances into the shared buffer and rebuilds the sorted draw list.
+    // Draw calls this itself when instances were added since the last build.
+    void Build();
+
+    void Draw(Shader& shader, CommandBuffer& commands);
+
+    size_t GetPrototypeCount() const;
+    size_t GetInstanceCount() const;
+
+    DrawStats stats;
+
+private:
+    struct Prototype {
+        std::unique_ptr<Model> model;
+        std::vector<glm::mat4> instances;
+        InstanceRange range;
+    };
+
+    struct DrawItem {
+        PrototypeId prototype;
+        unsigned int mesh;
+        unsigned int material;
+        InstanceRange range;
+    };
+
+    std::vector<Prototype> m_Prototypes;
+    std::vector<DrawItem> m_DrawList;
+
+    GLuint m_InstanceBuffer = 0;
+    size_t m_InstanceCount = 0;
+    bool m_Dirty = false;
+};
\ No newline at end of file
@@ -113,12 +113,38 @@ void Shader::Use() {
     GL_CHECK(glUseProgram(this->m_ID));
 }
 
+GLuint Shader::GetID() const {
+    return this->m_ID;
+}
+
+void Shader::Replace(GLuint program, bool fallback) {
+    if (this->m_ID != 0) {
+        GL_CHECK(glDeleteProgram(this->m_ID));
+    }
+
+    this->m_ID = program;
+    this->m_Fallback = fallback;
+}
+
+bool Shader::IsFallback() const {
+    return this->m_Fallback;
+}
+
+void Shader::BindUniformBlock(const std::string& name, GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(this->m_ID, name.c_str());
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "Failed to find uniform block \"" << name << "\"" << std::endl;
+    } else {
+        GL_CHECK(glUniformBlockBinding(this->m_ID, index, binding));
+    }
+}
+
 void Shader::Set(const std::string& name, bool value) const {
     static bool notified = false;
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -132,7 +158,7 @@ void Shader::Set(const std::string& name, int value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -146,7 +172,7 @@ void Shader::Set(const std::string& name, float value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -160,7 +186,7 @@ void Shader::Set(const std::string& name, const glm::vec2& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -174,7 +200,7 @@ void Shader::Set(const std::string& name, float x, float y) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -188,7 +214,7 @@ void Shader::Set(const std::string& name, const glm::vec3& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -202,7 +228,7 @@ void Shader::Set(const std::string& name, float x, float y, float z) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -216,7 +242,7 @@ void Shader::Set(const std::string& name, const glm::vec4& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -230,7 +256,7 @@ void Shader::Set(const std::string& name, float x, float y, float z, float w) co
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -244,7 +270,7 @@ void Shader::Set(const std::string& name, const glm::mat2& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -258,7 +284,7 @@ void Shader::Set(const std::string& name, const glm::mat3& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -272,7 +298,7 @@ void Shader::Set(const std::string& name, const glm::mat4& value) const {
 
     GLint location = glGetUniformLocation(this->m_ID, name.c_str());
     if (location == -1) {
-        if (!notified) {
+        if (!notified && !this->m_Fallback) {
             std::cerr << "Failed to find \"" << name << "\"" << std::endl;
             notified = true;
         }
@@ -16,10 +16,24 @@
 class Shader {
 public:
     Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath);
+    // No program until Replace gives it one; ShaderManager builds its shaders this way.
+    Shader() = default;
     ~Shader();
 
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     void Use();
 
+    GLuint GetID() const;
+
+    // Takes ownership of program and deletes the previous one. A fallback is a stand-in that lacks most of
+    // the real program's uniforms, so Set stops reporting missing ones while it is in place.
+    void Replace(GLuint program, bool fallback = false);
+    bool IsFallback() const;
+
+    void BindUniformBlock(const std::string& name, GLuint binding) const;
+
     void Set(const std::string& name, bool value) const;
     void Set(const std::string& name, int value) const;
     void Set(const std::string& name, float value) const;
@@ -35,4 +49,5 @@ public:
     
 private:
     GLuint m_ID = 0;
+    bool m_Fallback = false;
 };
\ No newline at end of file
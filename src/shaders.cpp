@@ -0,0 +1,381 @@
+#include "shaders.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // GL_COMPLETION_STATUS_KHR, shared with the ARB version of the extension. Neither is in our GL headers.
+    constexpr GLenum COMPLETION_STATUS = 0x91B1;
+
+    constexpr GLenum STAGE_TYPES[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+    constexpr const char* STAGE_NAMES[] = { "vertex", "geometry", "fragment" };
+
+    // What a program draws with while the real one compiles. Its only output is the one every fragment
+    // shader here writes, so it links against any of the vertex and geometry stages.
+    constexpr const char* FALLBACK_FRAGMENT =
+        "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = vec4(0.5, 0.5, 0.5, 1.0);\n"
+        "}\n";
+
+    bool hasExtension(const char* name) {
+        GLint count = 0;
+        GL_CHECK(glGetIntegerv(GL_NUM_EXTENSIONS, &count));
+
+        for (GLint i = 0; i < count; i++) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+
+            if (extension && std::strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool readFile(const std::string& path, std::string& contents) {
+        std::ifstream file(path);
+
+        if (!file) {
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n" << path << std::endl;
+            return false;
+        }
+
+        std::stringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+
+        return true;
+    }
+
+    // Issues the compile without asking how it went; checkProgram does that once the driver is done.
+    GLuint compileStage(GLenum type, const std::string& source) {
+        const char* code = source.c_str();
+
+        GLuint stage = glCreateShader(type);
+        GL_CHECK(glShaderSource(stage, 1, &code, nullptr));
+        GL_CHECK(glCompileShader(stage));
+
+        return stage;
+    }
+
+    GLuint linkStages(const GLuint* stages, unsigned int count) {
+        GLuint program = glCreateProgram();
+
+        for (unsigned int i = 0; i < count; i++) {
+            if (stages[i] != 0) {
+                GL_CHECK(glAttachShader(program, stages[i]));
+            }
+        }
+
+        GL_CHECK(glLinkProgram(program));
+
+        return program;
+    }
+
+    // Reports every stage that failed to compile and whether the program linked. Blocks until the driver has
+    // finished with it.
+    bool checkProgram(GLuint program, const GLuint* stages, const std::string* paths, unsigned int count) {
+        int success;
+        char infoLog[INFOLOG_SIZE];
+
+        for (unsigned int i = 0; i < count; i++) {
+            if (stages[i] == 0) {
+                continue;
+            }
+
+            GL_CHECK(glGetShaderiv(stages[i], GL_COMPILE_STATUS, &success));
+
+            if (!success) {
+                GL_CHECK(glGetShaderInfoLog(stages[i], INFOLOG_SIZE, nullptr, infoLog));
+                std::cerr << "ERROR: Failed to compile " << STAGE_NAMES[i] << " shader \"" << paths[i] << "\"\n" << infoLog << std::endl;
+            }
+        }
+
+        GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &success));
+
+        if (!success) {
+            GL_CHECK(glGetProgramInfoLog(program, INFOLOG_SIZE, nullptr, infoLog));
+            std::cerr << "ERROR: Failed to link shader program for vertex shader (\"" << paths[0] << "\") and fragment shader (\"" << paths[2] << "\")\n" << infoLog << std::endl;
+        }
+
+        return success;
+    }
+}
+
+ShaderManager::ShaderManager(const std::string& directory, bool async)
+    : m_Directory(directory), m_Async(async) {
+    // The KHR and ARB versions differ only in how the thread count is set, and the default lets the driver pick.
+    m_Parallel = async && (hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile"));
+
+    watch();
+}
+
+ShaderManager::~ShaderManager() {
+    for (auto& program : m_Programs) {
+        discard(*program);
+    }
+
+#if defined(__linux__)
+    if (m_Watch >= 0) {
+        close(m_Watch);
+    }
+#endif
+}
+
+Shader& ShaderManager::Load(const char* vertex, const char* geometry, const char* fragment, std::function<void(Shader&)> setup) {
+    auto program = std::make_unique<Program>();
+    program->shader = std::make_unique<Shader>();
+    program->paths[0] = m_Directory + "/" + vertex;
+    program->paths[1] = geometry != nullptr ? m_Directory + "/" + geometry : "";
+    program->paths[2] = m_Directory + "/" + fragment;
+    program->setup = std::move(setup);
+
+    // The stand-in is linked before the real program is issued, so the driver gets to it first.
+    if (m_Parallel) {
+        buildFallback(*program);
+    }
+
+    build(*program);
+
+    if (!m_Async) {
+        finish(*program);
+    }
+
+    m_Programs.push_back(std::move(program));
+
+    return *m_Programs.back()->shader;
+}
+
+void ShaderManager::Update() {
+    readChanges();
+
+    for (auto& program : m_Programs) {
+        if (program->pending == 0) {
+            continue;
+        }
+
+        // Without the extension there is no asking whether a build is done without waiting for it.
+        GLint done = GL_TRUE;
+
+        if (m_Parallel) {
+            GL_CHECK(glGetProgramiv(program->pending, COMPLETION_STATUS, &done));
+        }
+
+        if (done) {
+            finish(*program);
+        }
+    }
+}
+
+void ShaderManager::Finish() {
+    for (auto& program : m_Programs) {
+        if (program->pending != 0) {
+            finish(*program);
+        }
+    }
+}
+
+bool ShaderManager::IsAsync() const {
+    return m_Async;
+}
+
+bool ShaderManager::IsParallel() const {
+    return m_Parallel;
+}
+
+bool ShaderManager::IsReady() const {
+    return GetPendingCount() == 0;
+}
+
+size_t ShaderManager::GetProgramCount() const {
+    return m_Programs.size();
+}
+
+size_t ShaderManager::GetPendingCount() const {
+    return std::count_if(m_Programs.begin(), m_Programs.end(), [](const std::unique_ptr<Program>& program) {
+        return program->pending != 0;
+    });
+}
+
+void ShaderManager::build(Program& program) {
+    // A newer edit supersedes a rebuild that hasn't finished yet.
+    discard(program);
+
+    std::string sources[STAGE_COUNT];
+
+    for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+        if (!program.paths[i].empty() && !readFile(program.paths[i], sources[i])) {
+            return;
+        }
+    }
+
+    for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+        if (!program.paths[i].empty()) {
+            program.stages[i] = compileStage(STAGE_TYPES[i], sources[i]);
+        }
+    }
+
+    program.pending = linkStages(program.stages, STAGE_COUNT);
+}
+
+void ShaderManager::buildFallback(Program& program) {
+    std::string sources[STAGE_COUNT];
+    sources[2] = FALLBACK_FRAGMENT;
+
+    for (unsigned int i = 0; i < 2; i++) {
+        if (!program.paths[i].empty() && !readFile(program.paths[i], sources[i])) {
+            return;
+        }
+    }
+
+    GLuint stages[STAGE_COUNT] = {};
+
+    for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+        if (!sources[i].empty()) {
+            stages[i] = compileStage(STAGE_TYPES[i], sources[i]);
+        }
+    }
+
+    GLuint fallback = linkStages(stages, STAGE_COUNT);
+
+    // Deleted stages stay alive as long as a program they are attached to.
+    for (GLuint stage : stages) {
+        if (stage != 0) {
+            GL_CHECK(glDeleteShader(stage));
+        }
+    }
+
+    program.shader->Replace(fallback, true);
+
+    if (program.setup) {
+        program.setup(*program.shader);
+    }
+}
+
+void ShaderManager::finish(Program& program) {
+    const bool linked = checkProgram(program.pending, program.stages, program.paths, STAGE_COUNT);
+
+    for (GLuint& stage : program.stages) {
+        if (stage != 0) {
+            GL_CHECK(glDeleteShader(stage));
+            stage = 0;
+        }
+    }
+
+    if (linked) {
+        program.shader->Replace(program.pending);
+
+        if (program.setup) {
+            program.setup(*program.shader);
+        }
+
+        if (program.linked) {
+            std::cout << "Reloaded \"" << program.paths[0] << "\" and \"" << program.paths[2] << "\"\n";
+        }
+
+        program.linked = true;
+    } else {
+        GL_CHECK(glDeleteProgram(program.pending));
+
+        if (program.linked) {
+            std::cerr << "Keeping the running program until the shader is fixed" << std::endl;
+        } else if (program.shader->IsFallback()) {
+            std::cerr << "Drawing with the fallback program until the shader is fixed" << std::endl;
+        }
+    }
+
+    program.pending = 0;
+}
+
+void ShaderManager::discard(Program& program) {
+    for (GLuint& stage : program.stages) {
+        if (stage != 0) {
+            GL_CHECK(glDeleteShader(stage));
+            stage = 0;
+        }
+    }
+
+    if (program.pending != 0) {
+        GL_CHECK(glDeleteProgram(program.pending));
+        program.pending = 0;
+    }
+}
+
+void ShaderManager::watch() {
+#if defined(__linux__)
+    m_Watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    // Editors either rewrite a file in place or write a new one and rename it over the old.
+    if (m_Watch < 0 || inotify_add_watch(m_Watch, m_Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Failed to watch \"" << m_Directory << "\" for shader changes; hot reload is off" << std::endl;
+
+        if (m_Watch >= 0) {
+            close(m_Watch);
+            m_Watch = -1;
+        }
+    }
+#else
+    std::cerr << "Shader hot reload needs inotify and is off on this platform" << std::endl;
+#endif
+}
+
+void ShaderManager::readChanges() {
+#if defined(__linux__)
+    if (m_Watch < 0) {
+        return;
+    }
+
+    std::vector<std::string> changed;
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        const ssize_t length = read(m_Watch, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+            if (event->len > 0) {
+                changed.emplace_back(event->name);
+            }
+
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    // Saving one file can raise several events, and one file can feed several programs; each program that
+    // uses any changed file is rebuilt once.
+    for (auto& program : m_Programs) {
+        const bool affected = std::any_of(std::begin(program->paths), std::end(program->paths), [&](const std::string& path) {
+            return !path.empty() && std::find(changed.begin(), changed.end(), std::filesystem::path(path).filename().string()) != changed.end();
+        });
+
+        if (!affected) {
+            continue;
+        }
+
+        build(*program);
+
+        if (!m_Async) {
+            finish(*program);
+        }
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+#include "utility.hpp"
+
+// Builds every program the application uses without waiting on any of them, and rebuilds them when their
+// sources change.
+//
+// With GL_KHR_parallel_shader_compile the driver compiles and links on its own threads and Update polls
+// GL_COMPLETION_STATUS_KHR once a frame. Until a program finishes, its Shader draws with a stand-in made of the
+// same vertex and geometry stages and a flat fragment stage. Without the extension every program is still
+// issued before any status is read, so drivers that compile in the background overlap them, and the first
+// Update waits for the lot. Synchronous mode builds and checks each program in Load, as Shader's constructor does.
+//
+// On Linux the shader directory is watched with inotify. A program whose files change is rebuilt the same way
+// and swapped in only once it links, so a broken edit leaves the running program in place.
+class ShaderManager {
+public:
+    ShaderManager(const std::string& directory, bool async);
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // Starts building a program from files in the shader directory; geometry may be null. setup runs on each
+    // program as it is swapped in, stand-ins included, for state kept in the program such as sampler units and
+    // block bindings. The Shader lives as long as the manager and stays the same object across rebuilds.
+    Shader& Load(const char* vertex, const char* geometry, const char* fragment, std::function<void(Shader&)> setup = {});
+
+    // Swaps in programs that have finished and starts rebuilding ones whose files changed. Call once a frame
+    // on the thread that owns the context.
+    void Update();
+    // Waits for every program still being built and swaps it in.
+    void Finish();
+
+    bool IsAsync() const;
+    bool IsParallel() const;
+    // True once no program is being built.
+    bool IsReady() const;
+    size_t GetProgramCount() const;
+    size_t GetPendingCount() const;
+
+private:
+    // Vertex, geometry and fragment, in that order. A program without a geometry stage has an empty path there.
+    static constexpr unsigned int STAGE_COUNT = 3;
+
+    struct Program {
+        std::unique_ptr<Shader> shader;
+        std::string paths[STAGE_COUNT];
+        std::function<void(Shader&)> setup;
+        // The build in flight and its stages, or 0.
+        GLuint pending = 0;
+        GLuint stages[STAGE_COUNT] = {};
+        // Whether a build has ever linked, as opposed to the Shader holding a stand-in or nothing.
+        bool linked = false;
+    };
+
+    std::string m_Directory;
+    bool m_Async;
+    bool m_Parallel = false;
+    std::vector<std::unique_ptr<Program>> m_Programs;
+    // inotify descriptor for the shader directory, or -1.
+    int m_Watch = -1;
+
+    void build(Program& program);
+    void buildFallback(Program& program);
+    void finish(Program& program);
+    void discard(Program& program);
+    void watch();
+    void readChanges();
+};
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "shadows.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+CascadedShadows::CascadedShadows(const ShadowSettings& settings) : m_Settings(settings) {
+    m_Settings.cascades = glm::clamp(m_Settings.cascades, 1u, MAX_CASCADES);
+    m_Settings.resolution = std::max(m_Settings.resolution, 1);
+
+    const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    GL_CHECK(glGenTextures(1, &m_DepthArray));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, m_DepthArray));
+    GL_CHECK(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, m_Settings.resolution, m_Settings.resolution, m_Settings.cascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr));
+    TrackGpuMemory(GpuResource::Texture, m_DepthArray, MemoryCategory::Shadows, static_cast<size_t>(m_Settings.resolution) * m_Settings.resolution * m_Settings.cascades * 4);
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER));
+    GL_CHECK(glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    for (unsigned int i = 0; i < m_Settings.cascades; i++) {
+        Cascade& cascade = m_Cascades[i];
+
+        GL_CHECK(glGenFramebuffers(1, &cascade.fbo));
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, cascade.fbo));
+        GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthArray, 0, i));
+        GL_CHECK(glDrawBuffer(GL_NONE));
+        GL_CHECK(glReadBuffer(GL_NONE));
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Shadow cascade " << i << " framebuffer is incomplete" << std::endl;
+        }
+    }
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    GL_CHECK(glGenBuffers(1, &m_CasterBuffer));
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, m_CasterBuffer));
+    GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int), nullptr, GL_STREAM_DRAW));
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+    TrackGpuMemory(GpuResource::Buffer, m_CasterBuffer, MemoryCategory::Shadows, sizeof(unsigned int));
+
+    GL_CHECK(glGenTextures(1, &m_CasterTexture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, m_CasterTexture));
+    GL_CHECK(glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_CasterBuffer));
+    GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, 0));
+}
+
+CascadedShadows::~CascadedShadows() {
+    for (unsigned int i = 0; i < m_Settings.cascades; i++) {
+        GL_CHECK(glDeleteFramebuffers(1, &m_Cascades[i].fbo));
+    }
+
+    ReleaseGpuMemory(GpuResource::Texture, m_DepthArray);
+    ReleaseGpuMemory(GpuResource::Buffer, m_CasterBuffer);
+
+    GL_CHECK(glDeleteTextures(1, &m_DepthArray));
+    GL_CHECK(glDeleteTextures(1, &m_CasterTexture));
+    GL_CHECK(glDeleteBuffers(1, &m_CasterBuffer));
+}
+
+void CascadedShadows::Render(Model& model, Shader& depthShader, const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection, ThreadPool& pool) {
+    MemoryScope scope(MemoryCategory::Shadows);
+
+    const glm::mat4 inverseView = glm::inverse(view);
+    const glm::vec3 direction = glm::normalize(lightDirection);
+
+    const bool lightMoved = direction != m_LightDirection;
+    const bool instancesMoved = model.GetInstanceVersion() != m_InstanceVersion;
+
+    m_LightDirection = direction;
+    m_InstanceVersion = model.GetInstanceVersion();
+
+    GL_CHECK(glPolygonMode(GL_FRONT_AND_BACK, GL_FILL));
+    GL_CHECK(glEnable(GL_POLYGON_OFFSET_FILL));
+    GL_CHECK(glPolygonOffset(2.0f, 4.0f));
+
+    float sliceNear = nearPlane;
+
+    for (unsigned int i = 0; i < m_Settings.cascades; i++) {
+        Cascade& cascade = m_Cascades[i];
+
+        // Practical split scheme: a blend of even and logarithmic spacing over the shadowed distance.
+        const float fraction = static_cast<float>(i + 1) / static_cast<float>(m_Settings.cascades);
+        const float evenSplit = nearPlane + (m_Settings.distance - nearPlane) * fraction;
+        const float logSplit = nearPlane * std::pow(m_Settings.distance / nearPlane, fraction);
+        const float sliceFar = glm::mix(evenSplit, logSplit, m_Settings.splitLambda);
+
+        const glm::vec4 sphere = sliceSphere(inverseView, fovY, aspect, sliceNear, sliceFar);
+
+        cascade.splitFar = sliceFar;
+        cascade.stats.rendered = false;
+        sliceNear = sliceFar;
+
+        bool redraw = !cascade.valid || lightMoved || instancesMoved;
+
+        if (i >= m_Settings.cachedFrom) {
+            const bool contained = cascade.valid && glm::length(glm::vec3(sphere) - glm::vec3(cascade.fit)) + sphere.w <= cascade.fit.w;
+
+            if (!contained || lightMoved) {
+                cascade.fit = glm::vec4(glm::vec3(sphere), sphere.w * m_Settings.cacheSlack);
+                redraw = true;
+            }
+        } else {
+            cascade.fit = sphere;
+            redraw = redraw || fitLight(cascade.fit, direction) != cascade.lightViewProjection;
+        }
+
+        if (redraw) {
+            cascade.lightViewProjection = fitLight(cascade.fit, direction);
+
+            cullCasters(cascade, model.GetInstanceSpheres(), pool);
+            drawCascade(i, model, depthShader);
+
+            cascade.valid = true;
+            cascade.stats.rendered = true;
+        }
+
+        float gpuMs = 0.0f;
+        while (cascade.timer.Poll(gpuMs)) {
+            cascade.stats.gpuMs = gpuMs;
+        }
+    }
+
+    GL_CHECK(glDisable(GL_POLYGON_OFFSET_FILL));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void CascadedShadows::Bind(Shader& shader, CommandBuffer& commands, bool enabled) const {
+    commands.SetUniform(shader, "shadowsEnabled", enabled);
+
+    if (!enabled) {
+        return;
+    }
+
+    commands.BindTexture(SHADOW_MAP_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, m_DepthArray);
+
+    glm::vec4 splits(0.0f);
+
+    for (unsigned int i = 0; i < m_Settings.cascades; i++) {
+        splits[i] = m_Cascades[i].splitFar;
+        commands.SetUniform(shader, "cascadeMatrices[" + std::to_string(i) + "]", m_Cascades[i].lightViewProjection);
+    }
+
+    commands.SetUniform(shader, "shadowMap", static_cast<int>(SHADOW_MAP_TEXTURE_UNIT));
+    commands.SetUniform(shader, "sunDirection", m_LightDirection);
+    commands.SetUniform(shader, "cascadeCount", static_cast<int>(m_Settings.cascades));
+    commands.SetUniform(shader, "cascadeSplits", splits);
+}
+
+unsigned int CascadedShadows::GetCascadeCount() const {
+    return m_Settings.cascades;
+}
+
+const CascadeStats& CascadedShadows::GetStats(unsigned int cascade) const {
+    return m_Cascades[cascade].stats;
+}
+
+glm::vec4 CascadedShadows::sliceSphere(const glm::mat4& inverseView, float fovY, float aspect, float sliceNear, float sliceFar) const {
+    const float tanHalf = std::tan(fovY * 0.5f);
+
+    // The slice is symmetric about the view axis, so its corners' centroid sits on it.
+    const glm::vec3 center(0.0f, 0.0f, -0.5f * (sliceNear + sliceFar));
+
+    float radius = 0.0f;
+
+    for (float depth : { sliceNear, sliceFar }) {
+        glm::vec3 corner(depth * tanHalf * aspect, depth * tanHalf, -depth);
+        radius = std::max(radius, glm::length(corner - center));
+    }
+
+    // Rounded up so the cascade's extent, and with it the texel size, stays put as the camera turns.
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    return glm::vec4(glm::vec3(inverseView * glm::vec4(center, 1.0f)), radius);
+}
+
+glm::mat4 CascadedShadows::fitLight(const glm::vec4& sphere, const glm::vec3& lightDirection) const {
+    const glm::vec3 center(sphere);
+    const float radius = sphere.w;
+
+    const glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    // The eye sits casterReach behind the sphere, so anything between it and the light still gets a depth.
+    const glm::mat4 lightView = glm::lookAt(center - lightDirection * (radius + m_Settings.casterReach), center, up);
+    glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + m_Settings.casterReach);
+
+    // Snap to whole texels so edges don't shimmer as the cascade follows the camera.
+    const float halfResolution = static_cast<float>(m_Settings.resolution) * 0.5f;
+    const glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const glm::vec2 texels = glm::vec2(origin) * halfResolution;
+    const glm::vec2 offset = (glm::round(texels) - texels) / halfResolution;
+
+    lightProjection[3][0] += offset.x;
+    lightProjection[3][1] += offset.y;
+
+    return lightProjection * lightView;
+}
+
+void CascadedShadows::cullCasters(Cascade& cascade, const std::vector<glm::vec4>& spheres, ThreadPool& pool) {
+    constexpr size_t CHUNK = 65536;
+
+    auto start = std::chrono::steady_clock::now();
+
+    const Frustum frustum(cascade.lightViewProjection);
+    const size_t chunks = (spheres.size() + CHUNK - 1) / CHUNK;
+
+    m_ChunkCasters.resize(chunks);
+
+    pool.ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            std::vector<unsigned int>& out = m_ChunkCasters[chunk];
+            out.clear();
+
+            const size_t last = std::min(spheres.size(), (chunk + 1) * CHUNK);
+
+            for (size_t i = chunk * CHUNK; i < last; i++) {
+                if (frustum.Intersects(glm::vec3(spheres[i]), spheres[i].w)) {
+                    out.push_back(static_cast<unsigned int>(i));
+                }
+            }
+        }
+    });
+
+    cascade.casters.clear();
+
+    for (const std::vector<unsigned int>& chunk : m_ChunkCasters) {
+        cascade.casters.insert(cascade.casters.end(), chunk.begin(), chunk.end());
+    }
+
+    cascade.stats.casters = static_cast<unsigned int>(cascade.casters.size());
+    cascade.stats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CascadedShadows::drawCascade(unsigned int index, Model& model, Shader& depthShader) {
+    Cascade& cascade = m_Cascades[index];
+
+    const unsigned int zero = 0;
+    const void* data = cascade.casters.empty() ? static_cast<const void*>(&zero) : static_cast<const void*>(cascade.casters.data());
+    const size_t bytes = std::max<size_t>(cascade.casters.size(), 1) * sizeof(unsigned int);
+
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, m_CasterBuffer));
+    GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW));
+    GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+    TrackGpuMemory(GpuResource::Buffer, m_CasterBuffer, MemoryCategory::Shadows, bytes);
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, cascade.fbo));
+    GL_CHECK(glViewport(0, 0, m_Settings.resolution, m_Settings.resolution));
+    GL_CHECK(glClear(GL_DEPTH_BUFFER_BIT));
+
+    cascade.timer.Begin();
+
+    m_Commands.Reset();
+    m_Commands.UseProgram(depthShader);
+    m_Commands.SetUniform(depthShader, "lightViewProjection", cascade.lightViewProjection);
+    m_Commands.SetUniform(depthShader, "casters", static_cast<int>(SHADOW_CASTER_TEXTURE_UNIT));
+    m_Commands.BindTexture(SHADOW_CASTER_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_CasterTexture);
+
+    // Outer cascades cover more of the lattice per texel, so they take coarser levels.
+    model.DrawDepth(depthShader, m_Commands, static_cast<unsigned int>(cascade.casters.size()), index);
+    m_Commands.Execute();
+
+    cascade.timer.End();
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <vector>
+
+#include "commands.hpp"
+#include "memory.hpp"
+#include "model.hpp"
+#include "parallel.hpp"
+#include "resolution.hpp"
+#include "shader.hpp"
+#include "utility.hpp"
+
+// Must match the cascade arrays in model.frag.
+constexpr unsigned int MAX_CASCADES = 4;
+
+// Texture units for the shadow map and the caster list the depth shader reads, below the light buffers.
+constexpr GLuint SHADOW_MAP_TEXTURE_UNIT = 11;
+constexpr GLuint SHADOW_CASTER_TEXTURE_UNIT = 10;
+
+struct ShadowSettings {
+    unsigned int cascades = 4;
+    int resolution = 2048;
+    // Distance from the camera that receives shadows, and the blend between evenly spaced (0) and
+    // logarithmically spaced (1) cascade splits.
+    float distance = 400.0f;
+    float splitLambda = 0.75f;
+    // How far towards the light from each cascade casters are still gathered.
+    float casterReach = 600.0f;
+    // Cascades from this index on are cached: fitted with slack around their slice of the view and only redrawn
+    // when the light or the instances move, or the camera carries the slice outside the slack.
+    unsigned int cachedFrom = 2;
+    float cacheSlack = 1.5f;
+};
+
+struct CascadeStats {
+    unsigned int casters = 0;
+    float cullMs = 0.0f;
+    // GPU time of the cascade's last redraw, which lags a few frames behind.
+    float gpuMs = 0.0f;
+    // Whether the cascade was redrawn this frame rather than reused.
+    bool rendered = false;
+};
+
+// Cascaded shadow maps for a directional light. Every cascade culls the instance spheres against its own
+// light-space box, which reaches back towards the light so casters outside the view still land in it, and
+// draws only those instances into its layer of a depth texture array, at a coarser LOD the further out it is.
+class CascadedShadows {
+public:
+    explicit CascadedShadows(const ShadowSettings& settings = ShadowSettings());
+    ~CascadedShadows();
+
+    CascadedShadows(const CascadedShadows&) = delete;
+    CascadedShadows& operator=(const CascadedShadows&) = delete;
+
+    // Fits the cascades to the camera and redraws the ones that changed. Leaves the default framebuffer bound.
+    void Render(Model& model, Shader& depthShader, const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection, ThreadPool& pool);
+
+    // Binds the shadow map and sets the uniforms model.frag reads.
+    void Bind(Shader& shader, CommandBuffer& commands, bool enabled) const;
+
+    unsigned int GetCascadeCount() const;
+    const CascadeStats& GetStats(unsigned int cascade) const;
+
+private:
+    struct Cascade {
+        glm::mat4 lightViewProjection = glm::mat4(1.0f);
+        // World-space sphere the cascade was last fitted to, and the far end of its slice of the view.
+        glm::vec4 fit = glm::vec4(0.0f);
+        float splitFar = 0.0f;
+        bool valid = false;
+        GLuint fbo = 0;
+        std::vector<unsigned int> casters;
+        GpuTimer timer;
+        CascadeStats stats;
+    };
+
+    ShadowSettings m_Settings;
+    std::array<Cascade, MAX_CASCADES> m_Cascades;
+    glm::vec3 m_LightDirection = glm::vec3(0.0f);
+    unsigned long long m_InstanceVersion = ~0ull;
+
+    GLuint m_DepthArray = 0;
+    GLuint m_CasterBuffer = 0;
+    GLuint m_CasterTexture = 0;
+    // Per-chunk output of the parallel caster cull, concatenated afterwards to keep instance order.
+    std::vector<std::vector<unsigned int>> m_ChunkCasters;
+    // Program, uniforms, caster binding and depth draws of the cascade being rendered, reused across cascades
+    // and frames.
+    CommandBuffer m_Commands;
+
+    glm::vec4 sliceSphere(const glm::mat4& inverseView, float fovY, float aspect, float sliceNear, float sliceFar) const;
+    glm::mat4 fitLight(const glm::vec4& sphere, const glm::vec3& lightDirection) const;
+    void cullCasters(Cascade& cascade, const std::vector<glm::vec4>& spheres, ThreadPool& pool);
+    void drawCascade(unsigned int index, Model& model, Shader& depthShader);
+};
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include "simplify.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    struct Quadric {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+
+        void AddPlane(const glm::vec3& normal, float distance, float weight) {
+            double nx = normal.x, ny = normal.y, nz = normal.z, d = distance;
+
+            a00 += weight * nx * nx; a01 += weight * nx * ny; a02 += weight * nx * nz;
+            a11 += weight * ny * ny; a12 += weight * ny * nz; a22 += weight * nz * nz;
+            b0 += weight * nx * d; b1 += weight * ny * d; b2 += weight * nz * d;
+            c += weight * d * d;
+        }
+
+        void Add(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+        }
+
+        double Evaluate(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+
+            double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z
+                          + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                          + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+            return result < 0.0 ? 0.0 : result;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const {
+            unsigned int bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    unsigned int resolve(std::pmr::vector<unsigned int>& map, unsigned int index) {
+        unsigned int root = index;
+        while (map[root] != root) {
+            root = map[root];
+        }
+
+        while (map[index] != root) {
+            unsigned int next = map[index];
+            map[index] = root;
+            index = next;
+        }
+
+        return root;
+    }
+
+    bool flips(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& moved, int corner) {
+        glm::vec3 before = glm::cross(b - a, c - a);
+
+        glm::vec3 p[3] = { a, b, c };
+        p[corner] = moved;
+
+        glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+        // Rejecting large normal rotations as well as outright flips keeps collapses from leaving collinear slivers.
+        return glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+    }
+}
+
+std::pmr::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, std::span<const unsigned int> indices, size_t targetIndexCount, float targetError, float* resultError, std::pmr::memory_resource* scratch) {
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+
+    // Vertices are split along normal and UV seams, so topology is tracked on position groups instead.
+    std::pmr::vector<unsigned int> group(vertexCount, scratch);
+    std::pmr::vector<std::pmr::vector<unsigned int>> members(vertexCount, scratch);
+    std::pmr::unordered_map<glm::vec3, unsigned int, PositionHash> positions(scratch);
+    positions.reserve(vertexCount);
+
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        auto [it, inserted] = positions.emplace(vertices[i].Position, i);
+        group[i] = it->second;
+        members[it->second].push_back(i);
+    }
+
+    glm::vec3 min(0.0f), max(0.0f);
+    if (vertexCount > 0) {
+        min = max = vertices[0].Position;
+        for (const Vertex& vertex : vertices) {
+            min = glm::min(min, vertex.Position);
+            max = glm::max(max, vertex.Position);
+        }
+    }
+
+    const float extent = glm::max(glm::length(max - min), 1e-6f);
+    const double maxError = static_cast<double>(targetError) * extent * targetError * extent;
+
+    std::pmr::vector<Quadric> quadrics(vertexCount, scratch);
+    std::pmr::vector<unsigned int> triangles(scratch);
+    std::pmr::vector<unsigned int> corners(indices.begin(), indices.end(), scratch);
+    triangles.reserve(indices.size());
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = group[indices[i]];
+        unsigned int b = group[indices[i + 1]];
+        unsigned int c = group[indices[i + 2]];
+
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+
+        glm::vec3 normal = glm::cross(vertices[b].Position - vertices[a].Position, vertices[c].Position - vertices[a].Position);
+        float area = glm::length(normal);
+        if (area <= 0.0f) {
+            continue;
+        }
+
+        normal /= area;
+        float distance = -glm::dot(normal, vertices[a].Position);
+
+        quadrics[a].AddPlane(normal, distance, area);
+        quadrics[b].AddPlane(normal, distance, area);
+        quadrics[c].AddPlane(normal, distance, area);
+    }
+
+    std::pmr::vector<unsigned int> collapsed(vertexCount, scratch);
+    std::pmr::vector<unsigned int> wedges(vertexCount, scratch);
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        collapsed[i] = i;
+        wedges[i] = i;
+    }
+
+    double error = 0.0;
+
+    // Sized for the first pass, the largest, so later passes reuse the same storage.
+    std::pmr::vector<std::pair<unsigned int, unsigned int>> edges(scratch);
+    std::pmr::vector<Collapse> candidates(scratch);
+    std::pmr::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0, scratch);
+    std::pmr::vector<unsigned int> adjacency(scratch);
+    std::pmr::vector<unsigned int> cursor(vertexCount, 0, scratch);
+    std::pmr::vector<unsigned char> locked(vertexCount, 0, scratch);
+    std::pmr::vector<unsigned char> touched(vertexCount, 0, scratch);
+
+    edges.reserve(indices.size());
+    candidates.reserve(indices.size());
+    adjacency.reserve(indices.size());
+
+    while (triangles.size() > targetIndexCount) {
+        edges.clear();
+        candidates.clear();
+
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                unsigned int a = triangles[i + e];
+                unsigned int b = triangles[i + (e + 1) % 3];
+                edges.emplace_back(std::min(a, b), std::max(a, b));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+
+        // An edge referenced by a single triangle lies on an open border; its vertices stay put to preserve the outline.
+        std::fill(locked.begin(), locked.end(), 0);
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) {
+                j++;
+            }
+
+            if (j - i == 1) {
+                locked[edges[i].first] = 1;
+                locked[edges[i].second] = 1;
+            }
+
+            i = j;
+        }
+
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        for (const auto& [a, b] : edges) {
+            Quadric combined = quadrics[a];
+            combined.Add(quadrics[b]);
+
+            double costAB = locked[a] ? -1.0 : combined.Evaluate(vertices[b].Position);
+            double costBA = locked[b] ? -1.0 : combined.Evaluate(vertices[a].Position);
+
+            if (costAB >= 0.0 && (costBA < 0.0 || costAB <= costBA)) {
+                candidates.push_back({ a, b, costAB });
+            } else if (costBA >= 0.0) {
+                candidates.push_back({ b, a, costBA });
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs) {
+            return lhs.cost < rhs.cost;
+        });
+
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (unsigned int v : triangles) {
+            adjacencyOffsets[v + 1]++;
+        }
+
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+
+        adjacency.resize(triangles.size());
+        std::copy(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1, cursor.begin());
+        for (size_t i = 0; i < triangles.size(); i++) {
+            adjacency[cursor[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t remaining = triangles.size();
+        unsigned int applied = 0;
+
+        for (const Collapse& candidate : candidates) {
+            if (remaining <= targetIndexCount || candidate.cost > maxError) {
+                break;
+            }
+
+            if (touched[candidate.from] || touched[candidate.to]) {
+                continue;
+            }
+
+            const glm::vec3& target = vertices[candidate.to].Position;
+            bool valid = true;
+            size_t removed = 0;
+
+            for (unsigned int t = adjacencyOffsets[candidate.from]; t < adjacencyOffsets[candidate.from + 1] && valid; t++) {
+                const unsigned int* tri = &triangles[adjacency[t] * 3];
+
+                if (tri[0] == candidate.to || tri[1] == candidate.to || tri[2] == candidate.to) {
+                    removed += 3;
+                    continue;
+                }
+
+                int corner = tri[0] == candidate.from ? 0 : (tri[1] == candidate.from ? 1 : 2);
+                valid = !flips(vertices[tri[0]].Position, vertices[tri[1]].Position, vertices[tri[2]].Position, target, corner);
+            }
+
+            if (!valid) {
+                continue;
+            }
+
+            for (unsigned int t = adjacencyOffsets[candidate.from]; t < adjacencyOffsets[candidate.from + 1]; t++) {
+                const unsigned int* tri = &triangles[adjacency[t] * 3];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+            }
+
+            collapsed[candidate.from] = candidate.to;
+            quadrics[candidate.to].Add(quadrics[candidate.from]);
+            error = std::max(error, candidate.cost);
+            remaining -= removed;
+            applied++;
+
+            // Each attribute wedge of the removed vertex moves to the wedge of the target with the closest normal.
+            for (unsigned int wedge : members[candidate.from]) {
+                unsigned int best = members[candidate.to].front();
+                float bestDot = -2.0f;
+
+                for (unsigned int option : members[candidate.to]) {
+                    float d = glm::dot(vertices[wedge].Normal, vertices[option].Normal);
+                    if (d > bestDot) {
+                        bestDot = d;
+                        best = option;
+                    }
+                }
+
+                wedges[wedge] = best;
+            }
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            unsigned int a = collapsed[triangles[i]];
+            unsigned int b = collapsed[triangles[i + 1]];
+            unsigned int c = collapsed[triangles[i + 2]];
+
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+
+            triangles[write] = a;
+            triangles[write + 1] = b;
+            triangles[write + 2] = c;
+
+            corners[write] = corners[i];
+            corners[write + 1] = corners[i + 1];
+            corners[write + 2] = corners[i + 2];
+
+            write += 3;
+        }
+
+        triangles.resize(write);
+        corners.resize(write);
+    }
+
+    std::pmr::vector<unsigned int> result(corners.size(), scratch);
+    for (size_t i = 0; i < corners.size(); i++) {
+        result[i] = resolve(wedges, corners[i]);
+    }
+
+    if (resultError) {
+        *resultError = static_cast<float>(std::sqrt(error) / extent);
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "mesh.hpp"
+
+// Reduces a triangle list with quadric error edge collapses. The result indexes into the same vertex array so
+// every level of detail can share a single vertex buffer. targetError is relative to the mesh extent; collapses
+// that would exceed it are rejected even when targetIndexCount has not been reached yet. The working buffers and
+// the result are allocated from scratch.
+std::pmr::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, std::span<const unsigned int> indices, size_t targetIndexCount, float targetError, float* resultError = nullptr, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
\ No newline at end of file
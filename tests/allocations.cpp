@@ -0,0 +1,82 @@
+#include <assimp/scene.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include "arena.hpp"
+#include "memory.hpp"
+#include "model.hpp"
+#include "synthetic.hpp"
+
+// Counts the heap allocations of converting an imported mesh and fails when they exceed a fixed budget.
+// Once the scratch arena has grown to fit, BuildGeometry should only allocate the buffers it returns:
+// the vertices, the indices (moved once when the LOD levels outgrow the reservation), the LOD list and the
+// clusters. Any per-triangle, per-cluster or per-level allocation that creeps back in goes far past the bound;
+// copying an aiFace, whose copy constructor allocates its indices, is one of those.
+//
+//   HelloInstanceRenderingAllocationTest
+
+// The sphere is heavy enough to be clustered and simplified through every LOD level.
+constexpr unsigned int SPHERE_RINGS = 64;
+constexpr unsigned int SPHERE_SEGMENTS = 128;
+
+constexpr unsigned long long MAX_BUILD_ALLOCATIONS = 8;
+// The first build also grows the arena to its working size, a handful of blocks.
+constexpr unsigned long long MAX_FIRST_BUILD_ALLOCATIONS = 24;
+
+unsigned long long count_build_allocations(const aiMesh& mesh, ScratchArena& arena, MeshGeometry& geometry);
+
+int main() {
+    aiMesh* mesh = create_sphere_mesh(SPHERE_RINGS, SPHERE_SEGMENTS);
+
+    ScratchArena arena;
+    bool passed = true;
+
+    MeshGeometry first;
+    const unsigned long long firstAllocations = count_build_allocations(*mesh, arena, first);
+
+    std::cout << "First build of " << mesh->mNumFaces << " triangles: " << firstAllocations << " heap allocations, "
+              << first.lods.size() << " levels, " << first.meshlets.size() << " meshlets\n";
+
+    if (first.lods.size() < 2 || first.meshlets.empty()) {
+        std::cerr << "The test mesh was not clustered and simplified, so the count covers less than it should" << std::endl;
+        passed = false;
+    }
+
+    if (firstAllocations > MAX_FIRST_BUILD_ALLOCATIONS) {
+        std::cerr << "First build made " << firstAllocations << " heap allocations, over the budget of " << MAX_FIRST_BUILD_ALLOCATIONS << std::endl;
+        passed = false;
+    }
+
+    // Later meshes reuse the arena, as an import does, so only the output buffers should be left.
+    for (unsigned int pass = 0; pass < 3; pass++) {
+        MeshGeometry geometry;
+        const unsigned long long allocations = count_build_allocations(*mesh, arena, geometry);
+
+        std::cout << "Build " << pass + 2 << ": " << allocations << " heap allocations\n";
+
+        if (allocations > MAX_BUILD_ALLOCATIONS) {
+            std::cerr << "Build " << pass + 2 << " made " << allocations << " heap allocations, over the budget of " << MAX_BUILD_ALLOCATIONS << std::endl;
+            passed = false;
+        }
+    }
+
+    delete mesh;
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Freeing the previous geometry happens outside the count, so only this build's allocations are seen.
+unsigned long long count_build_allocations(const aiMesh& mesh, ScratchArena& arena, MeshGeometry& geometry) {
+    const LodSettings lodSettings;
+
+    const unsigned long long before = HeapAllocationCount();
+    geometry = Model::BuildGeometry(mesh, lodSettings, arena);
+    const unsigned long long after = HeapAllocationCount();
+
+    arena.Reset();
+
+    return after - before;
+}
\ No newline at end of file
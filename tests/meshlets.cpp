@@ -0,0 +1,143 @@
+#include <assimp/scene.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+#include "meshlet.hpp"
+#include "model.hpp"
+#include "synthetic.hpp"
+
+// Clusters a set of synthetic meshes chosen to hit the edges of BuildMeshlets and fails when ValidateMeshlets
+// reports a violation: a cluster over the vertex or triangle limit, triangles lost or duplicated, or a sphere
+// or cone that does not bound its cluster.
+//
+//   HelloInstanceRenderingMeshletTest
+
+struct TestMesh {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+std::vector<TestMesh> create_test_meshes();
+Vertex make_vertex(float x, float y, float z);
+bool check_meshlets(const TestMesh& mesh);
+
+int main() {
+    bool passed = true;
+
+    for (const TestMesh& mesh : create_test_meshes()) {
+        passed = check_meshlets(mesh) && passed;
+    }
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+std::vector<TestMesh> create_test_meshes() {
+    std::vector<TestMesh> meshes;
+
+    meshes.push_back({ "empty", {}, {} });
+
+    // One triangle, which has to come back as a cluster of its own.
+    meshes.push_back({ "single triangle", { make_vertex(0.0f, 0.0f, 0.0f), make_vertex(1.0f, 0.0f, 0.0f), make_vertex(0.0f, 1.0f, 0.0f) }, { 0, 1, 2 } });
+
+    // Triangles with repeated corners or collinear corners have no normal, and all of them at once leave
+    // the cone nothing to fit.
+    {
+        TestMesh mesh { "degenerate", {}, {} };
+
+        for (unsigned int i = 0; i < 8; i++) {
+            mesh.vertices.push_back(make_vertex(static_cast<float>(i), 0.0f, 0.0f));
+        }
+
+        mesh.indices = { 0, 0, 1, 2, 2, 2, 3, 4, 5, 1, 3, 7, 6, 6, 0, 4, 5, 6 };
+        meshes.push_back(std::move(mesh));
+    }
+
+    // Every triangle shares the hub, so the triangle limit is reached long before the vertex limit would be
+    // on a closed mesh, and the rim alone is over the vertex limit.
+    {
+        constexpr unsigned int RIM = 3 * MESHLET_MAX_TRIANGLES;
+
+        TestMesh mesh { "fan", { make_vertex(0.0f, 0.0f, 0.0f) }, {} };
+
+        for (unsigned int i = 0; i < RIM; i++) {
+            const float angle = glm::two_pi<float>() * i / RIM;
+            mesh.vertices.push_back(make_vertex(std::cos(angle), std::sin(angle), 0.0f));
+            mesh.indices.insert(mesh.indices.end(), { 0, i + 1, (i + 1) % RIM + 1 });
+        }
+
+        meshes.push_back(std::move(mesh));
+    }
+
+    // Triangles that share nothing, so no cluster can grow past its seed, and more of them than fit under
+    // the vertex limit together.
+    {
+        TestMesh mesh { "disjoint", {}, {} };
+
+        for (unsigned int i = 0; i < 2 * MESHLET_MAX_VERTICES; i++) {
+            const float x = static_cast<float>(i % 16);
+            const float z = static_cast<float>(i / 16);
+            const unsigned int first = static_cast<unsigned int>(mesh.vertices.size());
+
+            mesh.vertices.push_back(make_vertex(x, 0.0f, z));
+            mesh.vertices.push_back(make_vertex(x + 0.5f, 0.0f, z));
+            mesh.vertices.push_back(make_vertex(x, 0.0f, z + 0.5f));
+            mesh.indices.insert(mesh.indices.end(), { first, first + 2, first + 1 });
+        }
+
+        meshes.push_back(std::move(mesh));
+    }
+
+    // A closed mesh through the import path, with the degenerate triangles assimp leaves at the poles.
+    {
+        aiMesh* sphere = create_sphere_mesh(64, 128);
+        ScratchArena arena;
+
+        LodSettings noLods;
+        noLods.levels = 0;
+
+        MeshGeometry geometry = Model::BuildGeometry(*sphere, noLods, arena);
+        delete sphere;
+
+        meshes.push_back({ "sphere", std::move(geometry.vertices), std::move(geometry.indices) });
+    }
+
+    return meshes;
+}
+
+Vertex make_vertex(float x, float y, float z) {
+    Vertex vertex;
+    vertex.Position = glm::vec3(x, y, z);
+    vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+    vertex.TexCoords = glm::vec2(0.0f);
+
+    return vertex;
+}
+
+bool check_meshlets(const TestMesh& mesh) {
+    std::vector<unsigned int> clustered = mesh.indices;
+    const std::vector<Meshlet> meshlets = BuildMeshlets(mesh.vertices, clustered);
+
+    bool valid = ValidateMeshlets(meshlets, mesh.vertices, mesh.indices, clustered);
+
+    // Catches a build that drops everything, which tiles an empty list perfectly well.
+    if (meshlets.empty() != mesh.indices.empty()) {
+        std::cerr << "Expected " << (mesh.indices.empty() ? "no" : "some") << " meshlets" << std::endl;
+        valid = false;
+    }
+
+    std::cout << mesh.name << ": " << mesh.indices.size() / 3 << " triangles in " << meshlets.size() << " meshlets, "
+              << (valid ? "valid" : "INVALID") << "\n";
+
+    return valid;
+}
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "commands.hpp"
+#include "replay.hpp"
+#include "utility.hpp"
+
+// Plays back a frame saved with --record-frame, over and over, to measure what submitting it costs the driver
+// apart from everything else the application does in a frame. Loops alternate: even ones run untimed and give
+// the CPU submit, GPU and wall medians, odd ones time every command and fill the per-type table, so the
+// timing overhead stays out of the totals.
+//
+//   HelloInstanceRenderingReplay <frame> [--loops N] [--warmup N] [--visible]
+
+GLFWwindow* create_replay_window(bool visible);
+double median(std::vector<double> values);
+void print_command_table(const CommandTimings& timings, unsigned int frames);
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <frame> [--loops N] [--warmup N] [--visible]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string path = argv[1];
+    unsigned int loops = 200;
+    unsigned int warmup = 10;
+    bool visible = false;
+
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--loops" && i + 1 < argc) {
+            loops = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 2));
+        } else if (std::string(argv[i]) == "--warmup" && i + 1 < argc) {
+            warmup = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+        } else if (std::string(argv[i]) == "--visible") {
+            visible = true;
+        }
+    }
+
+    GLFWwindow* window = create_replay_window(visible);
+    if (!window) {
+        return EXIT_FAILURE;
+    }
+
+    int exitCode = EXIT_SUCCESS;
+
+    // The frame's objects have to go before the context does.
+    {
+        RecordedFrame frame;
+
+        if (!frame.Load(path)) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return EXIT_FAILURE;
+        }
+
+        glfwSetWindowSize(window, frame.GetWidth(), frame.GetHeight());
+
+        std::cout << "Replaying " << path << ": " << frame.GetCommands().GetCommandCount() << " commands ("
+                  << frame.GetCommands().GetSize() / 1024 << " KB) at " << frame.GetWidth() << "x" << frame.GetHeight() << "\n"
+                  << "Renderer: " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << "\n";
+
+        GLuint query = 0;
+        GL_CHECK(glGenQueries(1, &query));
+
+        CommandTimings timings;
+        unsigned int timedFrames = 0;
+        std::vector<double> submitMs;
+        std::vector<double> gpuMs;
+        std::vector<double> wallMs;
+
+        for (unsigned int loop = 0; loop < warmup + loops && !glfwWindowShouldClose(window); loop++) {
+            const bool measured = loop >= warmup;
+            const bool timed = measured && (loop - warmup) % 2 == 1;
+
+            auto wallStart = std::chrono::steady_clock::now();
+
+            frame.GetPrologue().Execute();
+
+            GL_CHECK(glBeginQuery(GL_TIME_ELAPSED, query));
+            auto submitStart = std::chrono::steady_clock::now();
+
+            frame.GetCommands().Execute(timed ? &timings : nullptr);
+
+            auto submitEnd = std::chrono::steady_clock::now();
+            GL_CHECK(glEndQuery(GL_TIME_ELAPSED));
+            GL_CHECK(glFinish());
+
+            auto wallEnd = std::chrono::steady_clock::now();
+
+            GLuint64 gpuNs = 0;
+            GL_CHECK(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuNs));
+
+            if (timed) {
+                timedFrames++;
+            } else if (measured) {
+                submitMs.push_back(std::chrono::duration<double, std::milli>(submitEnd - submitStart).count());
+                gpuMs.push_back(gpuNs / 1e6);
+                wallMs.push_back(std::chrono::duration<double, std::milli>(wallEnd - wallStart).count());
+            }
+
+            // The frame draws into its own framebuffer; copy it out so --visible shows something.
+            if (visible) {
+                GLint framebuffer = 0;
+                GL_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer));
+
+                if (framebuffer != 0) {
+                    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(framebuffer)));
+                    GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+                    GL_CHECK(glBlitFramebuffer(0, 0, frame.GetWidth(), frame.GetHeight(), 0, 0, frame.GetWidth(), frame.GetHeight(), GL_COLOR_BUFFER_BIT, GL_NEAREST));
+                }
+
+                glfwSwapBuffers(window);
+            }
+
+            glfwPollEvents();
+        }
+
+        GL_CHECK(glDeleteQueries(1, &query));
+
+        if (submitMs.empty()) {
+            std::cerr << "No frames were measured" << std::endl;
+            exitCode = EXIT_FAILURE;
+        } else {
+            print_command_table(timings, std::max(timedFrames, 1u));
+
+            std::cout << std::fixed << std::setprecision(3)
+                      << "Median over " << submitMs.size() << " untimed replays: "
+                      << median(submitMs) << " ms CPU submit, "
+                      << median(gpuMs) << " ms GPU, "
+                      << median(wallMs) << " ms wall including the prologue and glFinish\n";
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return exitCode;
+}
+
+GLFWwindow* create_replay_window(bool visible) {
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return nullptr;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Replay", nullptr, nullptr);
+
+    if (!window) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+
+    glfwMakeContextCurrent(window);
+    // Replays run back to back; waiting on vsync would only measure the display.
+    glfwSwapInterval(0);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+
+    return window;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+// Command types by CPU time spent issuing them, most expensive first.
+void print_command_table(const CommandTimings& timings, unsigned int frames) {
+    std::vector<size_t> order;
+
+    for (size_t type = 0; type < COMMAND_TYPE_COUNT; type++) {
+        if (timings.counts[type] > 0) {
+            order.push_back(type);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return timings.nanoseconds[lhs] > timings.nanoseconds[rhs];
+    });
+
+    std::cout << "Per command, over " << frames << " timed replays:\n"
+              << std::left << std::setw(28) << "  command" << std::right
+              << std::setw(14) << "count/frame" << std::setw(14) << "us/frame" << std::setw(14) << "ns/command" << "\n";
+
+    for (size_t type : order) {
+        const double count = static_cast<double>(timings.counts[type]);
+
+        std::cout << std::left << std::setw(28) << "  " + std::string(GetCommandInfo(static_cast<CommandType>(type)).name) << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << count / frames
+                  << std::setw(14) << timings.nanoseconds[type] / 1000.0 / frames
+                  << std::setw(14) << timings.nanoseconds[type] / count << "\n";
+    }
+}
\ No newline at end of file